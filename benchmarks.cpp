@@ -0,0 +1,562 @@
+/*
+Benchmarks of the performance relevant parts of the Mahjong implementation.
+Results are written as JSON, such that they can be compared across versions.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/Tile.hpp"
+#include "include/Set.hpp"
+#include "include/Batch_evaluation.hpp"
+#include "include/Environment.hpp"
+#include "include/Game.hpp"
+#include "include/Inference_queue.hpp"
+#include "include/Logging.hpp"
+#include "include/Observation.hpp"
+#include "include/Player.hpp"
+#include "include/Policy.hpp"
+#include "include/Shanten.hpp"
+#include "include/Simulation_runner.hpp"
+
+using namespace std;
+
+/** @brief Number of hands per corpus. */
+unsigned int N_CORPUS_HANDS = 1000;
+
+/** @brief Seed of the hand corpora, fixed such that all versions are benchmarked on the same hands. */
+const std::uint64_t CORPUS_SEED = 20240101;
+
+/**
+ * @brief Result of a single benchmark.
+ */
+struct Benchmark_result
+{
+    string name;              ///< Name of the benchmark.
+    unsigned long long n_ops; ///< Number of measured operations.
+    double seconds;           ///< Total measured time.
+};
+
+/** @brief Accumulates benchmark outputs, so the compiler can't remove the measured calls. */
+volatile unsigned long long benchmark_sink = 0;
+
+/**
+ * @brief Repeatedly runs an operation until the minimal measurement time is reached.
+ *
+ * @param name Name of the benchmark.
+ * @param min_seconds Minimal measurement time.
+ * @param n_ops_per_run Number of operations performed by a single run.
+ * @param run Function performing n_ops_per_run operations and returning a checksum of their results.
+ * @return The benchmark result.
+ */
+Benchmark_result measure(const string &name, double min_seconds, unsigned long long n_ops_per_run, const function<unsigned long long()> &run)
+{
+    benchmark_sink += run(); // Warm up caches and lazily built tables.
+
+    unsigned long long n_ops = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    while (seconds < min_seconds)
+    {
+        benchmark_sink += run();
+        n_ops += n_ops_per_run;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    cerr << name << ": " << seconds * 1e9 / n_ops << " ns/op\n";
+    return {name, n_ops, seconds};
+}
+
+/**
+ * @brief Converts a list of tiles into a hand.
+ */
+Mahjong::Hand make_hand(const vector<Mahjong::Tile> &tiles)
+{
+    Mahjong::Hand hand;
+    for (const Mahjong::Tile &tile : tiles)
+        hand.add_tile(tile);
+    return hand;
+}
+
+/**
+ * @brief Generates a winning hand of four random pongs or chows and a pair.
+ */
+vector<Mahjong::Tile> make_winning_tiles(Mahjong::Rng &rng)
+{
+    while (true)
+    {
+        Mahjong::Tile_counts counts{};
+        vector<Mahjong::Tile> tiles;
+        auto add = [&](int suit, int rank, int n)
+        {
+            for (int i = 0; i < n; i++)
+                tiles.push_back(Mahjong::Tile(suit, rank));
+            counts[Mahjong::Tile(suit, rank).get_kind()] += n;
+        };
+
+        for (int combination = 0; combination < 4; combination++)
+        {
+            int suit = rng.bounded(5);
+            if (suit < 3 && rng.bounded(2) == 0)
+            {
+                int rank = rng.bounded(7);
+                for (int offset = 0; offset < 3; offset++)
+                    add(suit, rank + offset, 1);
+            }
+            else
+                add(suit, rng.bounded(suit < 3 ? 9 : (suit == 3 ? 4 : 3)), 3);
+        }
+        int suit = rng.bounded(5);
+        add(suit, rng.bounded(suit < 3 ? 9 : (suit == 3 ? 4 : 3)), 2);
+
+        if (std::all_of(counts.begin(), counts.end(), [](unsigned char count)
+                        { return count <= 4; }))
+        {
+            rng.shuffle(tiles.begin(), tiles.end());
+            return tiles;
+        }
+    }
+}
+
+/**
+ * @brief Generates a tenpai hand, i.e. a winning hand with one tile replaced by a random tile.
+ */
+vector<Mahjong::Tile> make_tenpai_tiles(Mahjong::Rng &rng)
+{
+    vector<Mahjong::Tile> tiles = make_winning_tiles(rng);
+    tiles[rng.bounded(tiles.size())] = Mahjong::Tile(rng);
+    return tiles;
+}
+
+/**
+ * @brief Generates a hand of 14 tiles drawn from a shuffled set.
+ */
+vector<Mahjong::Tile> make_random_tiles(Mahjong::Rng &rng)
+{
+    Mahjong::Set set;
+    set.shuffle(rng);
+    vector<Mahjong::Tile> tiles;
+    for (int i = 0; i < 14; i++)
+        tiles.push_back(set.pop_tile());
+    return tiles;
+}
+
+/**
+ * @brief Generates a corpus of hands.
+ */
+vector<Mahjong::Hand> make_corpus(vector<Mahjong::Tile> (*make_tiles)(Mahjong::Rng &), std::uint64_t seed)
+{
+    Mahjong::Rng rng(seed);
+    vector<Mahjong::Hand> corpus;
+    for (unsigned int i = 0; i < N_CORPUS_HANDS; i++)
+        corpus.push_back(make_hand(make_tiles(rng)));
+    return corpus;
+}
+
+/**
+ * @brief Writes the results as JSON.
+ */
+void write_json(ostream &out, const vector<Benchmark_result> &results, unsigned int n_threads)
+{
+    out << "{\n  \"n_threads\": " << n_threads << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Benchmark_result &result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"n_ops\": " << result.n_ops
+            << ", \"seconds\": " << result.seconds
+            << ", \"ns_per_op\": " << result.seconds * 1e9 / result.n_ops
+            << ", \"ops_per_second\": " << result.n_ops / result.seconds << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+/**
+ * @brief Prints the command line options of the benchmarks.
+ */
+void print_usage()
+{
+    cout << "Usage: benchmarks [--output FILE] [--time SECONDS] [--threads N] [--filter TEXT]\n"
+         << "  --output FILE    Write the JSON results to FILE instead of stdout.\n"
+         << "  --time SECONDS   Minimal measurement time per benchmark (default 0.5).\n"
+         << "  --threads N      Largest number of threads of the game throughput benchmark (default: hardware threads).\n"
+         << "  --filter TEXT    Only run benchmarks whose name contains TEXT.\n";
+}
+
+int main(int argc, char *argv[])
+{
+    string output_path = "";
+    double min_seconds = 0.5;
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    string filter = "";
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        if (argument == "--help" || argument == "-h")
+        {
+            print_usage();
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+        string value = argv[++i];
+
+        if (argument == "--output")
+            output_path = value;
+        else if (argument == "--time")
+            min_seconds = stod(value);
+        else if (argument == "--threads")
+            max_threads = std::max(1ul, stoul(value));
+        else if (argument == "--filter")
+            filter = value;
+        else
+        {
+            cerr << "Unknown option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    Mahjong::Null_sink null_sink;
+    Mahjong::set_log_sink(null_sink);
+
+    vector<Benchmark_result> results;
+    auto run = [&](const string &name, unsigned long long n_ops_per_run, const function<unsigned long long()> &operation)
+    {
+        if (name.find(filter) != string::npos)
+            results.push_back(measure(name, min_seconds, n_ops_per_run, operation));
+    };
+
+    const vector<pair<string, vector<Mahjong::Hand>>> corpora = {
+        {"winning", make_corpus(make_winning_tiles, CORPUS_SEED)},
+        {"tenpai", make_corpus(make_tenpai_tiles, CORPUS_SEED + 1)},
+        {"random", make_corpus(make_random_tiles, CORPUS_SEED + 2)},
+    };
+    const Mahjong::Wind round_wind(0);
+    const Mahjong::Wind seat_wind(1);
+
+    // Hand evaluation
+    for (const auto &[corpus_name, corpus] : corpora)
+    {
+        run("is_winning_hand/" + corpus_name, corpus.size(), [&corpus]()
+            {
+                unsigned long long n_winning = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    n_winning += hand.is_winning_hand();
+                return n_winning; });
+
+        run("is_winning_hand_reference/" + corpus_name, corpus.size(), [&corpus]()
+            {
+                unsigned long long n_winning = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    n_winning += hand.is_winning_hand_reference();
+                return n_winning; });
+
+        run("get_combinations/" + corpus_name, corpus.size(), [&corpus]()
+            {
+                unsigned long long n_combinations = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    n_combinations += hand.get_combinations().size();
+                return n_combinations; });
+
+        run("compute_max_score/" + corpus_name, corpus.size(), [&]()
+            {
+                unsigned long long total = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    total += std::get<0>(hand.compute_max_score(round_wind, seat_wind));
+                return total; });
+
+        run("get_max_score/" + corpus_name, corpus.size(), [&]()
+            {
+                unsigned long long total = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    total += std::get<0>(hand.get_max_score(round_wind, seat_wind));
+                return total; });
+
+        run("get_shanten/" + corpus_name, corpus.size(), [&corpus]()
+            {
+                unsigned long long total = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                    total += Mahjong::get_shanten(hand.get_hidden_counts(), hand.get_revealed_counts()) + 1;
+                return total; });
+
+        run("get_ukeire/" + corpus_name, corpus.size(), [&corpus]()
+            {
+                Mahjong::Tile_counts live_counts;
+                live_counts.fill(4);
+                unsigned long long total = 0;
+                for (const Mahjong::Hand &hand : corpus)
+                {
+                    Mahjong::Tile_counts counts = hand.get_hidden_counts();
+                    counts[hand.get_tile_by_index(0).get_kind()] -= 1; // Ukeire is evaluated for 13 tiles.
+                    total += Mahjong::get_ukeire(counts, hand.get_revealed_counts(), live_counts);
+                }
+                return total; });
+
+        // Batches of concealed hands, the waits being evaluated for 13 tiles.
+        vector<Mahjong::Tile_counts> complete_counts;
+        vector<Mahjong::Tile_counts> tenpai_counts;
+        for (const Mahjong::Hand &hand : corpus)
+        {
+            complete_counts.push_back(hand.get_hidden_counts());
+            tenpai_counts.push_back(hand.get_hidden_counts());
+            tenpai_counts.back()[hand.get_tile_by_index(0).get_kind()] -= 1;
+        }
+        vector<std::uint64_t> batch_bits((corpus.size() + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE);
+        vector<std::uint64_t> wait_masks(corpus.size());
+
+        run("evaluate_complete_hands/" + corpus_name, corpus.size(), [&]()
+            {
+                Mahjong::evaluate_complete_hands(complete_counts.data(), complete_counts.size(), batch_bits.data());
+                unsigned long long n_complete = 0;
+                for (std::uint64_t bits : batch_bits)
+                    n_complete += __builtin_popcountll(bits);
+                return n_complete; });
+
+        run("wait_mask/" + corpus_name, corpus.size(), [&]()
+            {
+                const Mahjong::Tile_counts revealed_counts{};
+                unsigned long long n_waits = 0;
+                for (Mahjong::Tile_counts counts : tenpai_counts)
+                {
+                    for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+                    {
+                        if (counts[kind] >= 4)
+                            continue;
+                        counts[kind] += 1;
+                        n_waits += Mahjong::is_complete_hand(counts, revealed_counts);
+                        counts[kind] -= 1;
+                    }
+                }
+                return n_waits; });
+
+        run("evaluate_tenpai_hands/" + corpus_name, corpus.size(), [&]()
+            {
+                Mahjong::evaluate_tenpai_hands(tenpai_counts.data(), tenpai_counts.size(), batch_bits.data(), wait_masks.data());
+                unsigned long long n_waits = 0;
+                for (std::uint64_t wait_mask : wait_masks)
+                    n_waits += __builtin_popcountll(wait_mask);
+                return n_waits; });
+
+        vector<vector<set<int>>> combinations;
+        for (const Mahjong::Hand &hand : corpus)
+            combinations.push_back(hand.get_combinations());
+        run("dlx_exact_covers/" + corpus_name, combinations.size(), [&combinations]()
+            {
+                thread_local DLX::reusable_exact_cover_solver solver;
+                unsigned long long n_covers = 0;
+                for (const vector<set<int>> &sets : combinations)
+                    n_covers += solver.find_exact_covers(sets, HAND_SIZE + 1).size();
+                return n_covers; });
+    }
+
+    // Policies
+    {
+        Mahjong::Game game(0, CORPUS_SEED);
+        game.player_draw(0, false);
+        Mahjong::State_view discard_state = game.get_game_state_for_player(0);
+        Mahjong::Action_list<int> discards = discard_state.get_own_hand().get_valid_discards();
+
+        // A pickup decision offering a claim, reached by discarding the last hidden tile and declining every claim.
+        Mahjong::Game pickup_game(0, CORPUS_SEED);
+        for (unsigned int player = 0; player < N_PLAYERS; player++)
+            pickup_game.set_external_player(player, true);
+        pickup_game.advance();
+        while (pickup_game.has_pending_decision())
+        {
+            Mahjong::Decision decision = pickup_game.pending_decision();
+            if (decision.action_type == Mahjong::Action_type::pickup && decision.available_actions.size() > 1)
+                break;
+            pickup_game.submit(decision.available_actions[decision.available_actions.size() - 1]);
+            pickup_game.advance();
+        }
+        assert(pickup_game.has_pending_decision());
+        Mahjong::Decision pickup = pickup_game.pending_decision();
+        Mahjong::State_view pickup_state = pickup_game.get_game_state_for_player(pickup.player_number);
+
+        const vector<Mahjong::Policy_type> policy_types = {Mahjong::Policy_type::random, Mahjong::Policy_type::tile_count, Mahjong::Policy_type::shanten, Mahjong::Policy_type::monte_carlo};
+        for (Mahjong::Policy_type policy_type : policy_types)
+        {
+            Mahjong::Policy policy;
+            policy.set_policy(policy_type);
+            policy.set_randomness(1.0); // The randomness is applied inversely, so this always uses the policy itself.
+            Mahjong::Search_settings search_settings;
+            search_settings.n_rollouts = 64; // A small budget on one thread, so a decision is quick and reproducible.
+            search_settings.n_threads = 1;
+            policy.set_search_settings(search_settings);
+            Mahjong::Rng rng(CORPUS_SEED);
+            const int n_decisions = (policy_type == Mahjong::Policy_type::monte_carlo) ? 1 : 1000;
+
+            run(string("select_action/discard/") + Mahjong::to_string(policy_type), n_decisions, [&]()
+                {
+                    unsigned long long total = 0;
+                    for (int i = 0; i < n_decisions; i++)
+                        total += policy.select_action(Mahjong::Action_type::discard, discards, discard_state, rng);
+                    return total; });
+
+            run(string("select_action/pickup/") + Mahjong::to_string(policy_type), n_decisions, [&]()
+                {
+                    unsigned long long total = 0;
+                    for (int i = 0; i < n_decisions; i++)
+                        total += policy.select_action(Mahjong::Action_type::pickup, pickup.available_actions, pickup_state, rng);
+                    return total; });
+        }
+    }
+
+    // Observations
+    {
+        Mahjong::Game game(0, CORPUS_SEED);
+        for (unsigned int player = 0; player < N_PLAYERS; player++)
+            game.player_turn(player, false);
+        Mahjong::State_view state = game.get_game_state_for_player(0);
+        vector<float> float_observation(OBSERVATION_SIZE);
+        vector<std::uint8_t> byte_observation(OBSERVATION_SIZE);
+
+        run("encode_observation/float", 1000, [&]()
+            {
+                unsigned long long total = 0;
+                for (int i = 0; i < 1000; i++)
+                {
+                    Mahjong::encode_observation(state, Mahjong::Action_type::discard, float_observation.data());
+                    total += float_observation[OBSERVATION_SIZE - 1];
+                }
+                return total; });
+
+        run("encode_observation/uint8", 1000, [&]()
+            {
+                unsigned long long total = 0;
+                for (int i = 0; i < 1000; i++)
+                {
+                    Mahjong::encode_observation(state, Mahjong::Action_type::discard, byte_observation.data());
+                    total += byte_observation[OBSERVATION_SIZE - 1];
+                }
+                return total; });
+    }
+
+    // Snapshots
+    {
+        Mahjong::Game game(0, CORPUS_SEED);
+        for (unsigned int player = 0; player < N_PLAYERS; player++)
+            game.player_turn(player, false);
+        Mahjong::Game_snapshot snapshot = game.snapshot();
+        Mahjong::Game fork(1);
+
+        run("game/snapshot", 1000, [&]()
+            {
+                unsigned long long total = 0;
+                for (int i = 0; i < 1000; i++)
+                {
+                    game.snapshot(snapshot);
+                    total += snapshot.wall_size;
+                }
+                return total; });
+
+        run("game/restore", 1000, [&]()
+            {
+                unsigned long long total = 0;
+                for (int i = 0; i < 1000; i++)
+                {
+                    fork.restore(snapshot);
+                    total += fork.get_set_size();
+                }
+                return total; });
+
+        run("game/reset", 1000, [&]()
+            {
+                unsigned long long total = 0;
+                for (int i = 0; i < 1000; i++)
+                {
+                    fork.reset();
+                    total += fork.get_set_size();
+                }
+                return total; });
+    }
+
+    // Environment steps of a batch of games, finished games are reset right away
+    {
+        const unsigned int n_environment_games = 256;
+        std::array<Mahjong::Policy_type, 4> policies = {Mahjong::Policy_type::random, Mahjong::Policy_type::tile_count, Mahjong::Policy_type::tile_count, Mahjong::Policy_type::tile_count};
+        Mahjong::Vector_environment environment(n_environment_games, policies);
+        vector<std::uint64_t> seeds(n_environment_games);
+        for (unsigned int index = 0; index < n_environment_games; index++)
+            seeds[index] = Mahjong::derive_seed(CORPUS_SEED, index);
+        environment.reset(seeds);
+        Mahjong::Rng rng(CORPUS_SEED);
+        vector<int> actions(n_environment_games);
+        std::uint64_t n_resets = n_environment_games;
+
+        run("environment/step", n_environment_games, [&]()
+            {
+                unsigned long long total = 0;
+                for (unsigned int index = 0; index < n_environment_games; index++)
+                {
+                    if (environment.get_dones()[index])
+                        environment.reset_game(index, Mahjong::derive_seed(CORPUS_SEED, n_resets++));
+                    const unsigned char *mask = environment.get_action_masks() + index * N_ENVIRONMENT_ACTIONS;
+                    Mahjong::Action_list<int, N_ENVIRONMENT_ACTIONS> legal_actions;
+                    for (unsigned int action = 0; action < N_ENVIRONMENT_ACTIONS; action++)
+                    {
+                        if (mask[action])
+                            legal_actions.push_back(action);
+                    }
+                    actions[index] = (legal_actions.size() > 0) ? legal_actions[rng.bounded(legal_actions.size())] : 0;
+                }
+                environment.step(actions);
+                for (unsigned int index = 0; index < n_environment_games; index++)
+                    total += environment.get_rewards()[index];
+                return total; });
+    }
+
+    // Games of a network seat decided through the inference queue, by a stand-in network choosing the first legal action
+    for (unsigned int batch_size : {1u, 64u, 256u})
+    {
+        const unsigned int n_games = 200;
+        run("inference_queue/batch=" + to_string(batch_size), n_games, [&]()
+            {
+                Mahjong::Inference_queue queue(batch_size, std::chrono::microseconds(100), [](const float *, const unsigned char *action_masks, size_t n_requests, int *actions)
+                                               {
+                                                   for (size_t i = 0; i < n_requests; i++)
+                                                   {
+                                                       const unsigned char *mask = action_masks + i * N_ENVIRONMENT_ACTIONS;
+                                                       actions[i] = std::find(mask, mask + N_ENVIRONMENT_ACTIONS, 1) - mask;
+                                                   } });
+                std::array<Mahjong::Policy_type, 4> policies = {Mahjong::Policy_type::random, Mahjong::Policy_type::tile_count, Mahjong::Policy_type::tile_count, Mahjong::Policy_type::tile_count};
+                Mahjong::Batched_inference_runner runner(n_games, 1, 256, policies, {true, false, false, false}, queue, CORPUS_SEED);
+                return static_cast<unsigned long long>(runner.run().n_games); });
+    }
+
+    // Full games
+    vector<unsigned int> thread_counts;
+    for (unsigned int n_threads = 1; n_threads < max_threads; n_threads *= 2)
+        thread_counts.push_back(n_threads);
+    thread_counts.push_back(max_threads);
+    for (unsigned int n_threads : thread_counts)
+    {
+        const unsigned int n_games = 200 * n_threads;
+        run("games/threads=" + to_string(n_threads), n_games, [&]()
+            {
+                std::array<Mahjong::Policy_type, 4> policies = {Mahjong::Policy_type::tile_count, Mahjong::Policy_type::random, Mahjong::Policy_type::random, Mahjong::Policy_type::random};
+                Mahjong::Simulation_runner runner(n_games, n_threads, policies, CORPUS_SEED);
+                return static_cast<unsigned long long>(runner.run().n_games); });
+    }
+
+    if (output_path.empty())
+        write_json(cout, results, max_threads);
+    else
+    {
+        ofstream output(output_path);
+        write_json(output, results, max_threads);
+    }
+}
@@ -0,0 +1,179 @@
+/**
+ * @file Action.hpp
+ * @brief Defines the action and policy types used for decisions in a Mahjong game.
+ */
+#pragma once
+
+#include <array>
+#include <assert.h>
+#include <cstddef>
+#include <string>
+
+/** @brief Maximum number of actions available for a single decision, bounded by the largest possible hand. */
+const unsigned int MAX_ACTIONS = 20;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief The type of decision a policy is asked to make.
+     */
+    enum class Action_type
+    {
+        discard, ///< Choose the index of the tile to be discarded.
+        pickup,  ///< Choose a pickup action (see Pickup_action) for the latest discarded tile.
+    };
+
+    /**
+     * @brief Actions for picking up the latest discarded tile, ordered by increasing priority.
+     */
+    enum class Pickup_action
+    {
+        none = 0, ///< Don't pick up the tile.
+        chow = 1, ///< Complete a chow with the tile.
+        pong = 2, ///< Complete a pong with the tile.
+        kong = 3, ///< Complete a kong with the tile.
+    };
+
+    /** @brief Number of pickup actions. */
+    const unsigned int N_PICKUP_ACTIONS = 4;
+
+    /** @brief String names of the pickup actions, indexed by their value. */
+    constexpr std::array<const char *, N_PICKUP_ACTIONS> PICKUP_ACTION_NAMES = {"none", "chow", "pong", "kong"};
+
+    /**
+     * @brief Decision policies of a player.
+     */
+    enum class Policy_type
+    {
+        random,     ///< Choose uniformly among the available actions.
+        human,      ///< Decisions are made by a human via the console.
+        tile_count, ///< Discard tiles based on the number of visible tiles of the same kind.
+        shanten,    ///< Minimize the shanten number and maximize the number of improving live tiles (see Shanten.hpp).
+        monte_carlo, ///< Choose the action with the best average outcome of determinized rollouts (see Monte_carlo.hpp).
+    };
+
+    /** @brief Number of policy types. */
+    const unsigned int N_POLICY_TYPES = 5;
+
+    /** @brief String names of the policy types, indexed by their value. */
+    constexpr std::array<const char *, N_POLICY_TYPES> POLICY_NAMES = {"random", "human", "tile_count", "shanten", "monte_carlo"};
+
+    /**
+     * @brief Budget and rollout policy of the decisions of the monte_carlo policy.
+     *
+     * A decision stops as soon as one of the limits is reached. Without a time limit the decision only depends on
+     * the game, not on the number of threads or their scheduling.
+     */
+    struct Search_settings
+    {
+        unsigned int n_rollouts = 1024;                      ///< Rollouts per decision, 0 for no limit.
+        float max_seconds = 0;                               ///< Deliberation time per decision in seconds, 0 for no limit.
+        unsigned int n_threads = 0;                          ///< Threads per decision including the deciding one, 0 for all hardware threads.
+        Policy_type rollout_policy = Policy_type::tile_count; ///< Policy of all players during the rollouts.
+    };
+
+    /**
+     * @brief Tunable parameters of a policy, with the defaults of Policy.
+     */
+    struct Policy_parameters
+    {
+        float randomness = 0.05; ///< The randomness factor, applied inversely: the chance of using the policy itself rather than a random action.
+        float chow_rate = 0.5;   ///< The rate of declining a chow of the tile_count policy.
+    };
+
+    /**
+     * @brief Gets the name of a pickup action.
+     *
+     * @param action The pickup action.
+     * @return The name of the action.
+     */
+    inline const char *to_string(Pickup_action action)
+    {
+        return PICKUP_ACTION_NAMES[static_cast<unsigned int>(action)];
+    }
+
+    /**
+     * @brief Gets the name of a policy type.
+     *
+     * @param policy The policy type.
+     * @return The name of the policy.
+     */
+    inline const char *to_string(Policy_type policy)
+    {
+        return POLICY_NAMES[static_cast<unsigned int>(policy)];
+    }
+
+    /**
+     * @brief Parses the name of a policy type.
+     *
+     * @param name The name of the policy (see POLICY_NAMES).
+     * @param policy Receives the parsed policy type.
+     * @return True if the name is valid, false otherwise.
+     */
+    inline bool parse_policy_type(const std::string &name, Policy_type &policy)
+    {
+        for (unsigned int index = 0; index < N_POLICY_TYPES; index++)
+        {
+            if (name == POLICY_NAMES[index])
+            {
+                policy = static_cast<Policy_type>(index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @class Action_list
+     * @brief List of actions with a fixed capacity, stored inline without heap allocations.
+     *
+     * @tparam T The type of the actions.
+     * @tparam Capacity The maximum number of actions.
+     */
+    template <typename T, std::size_t Capacity = MAX_ACTIONS>
+    class Action_list
+    {
+    private:
+        std::array<T, Capacity> actions; ///< The storage of the actions.
+        std::size_t n_actions = 0;       ///< The number of actions in the list.
+
+    public:
+        /**
+         * @brief Appends an action to the list.
+         *
+         * @param action The action to be appended, the list must not be full.
+         */
+        void push_back(T action)
+        {
+            assert(n_actions < Capacity);
+            actions[n_actions++] = action;
+        }
+
+        /**
+         * @brief Removes all actions from the list.
+         */
+        void clear()
+        {
+            n_actions = 0;
+        }
+
+        /** @brief Gets the number of actions in the list. */
+        std::size_t size() const { return n_actions; }
+
+        /** @brief Checks whether the list is empty. */
+        bool empty() const { return n_actions == 0; }
+
+        /** @brief Gets the action at the given index. */
+        const T &operator[](std::size_t index) const { return actions[index]; }
+
+        /** @brief Gets an iterator to the first action. */
+        const T *begin() const { return actions.data(); }
+
+        /** @brief Gets an iterator past the last action. */
+        const T *end() const { return actions.data() + n_actions; }
+    };
+} // namespace Mahjong
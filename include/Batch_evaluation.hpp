@@ -0,0 +1,321 @@
+/**
+ * @file Batch_evaluation.hpp
+ * @brief Defines the evaluation of many concealed hands at once, deciding which are complete resp. tenpai.
+ *
+ * The hands are given as an array of tile count histograms (see Tile_counts) of hidden tiles, the results are
+ * written to a bitmap holding bit i % 64 of word i / 64 for hand i. Hands are evaluated in blocks of 64, one word
+ * of the bitmap, and each block runs one step for all of its hands before the next: the suit keys are plain loops
+ * over arrays, which the compiler can vectorize, and the table lookups of a block don't depend on each other, so
+ * their cache misses overlap instead of stalling one hand after the other. Tenpai hands share these steps, after
+ * which the waits are found one hand after the other, reusing the decompositions of the nine groups not containing
+ * the added tile, so only one table lookup is needed per candidate tile. Large batches are split over several
+ * threads at block boundaries.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "Tile.hpp"
+#include "decomposition_table.hpp"
+
+/** @brief Number of hands evaluated together, i.e. the hands of one word of a result bitmap. */
+const unsigned int BATCH_BLOCK_SIZE = 64;
+
+/** @brief Minimal number of hands per thread of a parallel batch evaluation. */
+const std::size_t MIN_BATCH_HANDS_PER_THREAD = 1 << 14;
+
+/** @brief Number of groups of a hand decomposing independently, i.e. the three ground suits and seven honours. */
+const unsigned int N_DECOMPOSITION_GROUPS = 3 + 7;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Adds the decompositions of a group of hidden tiles to the achievable values of (pairs - kongs).
+     *
+     * Equivalent to a step of get_decomposition_values, iterating over the set bits of the mask only.
+     *
+     * @param values Bit mask of the achievable values so far, bit 16 + n marking (pairs - kongs) == n.
+     * @param mask The decomposition mask of the group (see Decomposition_table).
+     * @return Bit mask of the achievable values including the group, 0 if the tiles can't be covered.
+     */
+    inline std::uint64_t combine_hidden_values(std::uint64_t values, std::uint16_t mask)
+    {
+        std::uint64_t combined = 0;
+        for (unsigned int bits = mask & Decomposition_table::HIDDEN_BITS; bits != 0; bits &= bits - 1)
+            combined |= values << __builtin_ctz(bits);
+        return combined >> Decomposition_table::DELTA_OFFSET;
+    }
+
+    /**
+     * @brief Checks whether achievable values of (pairs - kongs) of a concealed hand make it complete.
+     *
+     * @param values Bit mask of the achievable values of all groups.
+     * @return True if (pairs - kongs) == 1 is achievable.
+     */
+    constexpr bool is_complete_value(std::uint64_t values)
+    {
+        return (values >> (16 + 1)) & 1;
+    }
+
+    /**
+     * @brief Gets the kinds completing a concealed hand of 13 tiles, i.e. its waits.
+     *
+     * Gives the same waits as Hand::get_wait_mask for a hand without revealed tiles.
+     *
+     * @param counts Number of hidden tiles per tile kind, at most four each.
+     * @return Bit mask with one bit per tile kind completing the hand, 0 if the hand doesn't consist of 13 tiles.
+     */
+    inline std::uint64_t get_concealed_wait_mask(const Mahjong::Tile_counts &counts)
+    {
+        unsigned int n_tiles = 0;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            n_tiles += counts[kind];
+        if (n_tiles != 13)
+            return 0;
+
+        const Decomposition_table &table = Decomposition_table::get_instance();
+        std::array<std::uint32_t, 3> keys;
+        std::array<std::uint16_t, N_DECOMPOSITION_GROUPS> masks;
+        for (unsigned int suit = 0; suit < 3; suit++)
+        {
+            keys[suit] = get_suit_key(counts, suit);
+            masks[suit] = table.get_mask(keys[suit]);
+        }
+        for (unsigned int honour = 0; honour < 7; honour++)
+            masks[3 + honour] = get_honour_mask(counts[27 + honour]);
+
+        // Values of all groups but one, the prefix of the groups before it being shared.
+        std::array<std::uint64_t, N_DECOMPOSITION_GROUPS> others;
+        std::uint64_t prefix = std::uint64_t(1) << 16;
+        for (unsigned int group = 0; group < N_DECOMPOSITION_GROUPS; group++)
+        {
+            std::uint64_t values = prefix;
+            for (unsigned int other = group + 1; other < N_DECOMPOSITION_GROUPS; other++)
+                values = combine_hidden_values(values, masks[other]);
+            others[group] = values;
+            prefix = combine_hidden_values(prefix, masks[group]);
+        }
+
+        std::uint64_t wait_mask = 0;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            if (counts[kind] >= 4)
+                continue;
+            unsigned int group = (kind < 27) ? kind / N_SUIT_RANKS : kind - 27 + 3;
+            if (others[group] == 0)
+                continue;
+            std::uint16_t mask = (kind < 27) ? table.get_mask(keys[group] + Decomposition_table::POWERS[kind % N_SUIT_RANKS]) : get_honour_mask(counts[kind] + 1);
+            if (is_complete_value(combine_hidden_values(others[group], mask)))
+                wait_mask |= std::uint64_t(1) << kind;
+        }
+        return wait_mask;
+    }
+
+    /**
+     * @brief Checks which hands of a block of concealed hands are complete.
+     *
+     * @param hands The hands, hidden tile counts with at most four tiles per kind.
+     * @param n_hands The number of hands, at most BATCH_BLOCK_SIZE.
+     * @return Bit mask with bit i set if hand i consists of 14 tiles and is complete.
+     */
+    inline std::uint64_t evaluate_complete_block(const Mahjong::Tile_counts *hands, std::size_t n_hands)
+    {
+        const Decomposition_table &table = Decomposition_table::get_instance();
+        std::array<std::uint64_t, BATCH_BLOCK_SIZE> values;
+        std::array<std::uint32_t, BATCH_BLOCK_SIZE> keys;
+        std::array<unsigned int, BATCH_BLOCK_SIZE> n_tiles;
+        values.fill(std::uint64_t(1) << 16);
+        n_tiles.fill(0);
+
+        for (unsigned int suit = 0; suit < 3; suit++)
+        {
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+            {
+                std::uint32_t key = 0;
+                unsigned int n_suit_tiles = 0;
+                for (unsigned int rank = 0; rank < N_SUIT_RANKS; rank++)
+                {
+                    key += hands[hand][suit * N_SUIT_RANKS + rank] * Decomposition_table::POWERS[rank];
+                    n_suit_tiles += hands[hand][suit * N_SUIT_RANKS + rank];
+                }
+                keys[hand] = key;
+                n_tiles[hand] += n_suit_tiles;
+            }
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+                values[hand] = combine_hidden_values(values[hand], table.get_mask(keys[hand]));
+        }
+
+        for (unsigned int kind = 27; kind < N_TILE_KINDS; kind++)
+        {
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+            {
+                n_tiles[hand] += hands[hand][kind];
+                values[hand] = combine_hidden_values(values[hand], get_honour_mask(hands[hand][kind]));
+            }
+        }
+
+        std::uint64_t bits = 0;
+        for (std::size_t hand = 0; hand < n_hands; hand++)
+            bits |= std::uint64_t(n_tiles[hand] == 14 && is_complete_value(values[hand])) << hand;
+        return bits;
+    }
+
+    /**
+     * @brief Gets the waits of a block of concealed hands (see get_concealed_wait_mask).
+     *
+     * Computes the suit keys and looks up their decompositions for all hands of the block before the waits of each
+     * hand, which only depend on its own decompositions and whose candidate lookups are independent of each other.
+     *
+     * @param hands The hands, hidden tile counts with at most four tiles per kind.
+     * @param n_hands The number of hands, at most BATCH_BLOCK_SIZE.
+     * @param wait_masks The n_hands wait masks receiving the results, 0 for hands not consisting of 13 tiles.
+     * @return Bit mask with bit i set if hand i consists of 13 tiles and has at least one wait.
+     */
+    inline std::uint64_t evaluate_tenpai_block(const Mahjong::Tile_counts *hands, std::size_t n_hands, std::uint64_t *wait_masks)
+    {
+        const Decomposition_table &table = Decomposition_table::get_instance();
+        std::array<std::array<std::uint32_t, BATCH_BLOCK_SIZE>, 3> keys;
+        std::array<std::array<std::uint16_t, BATCH_BLOCK_SIZE>, N_DECOMPOSITION_GROUPS> masks;
+        std::array<unsigned int, BATCH_BLOCK_SIZE> n_tiles;
+        n_tiles.fill(0);
+
+        for (unsigned int suit = 0; suit < 3; suit++)
+        {
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+            {
+                std::uint32_t key = 0;
+                unsigned int n_suit_tiles = 0;
+                for (unsigned int rank = 0; rank < N_SUIT_RANKS; rank++)
+                {
+                    key += hands[hand][suit * N_SUIT_RANKS + rank] * Decomposition_table::POWERS[rank];
+                    n_suit_tiles += hands[hand][suit * N_SUIT_RANKS + rank];
+                }
+                keys[suit][hand] = key;
+                n_tiles[hand] += n_suit_tiles;
+            }
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+                masks[suit][hand] = table.get_mask(keys[suit][hand]);
+        }
+        for (unsigned int honour = 0; honour < 7; honour++)
+        {
+            for (std::size_t hand = 0; hand < n_hands; hand++)
+            {
+                n_tiles[hand] += hands[hand][27 + honour];
+                masks[3 + honour][hand] = get_honour_mask(hands[hand][27 + honour]);
+            }
+        }
+
+        // The remaining steps of a hand only depend on its own masks, so they are run one hand after the other.
+        for (std::size_t hand = 0; hand < n_hands; hand++)
+        {
+            wait_masks[hand] = 0;
+            if (n_tiles[hand] != 13)
+                continue;
+
+            // Values of all groups but one, the prefix of the groups before it being shared.
+            std::array<std::uint64_t, N_DECOMPOSITION_GROUPS> others;
+            std::uint64_t prefix = std::uint64_t(1) << 16;
+            for (unsigned int group = 0; group < N_DECOMPOSITION_GROUPS; group++)
+            {
+                std::uint64_t values = prefix;
+                for (unsigned int other = group + 1; other < N_DECOMPOSITION_GROUPS && values != 0; other++)
+                    values = combine_hidden_values(values, masks[other][hand]);
+                others[group] = values;
+                prefix = combine_hidden_values(prefix, masks[group][hand]);
+            }
+
+            std::uint64_t wait_mask = 0;
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            {
+                if (hands[hand][kind] >= 4)
+                    continue;
+                unsigned int group = (kind < 27) ? kind / N_SUIT_RANKS : kind - 27 + 3;
+                if (others[group] == 0)
+                    continue;
+                std::uint16_t mask = (kind < 27) ? table.get_mask(keys[group][hand] + Decomposition_table::POWERS[kind % N_SUIT_RANKS]) : get_honour_mask(hands[hand][kind] + 1);
+                if (is_complete_value(combine_hidden_values(others[group], mask)))
+                    wait_mask |= std::uint64_t(1) << kind;
+            }
+            wait_masks[hand] = wait_mask;
+        }
+
+        std::uint64_t bits = 0;
+        for (std::size_t hand = 0; hand < n_hands; hand++)
+            bits |= std::uint64_t(wait_masks[hand] != 0) << hand;
+        return bits;
+    }
+
+    /**
+     * @brief Runs a function on each block of a batch of hands, splitting large batches over several threads.
+     *
+     * @tparam Block_function Callable taking the index of the first hand and the number of hands of a block.
+     * @param n_hands The number of hands.
+     * @param n_threads The maximal number of threads, including the calling one.
+     * @param evaluate_block The function to be run on each block.
+     */
+    template <class Block_function>
+    void for_each_hand_block(std::size_t n_hands, unsigned int n_threads, const Block_function &evaluate_block)
+    {
+        const std::size_t n_blocks = (n_hands + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+        const std::size_t n_used_threads = std::max<std::size_t>(1, std::min<std::size_t>(n_threads, n_hands / MIN_BATCH_HANDS_PER_THREAD));
+
+        auto evaluate_blocks = [&](std::size_t first_block, std::size_t last_block)
+        {
+            for (std::size_t block = first_block; block < last_block; block++)
+            {
+                std::size_t first_hand = block * BATCH_BLOCK_SIZE;
+                evaluate_block(first_hand, std::min<std::size_t>(BATCH_BLOCK_SIZE, n_hands - first_hand));
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t thread = 1; thread < n_used_threads; thread++)
+            threads.emplace_back(evaluate_blocks, n_blocks * thread / n_used_threads, n_blocks * (thread + 1) / n_used_threads);
+        evaluate_blocks(0, n_blocks / n_used_threads);
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    /**
+     * @brief Checks which hands of a batch of concealed hands are complete.
+     *
+     * @param hands The hands, hidden tile counts with at most four tiles per kind.
+     * @param n_hands The number of hands.
+     * @param complete_bits The (n_hands + 63) / 64 words receiving the results, bit i % 64 of word i / 64 being set
+     * if hand i consists of 14 tiles and is complete.
+     * @param n_threads The maximal number of threads used for large batches, including the calling one.
+     */
+    inline void evaluate_complete_hands(const Mahjong::Tile_counts *hands, std::size_t n_hands, std::uint64_t *complete_bits, unsigned int n_threads = 1)
+    {
+        for_each_hand_block(n_hands, n_threads, [&](std::size_t first_hand, std::size_t n_block_hands)
+                            { complete_bits[first_hand / BATCH_BLOCK_SIZE] = evaluate_complete_block(hands + first_hand, n_block_hands); });
+    }
+
+    /**
+     * @brief Checks which hands of a batch of concealed hands are tenpai, i.e. one tile short of a complete hand.
+     *
+     * @param hands The hands, hidden tile counts with at most four tiles per kind.
+     * @param n_hands The number of hands.
+     * @param tenpai_bits The (n_hands + 63) / 64 words receiving the results, bit i % 64 of word i / 64 being set
+     * if hand i consists of 13 tiles and has at least one wait.
+     * @param wait_masks The n_hands wait masks (see get_concealed_wait_mask) or nullptr if not needed.
+     * @param n_threads The maximal number of threads used for large batches, including the calling one.
+     */
+    inline void evaluate_tenpai_hands(const Mahjong::Tile_counts *hands, std::size_t n_hands, std::uint64_t *tenpai_bits, std::uint64_t *wait_masks = nullptr, unsigned int n_threads = 1)
+    {
+        for_each_hand_block(n_hands, n_threads, [&](std::size_t first_hand, std::size_t n_block_hands)
+                            {
+                                std::array<std::uint64_t, BATCH_BLOCK_SIZE> block_wait_masks;
+                                std::uint64_t *block_masks = (wait_masks != nullptr) ? wait_masks + first_hand : block_wait_masks.data();
+                                tenpai_bits[first_hand / BATCH_BLOCK_SIZE] = evaluate_tenpai_block(hands + first_hand, n_block_hands, block_masks); });
+    }
+} // namespace Mahjong
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <vector>
 
+#include "Logging.hpp"
 #include "Tile.hpp"
 
 /**
@@ -35,6 +36,14 @@ namespace Mahjong
          */
         Discard_pile() : tiles(){};
 
+        /**
+         * @brief Remove all tiles from the discard pile, keeping its storage.
+         */
+        void clear()
+        {
+            tiles.clear();
+        }
+
         /**
          * @brief Add a discarded tile to the discard pile.
          * @param tile The tile to be added to the discard pile.
@@ -46,17 +55,22 @@ namespace Mahjong
 
         /**
          * @brief Display the contents of the discard pile.
-         * Outputs the tiles in the discard pile to the console.
+         * Outputs the tiles in the discard pile to the log sink.
          */
         void display_discard_pile() const
         {
+            if (!Mahjong::is_log_enabled(Mahjong::Log_level::info) || tiles.empty())
+                return;
+
+            std::ostringstream display;
             unsigned int pile_size = tiles.size();
             for (size_t i = 0; i < pile_size - 1; i++)
             {
-                std::cout << tiles[i].get_tile_as_string() << " -- ";
+                display << tiles[i].get_tile_as_string() << " -- ";
             }
 
-            std::cout << tiles[pile_size - 1].get_tile_as_string() << std::endl;
+            display << tiles[pile_size - 1].get_tile_as_string() << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, display.str());
         }
 
         /**
@@ -83,6 +97,25 @@ namespace Mahjong
             return tiles.back();
         }
 
+        /**
+         * @brief Get the tiles of the discard pile, the latest discard being the last one.
+         * @return Reference to the discarded tiles.
+         */
+        const std::vector<Mahjong::Tile> &get_tiles() const
+        {
+            return tiles;
+        }
+
+        /**
+         * @brief Replace the tiles of the discard pile, reusing the storage of the pile.
+         * @param first Pointer to the first tile.
+         * @param last Pointer past the last tile, the latest discard.
+         */
+        void assign_tiles(const Mahjong::Tile *first, const Mahjong::Tile *last)
+        {
+            tiles.assign(first, last);
+        }
+
         /**
          * @brief Get the size of the discard pile.
          * @return The number of tiles in the discard pile.
@@ -96,5 +129,17 @@ namespace Mahjong
         {
             return std::count(tiles.begin(), tiles.end(), tile);
         }
+
+        /**
+         * @brief Count the tiles in the discard pile per tile kind.
+         * @return The number of discarded tiles per tile kind.
+         */
+        Mahjong::Tile_counts get_tile_counts() const
+        {
+            Mahjong::Tile_counts counts{};
+            for (const Mahjong::Tile &tile : tiles)
+                counts[tile.get_kind()] += 1;
+            return counts;
+        }
     };
 } // namespace Mahjong
\ No newline at end of file
@@ -0,0 +1,336 @@
+/**
+ * @file Environment.hpp
+ * @brief Defines the Vector_environment class, a step-based reinforcement-learning environment over a batch of games.
+ *
+ * One seat of every game is controlled by the caller (the agent), the other seats by the built-in policies. A call
+ * of step() applies one action per game and plays each game on until the agent's next decision, so that all games
+ * wait for an action at the same time. Observations, legal-action masks, rewards and done flags are written to
+ * contiguous buffers with one row per game, ready to be handed to a batched network.
+ */
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Action.hpp"
+#include "Game.hpp"
+#include "Logging.hpp"
+#include "Monte_carlo.hpp"
+#include "Observation.hpp"
+
+/** @brief Number of actions of the environment: a discard per tile kind, followed by the pickup actions. */
+const unsigned int N_ENVIRONMENT_ACTIONS = N_TILE_KINDS + Mahjong::N_PICKUP_ACTIONS;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Gets the environment action discarding a tile of the given kind.
+     */
+    constexpr int get_discard_environment_action(unsigned int kind)
+    {
+        return kind;
+    }
+
+    /**
+     * @brief Gets the environment action performing the given pickup action.
+     */
+    constexpr int get_pickup_environment_action(Mahjong::Pickup_action action)
+    {
+        return N_TILE_KINDS + static_cast<unsigned int>(action);
+    }
+
+    /**
+     * @brief Writes the legal environment actions of a decision as N_ENVIRONMENT_ACTIONS flags.
+     *
+     * @param hand The hand of the deciding player.
+     * @param decision The decision.
+     * @param mask The N_ENVIRONMENT_ACTIONS flags receiving the mask.
+     */
+    inline void write_environment_action_mask(const Mahjong::Hand &hand, const Mahjong::Decision &decision, unsigned char *mask)
+    {
+        std::fill(mask, mask + N_ENVIRONMENT_ACTIONS, 0);
+        for (int action : decision.available_actions)
+        {
+            if (decision.action_type == Mahjong::Action_type::discard)
+                mask[get_discard_environment_action(hand.get_tile_by_index(action).get_kind())] = 1;
+            else
+                mask[get_pickup_environment_action(static_cast<Mahjong::Pickup_action>(action))] = 1;
+        }
+    }
+
+    /**
+     * @brief Converts a legal environment action into an action of a decision (see Game::submit).
+     *
+     * A discard of a tile kind discards the first hidden tile of that kind.
+     *
+     * @param hand The hand of the deciding player.
+     * @param decision The decision.
+     * @param environment_action The environment action.
+     * @return The action of the decision, -1 if the environment action is not legal.
+     */
+    inline int get_decision_action(const Mahjong::Hand &hand, const Mahjong::Decision &decision, int environment_action)
+    {
+        for (int action : decision.available_actions)
+        {
+            if (decision.action_type == Mahjong::Action_type::discard)
+            {
+                if (get_discard_environment_action(hand.get_tile_by_index(action).get_kind()) == environment_action)
+                    return action;
+            }
+            else if (get_pickup_environment_action(static_cast<Mahjong::Pickup_action>(action)) == environment_action)
+                return action;
+        }
+        return -1;
+    }
+
+    /**
+     * @class Vector_environment
+     * @brief Steps a batch of games in lockstep, one seat of each game being controlled by the caller.
+     *
+     * Actions are encoded as indices in [0, N_ENVIRONMENT_ACTIONS): the discard of a hidden tile of kind k is
+     * action k, the pickup action p is action N_TILE_KINDS + p. The reward of a game is the agent's final score
+     * (as counted by the simulations) on the step finishing the game and zero otherwise. Finished games ignore
+     * their actions until they are reset. Every game is driven by its own random number generator, so the
+     * trajectories only depend on the seeds and the actions, not on the number of threads.
+     */
+    class Vector_environment
+    {
+    private:
+        unsigned int agent_seat;                  ///< The seat controlled by the caller.
+        unsigned int n_threads;                   ///< Maximal number of threads per call, 0 for all hardware threads.
+        std::vector<Mahjong::Game> games;         ///< The games, the agent's seat being external.
+        std::vector<float> observations;          ///< OBSERVATION_SIZE values per game (see Observation.hpp).
+        std::vector<unsigned char> action_masks;  ///< N_ENVIRONMENT_ACTIONS legal-action flags per game.
+        std::vector<float> rewards;               ///< Reward of the latest step per game.
+        std::vector<unsigned char> dones;         ///< Whether a game is finished, per game.
+
+        /**
+         * @brief Plays a game on until the agent has to decide or the game is finished (see Game::advance).
+         *
+         * @param index The index of the game.
+         */
+        void advance(unsigned int index)
+        {
+            Mahjong::Game &game = games[index];
+            game.advance();
+            if (!game.has_pending_decision())
+            {
+                rewards[index] = game.get_player_score(agent_seat, true, game.get_winner() == static_cast<int>(agent_seat));
+                dones[index] = 1;
+            }
+            write_outputs(index);
+        }
+
+        /**
+         * @brief Writes the observation and the legal-action mask of a game.
+         *
+         * @param index The index of the game.
+         */
+        void write_outputs(unsigned int index)
+        {
+            unsigned char *mask = action_masks.data() + index * N_ENVIRONMENT_ACTIONS;
+            float *observation = observations.data() + index * OBSERVATION_SIZE;
+            if (dones[index])
+            {
+                std::fill(mask, mask + N_ENVIRONMENT_ACTIONS, 0);
+                std::fill(observation, observation + OBSERVATION_SIZE, 0.0f);
+                return;
+            }
+
+            const Mahjong::Game &game = games[index];
+            Mahjong::Decision decision = game.pending_decision();
+            encode_observation(game.get_game_state_for_player(agent_seat), decision.action_type, observation);
+            write_environment_action_mask(game.get_player_hand(agent_seat), decision, mask);
+        }
+
+        /**
+         * @brief Applies the agent's action to a game waiting for it and plays on until the next decision.
+         *
+         * @param index The index of the game.
+         * @param action The environment action, it has to be legal.
+         */
+        void apply_action(unsigned int index, int action)
+        {
+            rewards[index] = 0;
+            if (dones[index])
+                return;
+            assert(action >= 0 && action < static_cast<int>(N_ENVIRONMENT_ACTIONS) && action_masks[index * N_ENVIRONMENT_ACTIONS + action]);
+
+            Mahjong::Game &game = games[index];
+            game.submit(get_decision_action(game.get_player_hand(agent_seat), game.pending_decision(), action));
+            advance(index);
+        }
+
+        /**
+         * @brief Calls a function for every game, distributing the games over the threads of the shared pool.
+         *
+         * @param function The function called with the index of each game.
+         */
+        template <typename Function>
+        void for_each_game(const Function &function)
+        {
+            std::atomic<unsigned int> next_index(0);
+            auto task = [&]()
+            {
+                Mahjong::Null_sink null_sink;
+                Mahjong::Scoped_log_sink silence(null_sink);
+                for (unsigned int index = next_index++; index < games.size(); index = next_index++)
+                    function(index);
+            };
+            unsigned int threads = (n_threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : n_threads;
+            if (threads == 1 || games.size() == 1)
+                task();
+            else
+                Mahjong::Rollout_pool::get_instance().run(threads, task);
+        }
+
+    public:
+        /**
+         * @brief Constructor for the Vector_environment class.
+         *
+         * The games need to be reset before the first step.
+         *
+         * @param n_games Number of games stepped in lockstep.
+         * @param policies Policy per seat, the policy of the agent's seat is ignored.
+         * @param agent_seat_in The seat controlled by the caller.
+         * @param n_threads_in Maximal number of threads per call, 0 for all hardware threads.
+         */
+        Vector_environment(unsigned int n_games, const std::array<Mahjong::Policy_type, 4> &policies, unsigned int agent_seat_in = 0, unsigned int n_threads_in = 1)
+            : agent_seat(agent_seat_in), n_threads(n_threads_in), observations(n_games * OBSERVATION_SIZE, 0.0f),
+              action_masks(n_games * N_ENVIRONMENT_ACTIONS, 0), rewards(n_games, 0.0f), dones(n_games, 1)
+        {
+            assert(agent_seat < N_PLAYERS);
+            Mahjong::Null_sink null_sink;
+            Mahjong::Scoped_log_sink silence(null_sink);
+            games.reserve(n_games);
+            for (unsigned int index = 0; index < n_games; index++)
+            {
+                games.emplace_back(index);
+                for (unsigned int seat = 0; seat < N_PLAYERS; seat++)
+                    games.back().set_player_policy(seat, (seat == agent_seat) ? Mahjong::Policy_type::random : policies[seat]);
+                games.back().set_external_player(agent_seat, true);
+            }
+        }
+
+        /**
+         * @brief Gets the number of games.
+         */
+        unsigned int get_n_games() const
+        {
+            return games.size();
+        }
+
+        /**
+         * @brief Resets a game and plays it until the agent's first decision.
+         *
+         * @param index The index of the game.
+         * @param seed The seed of the game.
+         */
+        void reset_game(unsigned int index, std::uint64_t seed)
+        {
+            Mahjong::Null_sink null_sink;
+            Mahjong::Scoped_log_sink silence(null_sink);
+            Mahjong::Game &game = games[index];
+            game.reset(seed);
+            game.set_current_player(game.get_rng().bounded(N_PLAYERS));
+            rewards[index] = 0;
+            dones[index] = 0;
+            advance(index);
+        }
+
+        /**
+         * @brief Resets all games and plays them until the agent's first decision.
+         *
+         * @param seeds One seed per game.
+         */
+        void reset(const std::vector<std::uint64_t> &seeds)
+        {
+            assert(seeds.size() == games.size());
+            for_each_game([&](unsigned int index)
+                          { reset_game(index, seeds[index]); });
+        }
+
+        /**
+         * @brief Applies one action per game and plays every game on until the agent's next decision.
+         *
+         * @param actions One environment action per game, ignored for finished games.
+         */
+        void step(const std::vector<int> &actions)
+        {
+            assert(actions.size() == games.size());
+            for_each_game([&](unsigned int index)
+                          { apply_action(index, actions[index]); });
+        }
+
+        /**
+         * @brief Gets the observations, OBSERVATION_SIZE values per game (see Observation.hpp).
+         */
+        const float *get_observations() const
+        {
+            return observations.data();
+        }
+
+        /**
+         * @brief Encodes the observations of all games into a caller-provided block, e.g. of std::uint8_t values.
+         *
+         * The rows of finished games are zero.
+         *
+         * @tparam Value The type of the values.
+         * @param block The get_n_games() * OBSERVATION_SIZE values receiving the observations.
+         */
+        template <typename Value>
+        void encode_observations(Value *block) const
+        {
+            for (unsigned int index = 0; index < games.size(); index++)
+            {
+                Value *observation = block + index * OBSERVATION_SIZE;
+                if (dones[index])
+                    std::fill(observation, observation + OBSERVATION_SIZE, Value(0));
+                else
+                    encode_observation(games[index].get_game_state_for_player(agent_seat), games[index].pending_decision().action_type, observation);
+            }
+        }
+
+        /**
+         * @brief Gets the legal-action masks, N_ENVIRONMENT_ACTIONS flags per game, all zero for finished games.
+         */
+        const unsigned char *get_action_masks() const
+        {
+            return action_masks.data();
+        }
+
+        /**
+         * @brief Gets the rewards of the latest step, one per game.
+         */
+        const float *get_rewards() const
+        {
+            return rewards.data();
+        }
+
+        /**
+         * @brief Gets the done flags, one per game.
+         */
+        const unsigned char *get_dones() const
+        {
+            return dones.data();
+        }
+
+        /**
+         * @brief Gets a game, e.g. to display it.
+         *
+         * @param index The index of the game.
+         * @return Reference to the game.
+         */
+        const Mahjong::Game &get_game(unsigned int index) const
+        {
+            return games[index];
+        }
+    };
+} // namespace Mahjong
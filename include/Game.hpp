@@ -5,19 +5,24 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <tuple>
 
+#include "Logging.hpp"
+#include "Random.hpp"
 #include "Set.hpp"
 #include "State.hpp"
 #include "Player.hpp"
 #include "Discard_pile.hpp"
+#include "Game_recorder.hpp"
+#include "Game_snapshot.hpp"
 #include "Wind.hpp"
 
 /** @brief Number of players per game. */
-unsigned int N_PLAYERS = 4;
+inline constexpr unsigned int N_PLAYERS = 4;
 
 /**
  * @namespace Mahjong
@@ -25,6 +30,28 @@ unsigned int N_PLAYERS = 4;
  */
 namespace Mahjong
 {
+    /**
+     * @brief Progress of a game between two decisions (see Game::advance).
+     */
+    enum class Game_phase
+    {
+        turn,     ///< The current player draws and discards.
+        claims,   ///< The players are asked for pickup actions for the current player's discard.
+        discard,  ///< An external current player has to discard.
+        pickup,   ///< An external player has to decide about claiming the latest discard.
+        finished, ///< The game is over.
+    };
+
+    /**
+     * @brief A decision a game waits for (see Game::pending_decision).
+     */
+    struct Decision
+    {
+        unsigned int player_number;                  ///< Index of the deciding player.
+        Mahjong::Action_type action_type;            ///< The type of the decision.
+        Mahjong::Action_list<int> available_actions; ///< Tile indices for discards, Pickup_action values for pickups.
+    };
+
     /**
      * @class Game
      * @brief Represents a Mahjong game with players, a set of tiles, and a discard pile.
@@ -41,32 +68,171 @@ namespace Mahjong
         unsigned int current_player; ///< Index of the current player taking their turn.
         int n_rounds;                ///< Number of rounds completed in the game.
         Mahjong::Wind round_wind;    ///< Current round wind
+        Mahjong::Rng rng;            ///< Random number generator used for all random decisions of the game.
+        Mahjong::Tile_counts seen_counts{}; ///< Number of visible tiles (discarded or revealed) per tile kind.
+        Mahjong::Game_recorder *recorder = nullptr; ///< Receiver of the game events, nullptr if the game is not recorded.
+        Mahjong::Game_phase phase = Mahjong::Game_phase::turn; ///< Progress of the game between two decisions.
+        std::array<bool, N_PLAYERS> external_players = {};    ///< Whether the decisions of a player are submitted by the driver.
+        std::array<Mahjong::Pickup_action, N_PLAYERS> claim_actions = {}; ///< Pickup actions chosen for the latest discard.
+        unsigned int next_claimant = 0; ///< Index of the next player to be asked for a pickup action.
+        int winner = -1;                ///< Index of the winning player, -1 if nobody won (yet).
+        bool win_by_discard = false;    ///< Whether the winner completed the hand with a claimed discard.
+
+        /**
+         * @brief Updates the visible tile counts after a player changed the discard pile or revealed tiles.
+         *
+         * @param player_number Index of the player.
+         * @param revealed_before The player's revealed tile counts before the change.
+         * @param pile_kind The kind of the tile added to or taken from the discard pile.
+         * @param pile_change The change of the discard pile, +1 for a discard and -1 for a claim.
+         */
+        void update_seen_counts(unsigned int player_number, const Mahjong::Tile_counts &revealed_before, unsigned int pile_kind, int pile_change)
+        {
+            const Mahjong::Tile_counts &revealed_after = players[player_number].get_hand().get_revealed_counts();
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+                seen_counts[kind] += revealed_after[kind] - revealed_before[kind];
+            seen_counts[pile_kind] += pile_change;
+        }
+
+        /**
+         * @brief Starts asking for pickup actions for the current player's discard, or ends a game without tiles.
+         */
+        void begin_claims()
+        {
+            if (set.get_size() == 0)
+            {
+                finish();
+                phase = Mahjong::Game_phase::finished;
+                return;
+            }
+            claim_actions.fill(Mahjong::Pickup_action::none);
+            next_claimant = 0;
+            phase = Mahjong::Game_phase::claims;
+        }
+
+        /**
+         * @brief Ends the game with a winning hand.
+         *
+         * @param player_number Index of the winning player.
+         * @param by_discard Whether the hand was completed with a claimed discard.
+         */
+        void end_with_win(unsigned int player_number, bool by_discard)
+        {
+            winner = player_number;
+            win_by_discard = by_discard;
+            phase = Mahjong::Game_phase::finished;
+        }
+
+        /**
+         * @brief Asks the remaining players for pickup actions and performs the prioritized one.
+         *
+         * Stops at the first external player who may claim the discard, which continues once its action is
+         * submitted. As in pickup_action, only players holding a claim are asked, external players only if one
+         * of their pickup actions is available.
+         */
+        void resolve_claims()
+        {
+            const std::uint64_t discard_bit = std::uint64_t(1) << discard_pile.back().get_kind();
+            for (; next_claimant < N_PLAYERS; next_claimant++)
+            {
+                bool include_chows = (next_claimant == (current_player + 1) % N_PLAYERS);
+                if (next_claimant == current_player || (players[next_claimant].get_hand().get_claim_mask(include_chows) & discard_bit) == 0)
+                    continue;
+                if (external_players[next_claimant])
+                {
+                    // The claim mask is a superset of the legal claims, only ask for an actual choice.
+                    if (get_available_pickup_actions(next_claimant).empty())
+                        continue;
+                    phase = Mahjong::Game_phase::pickup;
+                    return;
+                }
+                claim_actions[next_claimant] = player_choose_pickup_action(next_claimant, current_player);
+            }
+
+            std::tuple<int, Mahjong::Pickup_action> pickup_tuple = prioritize_pickup_action(claim_actions);
+            Mahjong::Pickup_action action = std::get<1>(pickup_tuple);
+            if (action == Mahjong::Pickup_action::none)
+            {
+                current_player = (current_player + 1) % N_PLAYERS;
+                phase = Mahjong::Game_phase::turn;
+                return;
+            }
+
+            current_player = std::get<0>(pickup_tuple);
+            MAHJONG_LOG(Mahjong::Log_level::info, "Player " << current_player << " performs " << Mahjong::to_string(action) << ".\n");
+            player_pick_from_discard(current_player, action);
+            player_has_winning_hand(current_player);
+            if (!running)
+                end_with_win(current_player, true);
+            else if (external_players[current_player])
+                phase = Mahjong::Game_phase::discard;
+            else
+            {
+                player_discard(current_player);
+                begin_claims();
+            }
+        }
 
     public:
         /**
          * @brief Constructor for the Game class.
          *
          * @param id_in Unique identifier for the game.
+         * @param seed Seed of the game's random number generator.
          */
-        Game(int id_in) : id(id_in), running(true), current_player(0), n_rounds(0), round_wind(0)
+        Game(int id_in, std::uint64_t seed = 0) : id(id_in), running(true), current_player(0), n_rounds(0), round_wind(0), rng(seed)
         {
-            std::cout << "Initiated Game with ID " << id << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "Initiated Game with ID " << id << "\n");
 
             discard_pile = Discard_pile();
+            seen_counts.fill(0);
 
             set = Mahjong::Set();
-            set.shuffle();
+            set.shuffle(rng);
 
             players = {};
             for (size_t player_number = 0; player_number < N_PLAYERS; player_number++)
             {
                 players.push_back(Player(player_number, set));
                 scores.push_back(0);
-                std::cout << "Initiated Player " << player_number << "\n";
+                MAHJONG_LOG(Mahjong::Log_level::info, "Initiated Player " << player_number << "\n");
             }
 
-            std::cout
-                << "Number of tiles in set: " << set.get_size() << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "Number of tiles in set: " << set.get_size() << "\n");
+        }
+
+        /**
+         * @brief Refills and shuffles the set, clears the discard pile and deals new hands, reusing their storage.
+         *
+         * The players keep their policies.
+         *
+         * @param n_seat_rotations The number of rotations of the seat winds from their initial assignment.
+         */
+        void deal(int n_seat_rotations)
+        {
+            set.refill();
+            set.shuffle(rng);
+            deal_hands(n_seat_rotations);
+        }
+
+        /**
+         * @brief Clears the discard pile and deals new hands from the current set, reusing their storage.
+         *
+         * @param n_seat_rotations The number of rotations of the seat winds from their initial assignment.
+         */
+        void deal_hands(int n_seat_rotations)
+        {
+            discard_pile.clear();
+            seen_counts.fill(0);
+            phase = Mahjong::Game_phase::turn;
+            winner = -1;
+            win_by_discard = false;
+
+            if (recorder != nullptr)
+                recorder->record_start(set.get_tiles());
+
+            for (unsigned int player_number = 0; player_number < N_PLAYERS; player_number++)
+                players[player_number].reset(set, Mahjong::Wind((player_number + 3 * n_seat_rotations) % 4));
         }
 
         /**
@@ -74,53 +240,174 @@ namespace Mahjong
          */
         void next_round()
         {
-            std::cout << "Start round " << n_rounds << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "Start round " << n_rounds << "\n");
             running = true;
             n_rounds += 1;
             round_wind = Mahjong::Wind(n_rounds % 4);
             current_player = n_rounds % 4;
+            deal(n_rounds);
+        }
 
-            discard_pile = Mahjong::Discard_pile();
+        /**
+         * @brief Resets the game to its initial state, keeping the policies of the players.
+         */
+        void reset()
+        {
+            MAHJONG_LOG(Mahjong::Log_level::info, "Reset Game with ID " << id << "\n");
 
-            set = Mahjong::Set();
-            set.shuffle();
+            running = true;
+            current_player = 0;
+            deal(0);
+            for (unsigned int player_number = 0; player_number < N_PLAYERS; player_number++)
+                MAHJONG_LOG(Mahjong::Log_level::info, "Initiated Player " << player_number << "\n");
 
-            players = {};
-            for (size_t player_number = 0; player_number < N_PLAYERS; player_number++)
-            {
-                Mahjong::Player new_player = Player(player_number, set);
-                for (int i = 0; i < n_rounds; i++)
-                {
-                    new_player.rotate_seat_wind();
-                }
-                players.push_back(new_player);
-            }
+            MAHJONG_LOG(Mahjong::Log_level::info, "Number of tiles in set: " << set.get_size() << "\n");
         }
 
         /**
-         * @brief Resets the game to its initial state.
+         * @brief Resets the game to its initial state after reseeding the random number generator.
+         *
+         * Games reset with the same seed (and the same player policies) are played identically.
+         *
+         * @param seed The new seed of the game's random number generator.
          */
-        void reset()
+        void reset(std::uint64_t seed)
         {
-            std::cout << "Reset Game with ID " << id << "\n";
+            rng.seed(seed);
+            reset();
+        }
 
+        /**
+         * @brief Resets the game like reset(), but deals from the given set instead of a shuffled one.
+         *
+         * Used to replay recorded games (see Game_record.hpp).
+         *
+         * @param first Pointer to the first tile of the set.
+         * @param last Pointer past the last tile of the set, which is drawn first.
+         */
+        void reset_with_wall(const Mahjong::Tile *first, const Mahjong::Tile *last)
+        {
             running = true;
             current_player = 0;
+            set.assign_tiles(first, last);
+            deal_hands(0);
+        }
 
-            discard_pile = Mahjong::Discard_pile();
+        /**
+         * @brief Resets the game like reset(seed), but deals from the given set instead of a shuffled one.
+         *
+         * Games reset with the same set and seed (and the same player policies) are played identically, which
+         * lets duplicate simulations play one deal with rotated policies (see Simulation_runner::set_duplicate).
+         *
+         * @param first Pointer to the first tile of the set.
+         * @param last Pointer past the last tile of the set, which is drawn first.
+         * @param seed The new seed of the game's random number generator.
+         */
+        void reset_with_wall(const Mahjong::Tile *first, const Mahjong::Tile *last, std::uint64_t seed)
+        {
+            rng.seed(seed);
+            reset_with_wall(first, last);
+        }
 
-            set = Mahjong::Set();
-            set.shuffle();
+        /**
+         * @brief Sets the receiver of the events of the game, e.g. a Game_record_writer.
+         *
+         * @param recorder_in The recorder, which must outlive its use, or nullptr to stop recording.
+         */
+        void set_recorder(Mahjong::Game_recorder *recorder_in)
+        {
+            recorder = recorder_in;
+        }
 
-            players = {};
-            for (size_t player_number = 0; player_number < N_PLAYERS; player_number++)
+        /**
+         * @brief Stores the complete state of the game in a snapshot.
+         *
+         * @param snapshot The snapshot receiving the game.
+         */
+        void snapshot(Mahjong::Game_snapshot &snapshot) const
+        {
+            assert(players.size() == snapshot.players.size());
+            const std::vector<Mahjong::Tile> &wall = set.get_tiles();
+            std::copy(wall.begin(), wall.end(), snapshot.wall.begin());
+            snapshot.wall_size = static_cast<unsigned char>(wall.size());
+            const std::vector<Mahjong::Tile> &discards = discard_pile.get_tiles();
+            std::copy(discards.begin(), discards.end(), snapshot.discards.begin());
+            snapshot.n_discards = static_cast<unsigned char>(discards.size());
+
+            for (size_t i = 0; i < players.size(); i++)
             {
-                players.push_back(Player(player_number, set));
-                std::cout << "Initiated Player " << player_number << "\n";
+                players[i].save_snapshot(snapshot.players[i]);
+                snapshot.scores[i] = scores[i];
+            }
+            snapshot.seen_counts = seen_counts;
+            snapshot.rng_state = rng.get_state();
+            snapshot.id = id;
+            snapshot.running = running;
+            snapshot.current_player = current_player;
+            snapshot.n_rounds = n_rounds;
+            snapshot.round_wind = round_wind.get_wind();
+            snapshot.phase = static_cast<int>(phase);
+            snapshot.external_players = external_players;
+            snapshot.claim_actions = claim_actions;
+            snapshot.next_claimant = next_claimant;
+            snapshot.winner = winner;
+            snapshot.win_by_discard = win_by_discard;
+        }
+
+        /**
+         * @brief Takes a snapshot of the complete state of the game.
+         *
+         * @return The snapshot, which can be copied with a single memcpy and restored with restore().
+         */
+        Mahjong::Game_snapshot snapshot() const
+        {
+            Mahjong::Game_snapshot game_snapshot;
+            snapshot(game_snapshot);
+            return game_snapshot;
+        }
+
+        /**
+         * @brief Restores the game from a snapshot.
+         *
+         * The state of the snapshot's game is copied into the existing storage of this game, so restoring does not
+         * allocate once the hands, set and discard pile reached their capacity. Games restored from the same snapshot
+         * continue identically, including a game suspended at a decision (see advance).
+         *
+         * @param snapshot The snapshot to be restored.
+         */
+        void restore(const Mahjong::Game_snapshot &snapshot)
+        {
+            assert(players.size() == snapshot.players.size());
+            set.assign_tiles(snapshot.wall.data(), snapshot.wall.data() + snapshot.wall_size);
+            discard_pile.assign_tiles(snapshot.discards.data(), snapshot.discards.data() + snapshot.n_discards);
+            for (size_t i = 0; i < players.size(); i++)
+            {
+                players[i].restore_snapshot(snapshot.players[i]);
+                scores[i] = snapshot.scores[i];
             }
+            seen_counts = snapshot.seen_counts;
+            rng.set_state(snapshot.rng_state);
+            id = snapshot.id;
+            running = snapshot.running;
+            current_player = snapshot.current_player;
+            n_rounds = snapshot.n_rounds;
+            round_wind = Mahjong::Wind(snapshot.round_wind);
+            phase = static_cast<Mahjong::Game_phase>(snapshot.phase);
+            external_players = snapshot.external_players;
+            claim_actions = snapshot.claim_actions;
+            next_claimant = snapshot.next_claimant;
+            winner = snapshot.winner;
+            win_by_discard = snapshot.win_by_discard;
+        }
 
-            std::cout
-                << "Number of tiles in set: " << set.get_size() << "\n";
+        /**
+         * @brief Gets the random number generator of the game.
+         *
+         * @return Reference to the random number generator.
+         */
+        Mahjong::Rng &get_rng()
+        {
+            return rng;
         }
 
         /**
@@ -164,6 +451,8 @@ namespace Mahjong
         {
             Player &player = players[player_number];
             player.sort_player_hand();
+            if (recorder != nullptr)
+                recorder->record_sort(player_number);
         }
 
         /**
@@ -176,6 +465,8 @@ namespace Mahjong
         {
             Player &player = players[player_number];
             player.draw_tile(set, broadcast);
+            if (recorder != nullptr)
+                recorder->record_draw(player_number);
         }
 
         /**
@@ -184,12 +475,36 @@ namespace Mahjong
          * @param player_number Index of the player.
          * @param action Type of action (kong, pong, chow).
          */
-        void player_pick_from_discard(unsigned int player_number, std::string action)
+        void player_pick_from_discard(unsigned int player_number, Mahjong::Pickup_action action)
         {
             Player &player = players[player_number];
             Mahjong::Tile tile_to_pickup = discard_pile.back();
+            Mahjong::Tile_counts revealed_before = player.get_hand().get_revealed_counts();
+            player.pick_tile_from_discard(discard_pile);
+            std::uint32_t hidden_before = player.get_hand().get_hidden_mask();
+            player.reveal_combination(tile_to_pickup, action, rng);
+            update_seen_counts(player_number, revealed_before, tile_to_pickup.get_kind(), -1);
+            if (recorder != nullptr)
+                recorder->record_claim(player_number, action, hidden_before & ~player.get_hand().get_hidden_mask());
+        }
+
+        /**
+         * @brief Picks up the latest discard and reveals the given tiles, e.g. to replay a recorded claim.
+         *
+         * @param player_number Index of the player.
+         * @param action Type of action (kong, pong, chow).
+         * @param revealed_mask The tiles to be revealed, bit i standing for index i of the hand after the pickup.
+         */
+        void player_claim_from_discard(unsigned int player_number, Mahjong::Pickup_action action, std::uint32_t revealed_mask)
+        {
+            Player &player = players[player_number];
+            unsigned int pile_kind = discard_pile.back().get_kind();
+            Mahjong::Tile_counts revealed_before = player.get_hand().get_revealed_counts();
             player.pick_tile_from_discard(discard_pile);
-            player.reveal_combination(tile_to_pickup, action);
+            player.reveal_tiles(revealed_mask);
+            update_seen_counts(player_number, revealed_before, pile_kind, -1);
+            if (recorder != nullptr)
+                recorder->record_claim(player_number, action, revealed_mask);
         }
 
         /**
@@ -200,7 +515,30 @@ namespace Mahjong
         void player_discard(unsigned int player_number)
         {
             Player &player = players[player_number];
-            player.discard_tile(discard_pile, get_game_state_for_player(player_number));
+            Mahjong::Tile_counts revealed_before = player.get_hand().get_revealed_counts();
+            int index = player.discard_tile(discard_pile, get_game_state_for_player(player_number), rng);
+            if (index >= 0)
+            {
+                update_seen_counts(player_number, revealed_before, discard_pile.back().get_kind(), 1);
+                if (recorder != nullptr)
+                    recorder->record_discard(player_number, index);
+            }
+        }
+
+        /**
+         * @brief Simulates a player discarding the tile at the given index instead of the tile chosen by its policy.
+         *
+         * @param player_number Index of the player.
+         * @param index Index of the hidden tile to be discarded.
+         */
+        void player_discard_by_index(unsigned int player_number, int index)
+        {
+            Player &player = players[player_number];
+            Mahjong::Tile_counts revealed_before = player.get_hand().get_revealed_counts();
+            player.discard_tile_by_index(discard_pile, index);
+            update_seen_counts(player_number, revealed_before, discard_pile.back().get_kind(), 1);
+            if (recorder != nullptr)
+                recorder->record_discard(player_number, index);
         }
 
         /**
@@ -210,39 +548,34 @@ namespace Mahjong
          * @param current_player Index of the current player.
          * @return The chosen pickup action.
          */
-        std::string player_choose_pickup_action(unsigned int player_number, unsigned int current_player)
+        Mahjong::Pickup_action player_choose_pickup_action(unsigned int player_number, unsigned int current_player)
         {
             Player &player = players[player_number];
-            return player.choose_pickup_action(discard_pile, current_player, get_game_state_for_player(player_number));
+            return player.choose_pickup_action(discard_pile, current_player, get_game_state_for_player(player_number), rng);
         }
 
         /**
          * @brief Prioritizes the pickup actions of all players and returns the highest priority action.
          *
-         * The priority is kong, pong, and at last chow.
+         * The priority is kong, pong, and at last chow. Ties are resolved in favour of the lower player index.
          *
-         * @param player_actions Vector containing pickup actions of all players.
+         * @param player_actions Array containing pickup actions of all players.
          *
          * @return A tuple containing the index and type of the highest priority action.
          */
-        std::tuple<int, std::string> prioritize_pickup_action(std::vector<std::string> player_actions)
+        std::tuple<int, Mahjong::Pickup_action> prioritize_pickup_action(const std::array<Mahjong::Pickup_action, 4> &player_actions) const
         {
-            auto index = std::find(player_actions.begin(), player_actions.end(), "kong") - player_actions.begin();
-            if (index < player_actions.size())
-            {
-                return std::make_tuple(static_cast<int>(index), "kong");
-            }
-            index = std::find(player_actions.begin(), player_actions.end(), "pong") - player_actions.begin();
-            if (index < player_actions.size())
-            {
-                return std::make_tuple(static_cast<int>(index), "pong");
-            }
-            index = std::find(player_actions.begin(), player_actions.end(), "chow") - player_actions.begin();
-            if (index < player_actions.size())
+            int index = -1;
+            Mahjong::Pickup_action action = Mahjong::Pickup_action::none;
+            for (size_t i = 0; i < player_actions.size(); i++)
             {
-                return std::make_tuple(static_cast<int>(index), "chow");
+                if (player_actions[i] > action)
+                {
+                    index = i;
+                    action = player_actions[i];
+                }
             }
-            return std::make_tuple(-1, "none");
+            return std::make_tuple(index, action);
         }
 
         /**
@@ -250,30 +583,27 @@ namespace Mahjong
          *
          * Evaluates all available pickup actions for all players. After the players chose with
          * which action they wish to proceed, the priority of the chosen actions is determined.
-         * Returns a tuple containing the player number and the action (as string) of the prioritized
+         * Returns a tuple containing the player number and the action of the prioritized
          * action.
          *
          * @param current_player Index of the current player.
          *
          * @return A tuple containing the player number and type of the determined pickup action.
          */
-        std::tuple<int, std::string> pickup_action(unsigned int current_player)
+        std::tuple<int, Mahjong::Pickup_action> pickup_action(unsigned int current_player)
         {
-            std::vector<std::string> player_actions = {};
+            std::array<Mahjong::Pickup_action, 4> player_actions = {};
+            const std::uint64_t discard_bit = std::uint64_t(1) << discard_pile.back().get_kind();
             for (size_t i = 0; i < players.size(); i++)
             {
-                if (i == current_player) // Players can't pick up tiles they discarded themself.
-                {
-                    player_actions.push_back("none");
-                }
+                // Players can't pick up tiles they discarded themself, and players without a claim are not asked.
+                bool include_chows = (i == (current_player + 1) % players.size());
+                if (i == current_player || (players[i].get_hand().get_claim_mask(include_chows) & discard_bit) == 0)
+                    player_actions[i] = Mahjong::Pickup_action::none;
                 else
-                {
-                    std::string player_action = player_choose_pickup_action(i, current_player);
-                    player_actions.push_back(player_action);
-                }
+                    player_actions[i] = player_choose_pickup_action(i, current_player);
             }
-            std::tuple<int, std::string> pickup_tuple = prioritize_pickup_action(player_actions);
-            return pickup_tuple;
+            return prioritize_pickup_action(player_actions);
         }
 
         /**
@@ -290,7 +620,9 @@ namespace Mahjong
             Player &player = players[player_number];
             if (player.has_winning_hand())
             {
-                std::cout << "Player " << player_number << " has a winning hand. Congratulations.\n";
+                if (recorder != nullptr)
+                    recorder->record_win(player_number);
+                MAHJONG_LOG(Mahjong::Log_level::info, "Player " << player_number << " has a winning hand. Congratulations.\n");
                 player.display_player_score(round_wind, true, true);
                 running = false;
             }
@@ -355,6 +687,177 @@ namespace Mahjong
                 player_discard(player_number);
         }
 
+        /**
+         * @brief Plays the game on until a decision of an external player is pending or the game is finished.
+         *
+         * Follows the turn order of the simulations: the current player draws and, unless the hand is winning,
+         * discards. The discard is claimed by the player with the highest priority pickup, otherwise the next player
+         * takes a turn. The game ends with a winning hand or once a discard leaves no tiles in the set. Decisions of
+         * players which are not external are made by their policies right away, so a game without external players
+         * is played to its end.
+         */
+        void advance()
+        {
+            while (phase == Mahjong::Game_phase::turn || phase == Mahjong::Game_phase::claims)
+            {
+                if (phase == Mahjong::Game_phase::claims)
+                {
+                    resolve_claims();
+                    continue;
+                }
+
+                MAHJONG_LOG(Mahjong::Log_level::info, "Player " << current_player << "'s turn (" << players[current_player].get_seat_wind().get_wind_as_string() << "):\n");
+                player_draw(current_player, false);
+                sort_player_hand(current_player);
+                display_visible_player_hand(current_player);
+                display_player_score(current_player, false, false);
+                player_has_winning_hand(current_player);
+                if (!running)
+                    end_with_win(current_player, false);
+                else if (external_players[current_player])
+                    phase = Mahjong::Game_phase::discard;
+                else
+                {
+                    player_discard(current_player);
+                    begin_claims();
+                }
+            }
+        }
+
+        /**
+         * @brief Checks whether the game waits for a decision of an external player (see pending_decision).
+         *
+         * @return True if a decision is pending, false if the game is finished or has to be advanced.
+         */
+        bool has_pending_decision() const
+        {
+            return phase == Mahjong::Game_phase::discard || phase == Mahjong::Game_phase::pickup;
+        }
+
+        /**
+         * @brief Gets the decision the game waits for, which has to be pending (see has_pending_decision).
+         *
+         * Discards offer the indices of the hidden tiles, pickups the available pickup actions followed by none.
+         *
+         * @return The pending decision.
+         */
+        Mahjong::Decision pending_decision() const
+        {
+            assert(has_pending_decision());
+            if (phase == Mahjong::Game_phase::discard)
+                return {current_player, Mahjong::Action_type::discard, players[current_player].get_hand().get_valid_discards()};
+
+            Mahjong::Decision decision = {next_claimant, Mahjong::Action_type::pickup, {}};
+            for (Mahjong::Pickup_action action : get_available_pickup_actions(next_claimant))
+                decision.available_actions.push_back(static_cast<int>(action));
+            decision.available_actions.push_back(static_cast<int>(Mahjong::Pickup_action::none));
+            return decision;
+        }
+
+        /**
+         * @brief Applies the action of the pending decision. The game continues with the next call of advance().
+         *
+         * @param action One of the available actions of the pending decision.
+         * @return True if the action was applied, false if no decision is pending or the action is not available.
+         */
+        bool submit(int action)
+        {
+            if (!has_pending_decision())
+                return false;
+            const Mahjong::Action_list<int> available_actions = pending_decision().available_actions;
+            if (std::find(available_actions.begin(), available_actions.end(), action) == available_actions.end())
+                return false;
+
+            if (phase == Mahjong::Game_phase::discard)
+            {
+                player_discard_by_index(current_player, action);
+                begin_claims();
+            }
+            else
+            {
+                claim_actions[next_claimant] = static_cast<Mahjong::Pickup_action>(action);
+                next_claimant += 1;
+                phase = Mahjong::Game_phase::claims;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Gets the progress of the game between two decisions.
+         *
+         * @return The phase of the game.
+         */
+        Mahjong::Game_phase get_phase() const
+        {
+            return phase;
+        }
+
+        /**
+         * @brief Gets the winner of a game played with advance().
+         *
+         * @return The index of the winning player, or -1 if nobody won (yet).
+         */
+        int get_winner() const
+        {
+            return winner;
+        }
+
+        /**
+         * @brief Checks whether the winner of a game played with advance() completed the hand with a claimed discard.
+         *
+         * @return True for a win by a claimed discard, false for a self-drawn win or if nobody won.
+         */
+        bool is_win_by_discard() const
+        {
+            return win_by_discard;
+        }
+
+        /**
+         * @brief Sets whether the decisions of a player are submitted by the driver instead of its policy.
+         *
+         * The game then suspends at the player's decisions (see advance) instead of blocking, e.g. on console input.
+         *
+         * @param player_number Index of the player.
+         * @param external True if the player's decisions are submitted by the driver.
+         */
+        void set_external_player(unsigned int player_number, bool external)
+        {
+            external_players[player_number] = external;
+        }
+
+        /**
+         * @brief Checks whether the decisions of a player are submitted by the driver.
+         *
+         * @param player_number Index of the player.
+         * @return True if the player is external.
+         */
+        bool is_external_player(unsigned int player_number) const
+        {
+            return external_players[player_number];
+        }
+
+        /**
+         * @brief Plays the game until it is finished, starting with the pickups of the current player's discard.
+         *
+         * Follows the turn order of advance(), all decisions being made by the players' policies. The game ends
+         * with a winning hand or an empty set.
+         *
+         * @return The index of the winning player, or -1 if the set ran out.
+         */
+        int play_until_finished()
+        {
+            if (!running)
+                return -1;
+            std::array<bool, N_PLAYERS> external_before = external_players;
+            external_players.fill(false);
+            winner = -1;
+            win_by_discard = false;
+            begin_claims();
+            advance();
+            external_players = external_before;
+            return winner;
+        }
+
         /**
          * @brief Gets the size of the set of tiles.
          *
@@ -380,9 +883,9 @@ namespace Mahjong
          */
         void display_discard_pile() const
         {
-            std::cout << "Discard pile:\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "Discard pile:\n");
             discard_pile.display_discard_pile();
-            std::cout << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "\n");
         }
 
         /**
@@ -406,6 +909,30 @@ namespace Mahjong
             return players;
         }
 
+        /**
+         * @brief Gets the hand of a player.
+         *
+         * @param player_number Index of the player.
+         * @return Reference to the player's hand.
+         */
+        const Mahjong::Hand &get_player_hand(unsigned int player_number) const
+        {
+            return players[player_number].get_hand();
+        }
+
+        /**
+         * @brief Gets the pickup actions available to a player for the latest discard of the current player.
+         *
+         * @param player_number Index of the player.
+         * @return The available pickup actions, empty for the current player.
+         */
+        Mahjong::Action_list<Mahjong::Pickup_action, N_PICKUP_ACTIONS> get_available_pickup_actions(unsigned int player_number) const
+        {
+            if (player_number == current_player || discard_pile.get_size() == 0)
+                return {};
+            return players[player_number].get_hand().check_available_actions(discard_pile, player_number, current_player);
+        }
+
         /**
          * @brief Checks if the game is currently running.
          *
@@ -422,6 +949,8 @@ namespace Mahjong
         void finish()
         {
             running = false;
+            if (recorder != nullptr)
+                recorder->record_end();
         }
 
         /**
@@ -450,15 +979,57 @@ namespace Mahjong
          * @param player_number The index of the player whose policy is to be set.
          * @param new_policy The new policy to be set for the player.
          */
-        void set_player_policy(unsigned int player_number, std::string new_policy)
+        void set_player_policy(unsigned int player_number, Mahjong::Policy_type new_policy)
         {
             Player &player = players[player_number];
             player.set_policy(new_policy);
         }
 
+        /**
+         * @brief Sets the randomness and chow rate of the policy of a specific player.
+         *
+         * @param player_number The index of the player whose policy parameters are to be set.
+         * @param parameters The new policy parameters.
+         */
+        void set_player_policy_parameters(unsigned int player_number, const Mahjong::Policy_parameters &parameters)
+        {
+            players[player_number].set_policy_parameters(parameters);
+        }
+
         /**
          * @brief Retrieves the game state from the perspective of a specific player.
          *
+         * The returned view refers to the live hands and discard pile of the game without copying them and only
+         * exposes the revealed tiles of the other players. It is invalidated by any change of the game.
+         *
+         * @param player_number The index of the player for whom the game state is to be retrieved.
+         *
+         * @return A Mahjong::State_view representing the game state from the perspective of the specified player.
+         */
+        Mahjong::State_view get_game_state_for_player(unsigned int player_number) const
+        {
+            std::array<const Mahjong::Hand *, 4> hands = {};
+            for (size_t i = 0; i < N_PLAYERS; i++)
+                hands[i] = &players[i].get_hand();
+
+            return Mahjong::State_view(player_number, players[player_number].get_seat_wind(), round_wind, hands, discard_pile, seen_counts, current_player);
+        }
+
+        /**
+         * @brief Gets the number of visible tiles per tile kind.
+         *
+         * A tile is visible once it has been discarded or revealed as part of a combination.
+         *
+         * @return The visible tile counts, indexed by tile kind (see Tile::get_kind).
+         */
+        const Mahjong::Tile_counts &get_seen_counts() const
+        {
+            return seen_counts;
+        }
+
+        /**
+         * @brief Retrieves a copy of the game state from the perspective of a specific player.
+         *
          * This function constructs and returns the game state object from the perspective of a specific player.
          * The game state includes the hands of all players, where the hand of the specified player may be either
          * the full hand or only the visible tiles depending on the player's perspective.
@@ -467,26 +1038,23 @@ namespace Mahjong
          *
          * @return A Mahjong::State object representing the game state from the perspective of the specified player.
          */
-        Mahjong::State get_game_state_for_player(unsigned int player_number)
+        Mahjong::State get_game_state_copy_for_player(unsigned int player_number)
         {
             std::vector<Mahjong::Hand> hands = {};
 
             for (int i = 0; i < N_PLAYERS; i++)
             {
                 Mahjong::Player &player = players[i];
-                int pos = i + 1;
                 if (i == player_number)
                     hands.push_back(player.get_full_hand());
                 else
                     hands.push_back(player.get_visible_hand());
             }
 
-            Mahjong::Player player = get_players()[player_number];
-            unsigned int seat_wind = player.get_seat_wind().get_wind();
+            unsigned int seat_wind = players[player_number].get_seat_wind().get_wind();
             unsigned int round_wind_int = round_wind.get_wind();
 
-            Mahjong::State game_state = Mahjong::State(player_number, seat_wind, round_wind_int, hands, discard_pile);
-            return game_state;
+            return Mahjong::State(player_number, seat_wind, round_wind_int, hands, discard_pile);
         }
 
         /**
@@ -521,11 +1089,14 @@ namespace Mahjong
          */
         void display_cumulative_scores() const
         {
-            std::cout << "Current scores:\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, "Current scores:\n");
             for (int i = 0; i < players.size(); i++)
             {
-                std::cout << "Player " << i << ": " << scores[i] << "\n";
+                MAHJONG_LOG(Mahjong::Log_level::info, "Player " << i << ": " << scores[i] << "\n");
             }
         }
     };
 } // namespace Mahjong
+
+// The monte_carlo policy plays complete games, so it is defined after the Game class.
+#include "Monte_carlo.hpp"
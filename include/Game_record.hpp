@@ -0,0 +1,522 @@
+/**
+ * @file Game_record.hpp
+ * @brief Defines a compact binary format of recorded games, its streaming writer and a memory-mapped reader.
+ *
+ * A record file starts with the four bytes "MJGR" and the format version as 32-bit integer. It is followed by
+ * the games, each consisting of a header and its events:
+ *
+ * | Size    | Content                                                                  |
+ * |---------|--------------------------------------------------------------------------|
+ * | 8       | Tag of the game, e.g. its index in a simulation.                          |
+ * | 4       | Number of event bytes.                                                   |
+ * | 136     | The shuffled set as tile kinds, the first tile to be drawn being the last. |
+ * | n       | The events.                                                              |
+ *
+ * The first byte of an event holds its type (see Record_event_type) in bits 2 to 4 and the player in bits 0
+ * and 1. Draws, sorts and wins take a single byte, a discard is followed by the index of the discarded tile and
+ * a claim by the pickup action and the 24-bit mask of the tiles revealed by it. All integers are stored in
+ * little-endian byte order.
+ *
+ * The hands of a game are dealt from the recorded set, so the events suffice to replay the game without its
+ * policies or random number generator (see replay_game).
+ */
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Action.hpp"
+#include "Game.hpp"
+#include "Game_recorder.hpp"
+#include "Game_snapshot.hpp"
+#include "Tile.hpp"
+
+/** @brief Version of the record format. */
+const std::uint32_t GAME_RECORD_VERSION = 1;
+
+/** @brief Size of the header of a record file. */
+const unsigned int GAME_RECORD_FILE_HEADER_SIZE = 8;
+
+/** @brief Size of the header of a recorded game. */
+const unsigned int GAME_RECORD_HEADER_SIZE = 8 + 4 + N_TILES;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Types of recorded events.
+     */
+    enum class Record_event_type
+    {
+        draw = 0,    ///< A player draws a tile from the set.
+        sort = 1,    ///< A player sorts their hand.
+        discard = 2, ///< A player discards a tile, followed by its index.
+        claim = 3,   ///< A player claims the latest discard, followed by the pickup action and the revealed tiles.
+        win = 4,     ///< A player has a winning hand.
+    };
+
+    /**
+     * @brief A decoded event of a recorded game.
+     */
+    struct Record_event
+    {
+        Mahjong::Record_event_type type = Mahjong::Record_event_type::draw; ///< The type of the event.
+        unsigned int player_number = 0;                                     ///< The acting player.
+        unsigned int index = 0;                                             ///< The index of a discarded tile.
+        Mahjong::Pickup_action action = Mahjong::Pickup_action::none;       ///< The pickup action of a claim.
+        std::uint32_t revealed_mask = 0;                                    ///< The tiles revealed by a claim.
+    };
+
+    /**
+     * @brief Writes an integer in little-endian byte order.
+     */
+    template <typename Integer>
+    void write_little_endian(Integer value, unsigned int n_bytes, std::uint8_t *bytes)
+    {
+        for (unsigned int byte = 0; byte < n_bytes; byte++)
+            bytes[byte] = static_cast<std::uint8_t>(value >> (8 * byte));
+    }
+
+    /**
+     * @brief Reads an integer stored in little-endian byte order.
+     */
+    template <typename Integer>
+    Integer read_little_endian(const std::uint8_t *bytes, unsigned int n_bytes)
+    {
+        Integer value = 0;
+        for (unsigned int byte = 0; byte < n_bytes; byte++)
+            value |= static_cast<Integer>(bytes[byte]) << (8 * byte);
+        return value;
+    }
+
+    /**
+     * @class Game_record_file
+     * @brief Output file of recorded games, shared by the writers of several games and threads.
+     */
+    class Game_record_file
+    {
+    private:
+        std::ofstream output; ///< The output stream.
+        std::mutex mutex;     ///< Serializes the games appended by different writers.
+
+    public:
+        /**
+         * @brief Creates the file and writes its header.
+         *
+         * @param path The path of the file.
+         * @return True if the file could be created, false otherwise.
+         */
+        bool open(const std::string &path)
+        {
+            output.open(path, std::ios::binary | std::ios::trunc);
+            std::uint8_t header[GAME_RECORD_FILE_HEADER_SIZE] = {'M', 'J', 'G', 'R'};
+            write_little_endian(GAME_RECORD_VERSION, 4, header + 4);
+            output.write(reinterpret_cast<const char *>(header), sizeof(header));
+            return output.good();
+        }
+
+        /**
+         * @brief Appends a game.
+         *
+         * @param header The GAME_RECORD_HEADER_SIZE bytes of the header of the game.
+         * @param events The events of the game.
+         */
+        void append(const std::uint8_t *header, const std::vector<std::uint8_t> &events)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.write(reinterpret_cast<const char *>(header), GAME_RECORD_HEADER_SIZE);
+            output.write(reinterpret_cast<const char *>(events.data()), events.size());
+        }
+
+        /**
+         * @brief Flushes and closes the file.
+         *
+         * @return True if all games were written, false otherwise.
+         */
+        bool close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.close();
+            return !output.fail();
+        }
+    };
+
+    /**
+     * @class Game_record_writer
+     * @brief Records the events of a game (see Game::set_recorder) and appends each finished game to a file.
+     *
+     * A game is appended when it ends, when the next game starts or when the writer is flushed or destroyed.
+     */
+    class Game_record_writer : public Mahjong::Game_recorder
+    {
+    private:
+        Mahjong::Game_record_file *file;                         ///< The output file.
+        std::array<std::uint8_t, GAME_RECORD_HEADER_SIZE> header; ///< The header of the current game.
+        std::vector<std::uint8_t> events;                        ///< The events of the current game.
+        std::uint64_t tag = 0;                                   ///< The tag of the next game.
+        bool recording = false;                                  ///< Whether a game is being recorded.
+
+        /**
+         * @brief Appends an event byte holding the type and the player.
+         */
+        void push_event(Mahjong::Record_event_type type, unsigned int player_number)
+        {
+            events.push_back(static_cast<std::uint8_t>((static_cast<unsigned int>(type) << 2) | (player_number & 3)));
+        }
+
+    public:
+        /**
+         * @brief Constructor for the Game_record_writer class.
+         *
+         * @param file_in The output file, which must outlive the writer.
+         */
+        explicit Game_record_writer(Mahjong::Game_record_file &file_in) : file(&file_in)
+        {
+            events.reserve(1024);
+        }
+
+        Game_record_writer(const Game_record_writer &) = delete;
+        Game_record_writer &operator=(const Game_record_writer &) = delete;
+
+        /**
+         * @brief Destructor appending the current game.
+         */
+        ~Game_record_writer() override
+        {
+            flush();
+        }
+
+        /**
+         * @brief Sets the tag of the next game.
+         *
+         * @param tag_in The tag, e.g. the index of the game.
+         */
+        void set_tag(std::uint64_t tag_in)
+        {
+            tag = tag_in;
+        }
+
+        /**
+         * @brief Appends the current game to the file, if a game is being recorded.
+         */
+        void flush()
+        {
+            if (!recording)
+                return;
+            write_little_endian(static_cast<std::uint32_t>(events.size()), 4, header.data() + 8);
+            file->append(header.data(), events);
+            recording = false;
+        }
+
+        void record_start(const std::vector<Mahjong::Tile> &wall) override
+        {
+            flush();
+            assert(wall.size() == N_TILES);
+            write_little_endian(tag, 8, header.data());
+            for (unsigned int index = 0; index < N_TILES; index++)
+                header[12 + index] = static_cast<std::uint8_t>(wall[index].get_kind());
+            events.clear();
+            recording = true;
+        }
+
+        void record_draw(unsigned int player_number) override
+        {
+            push_event(Mahjong::Record_event_type::draw, player_number);
+        }
+
+        void record_sort(unsigned int player_number) override
+        {
+            push_event(Mahjong::Record_event_type::sort, player_number);
+        }
+
+        void record_discard(unsigned int player_number, unsigned int index) override
+        {
+            push_event(Mahjong::Record_event_type::discard, player_number);
+            events.push_back(static_cast<std::uint8_t>(index));
+        }
+
+        void record_claim(unsigned int player_number, Mahjong::Pickup_action action, std::uint32_t revealed_mask) override
+        {
+            push_event(Mahjong::Record_event_type::claim, player_number);
+            events.push_back(static_cast<std::uint8_t>(action));
+            std::uint8_t mask_bytes[3];
+            write_little_endian(revealed_mask, 3, mask_bytes);
+            events.insert(events.end(), mask_bytes, mask_bytes + 3);
+        }
+
+        void record_win(unsigned int player_number) override
+        {
+            push_event(Mahjong::Record_event_type::win, player_number);
+        }
+
+        void record_end() override
+        {
+            flush();
+        }
+    };
+
+    /**
+     * @brief A recorded game, referring to the memory of its reader.
+     */
+    class Game_record
+    {
+    private:
+        const std::uint8_t *header = nullptr; ///< The header of the game.
+        const std::uint8_t *events = nullptr; ///< The events of the game.
+        std::uint32_t n_event_bytes = 0;      ///< The number of event bytes.
+
+    public:
+        Game_record() = default;
+
+        /**
+         * @brief Constructor for the Game_record class.
+         *
+         * @param header_in The header of the game, followed by its events.
+         */
+        explicit Game_record(const std::uint8_t *header_in)
+            : header(header_in), events(header_in + GAME_RECORD_HEADER_SIZE), n_event_bytes(read_little_endian<std::uint32_t>(header_in + 8, 4)) {}
+
+        /**
+         * @brief Gets the tag of the game.
+         */
+        std::uint64_t get_tag() const
+        {
+            return read_little_endian<std::uint64_t>(header, 8);
+        }
+
+        /**
+         * @brief Gets the shuffled set of the game.
+         *
+         * @return The tiles of the set, the first tile to be drawn being the last one.
+         */
+        std::array<Mahjong::Tile, N_TILES> get_wall() const
+        {
+            std::array<Mahjong::Tile, N_TILES> wall;
+            for (unsigned int index = 0; index < N_TILES; index++)
+                wall[index] = Mahjong::Tile::from_kind(header[12 + index]);
+            return wall;
+        }
+
+        /**
+         * @brief Gets the number of event bytes, the end offset of the events.
+         */
+        std::uint32_t get_n_event_bytes() const
+        {
+            return n_event_bytes;
+        }
+
+        /**
+         * @brief Decodes the event at the given offset.
+         *
+         * @param offset The offset of the event, set to the offset of the next event if the event is valid.
+         * @param event The decoded event.
+         * @return True if the event is valid, false if the offset is at or past the end of the events, or the event
+         * has an unknown type or pickup action or extends past the end of the events.
+         */
+        bool decode_event(std::uint32_t &offset, Mahjong::Record_event &event) const
+        {
+            if (offset >= n_event_bytes)
+                return false;
+            const std::uint8_t *bytes = events + offset;
+            const unsigned int type = bytes[0] >> 2;
+            if (type > static_cast<unsigned int>(Mahjong::Record_event_type::win))
+                return false;
+            std::uint32_t size = 1;
+            if (type == static_cast<unsigned int>(Mahjong::Record_event_type::discard))
+                size = 2;
+            else if (type == static_cast<unsigned int>(Mahjong::Record_event_type::claim))
+                size = 5;
+            if (size > n_event_bytes - offset)
+                return false;
+
+            event.type = static_cast<Mahjong::Record_event_type>(type);
+            event.player_number = bytes[0] & 3;
+            if (event.type == Mahjong::Record_event_type::discard)
+                event.index = bytes[1];
+            else if (event.type == Mahjong::Record_event_type::claim)
+            {
+                if (bytes[1] >= N_PICKUP_ACTIONS)
+                    return false;
+                event.action = static_cast<Mahjong::Pickup_action>(bytes[1]);
+                event.revealed_mask = read_little_endian<std::uint32_t>(bytes + 2, 3);
+            }
+            offset += size;
+            return true;
+        }
+
+        /**
+         * @brief Gets the number of events (plies) of the game, up to its first malformed event if any.
+         */
+        unsigned int get_n_plies() const
+        {
+            unsigned int n_plies = 0;
+            Mahjong::Record_event event;
+            for (std::uint32_t offset = 0; decode_event(offset, event);)
+                n_plies += 1;
+            return n_plies;
+        }
+    };
+
+    /**
+     * @class Game_record_reader
+     * @brief Memory-maps a record file and gives indexed access to its games without copying them.
+     */
+    class Game_record_reader
+    {
+    private:
+        const std::uint8_t *data = nullptr;       ///< The mapped file.
+        std::size_t size = 0;                     ///< The size of the file.
+        std::vector<std::size_t> game_offsets;    ///< The offset of each game.
+
+        /**
+         * @brief Unmaps the file.
+         */
+        void unmap()
+        {
+            if (data != nullptr)
+                munmap(const_cast<std::uint8_t *>(data), size);
+            data = nullptr;
+            size = 0;
+            game_offsets.clear();
+        }
+
+    public:
+        Game_record_reader() = default;
+        Game_record_reader(const Game_record_reader &) = delete;
+        Game_record_reader &operator=(const Game_record_reader &) = delete;
+
+        /**
+         * @brief Destructor unmapping the file.
+         */
+        ~Game_record_reader()
+        {
+            unmap();
+        }
+
+        /**
+         * @brief Maps a record file and indexes its games by scanning their headers.
+         *
+         * @param path The path of the file.
+         * @return True if the file is a valid record file of the current version, false otherwise.
+         */
+        bool open(const std::string &path)
+        {
+            unmap();
+            int descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                return false;
+            struct stat file_status;
+            if (fstat(descriptor, &file_status) != 0 || file_status.st_size < static_cast<off_t>(GAME_RECORD_FILE_HEADER_SIZE))
+            {
+                ::close(descriptor);
+                return false;
+            }
+            size = file_status.st_size;
+            void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+            if (mapping == MAP_FAILED)
+            {
+                size = 0;
+                return false;
+            }
+            data = static_cast<const std::uint8_t *>(mapping);
+
+            if (std::memcmp(data, "MJGR", 4) != 0 || read_little_endian<std::uint32_t>(data + 4, 4) != GAME_RECORD_VERSION)
+            {
+                unmap();
+                return false;
+            }
+            for (std::size_t offset = GAME_RECORD_FILE_HEADER_SIZE; offset + GAME_RECORD_HEADER_SIZE <= size;)
+            {
+                std::size_t end = offset + GAME_RECORD_HEADER_SIZE + read_little_endian<std::uint32_t>(data + offset + 8, 4);
+                if (end > size)
+                    break;
+                game_offsets.push_back(offset);
+                offset = end;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Gets the number of complete games in the file.
+         */
+        std::size_t get_n_games() const
+        {
+            return game_offsets.size();
+        }
+
+        /**
+         * @brief Gets a game.
+         *
+         * @param index The index of the game in the file.
+         * @return The game, valid while the reader keeps the file open.
+         */
+        Mahjong::Game_record get_game(std::size_t index) const
+        {
+            return Mahjong::Game_record(data + game_offsets[index]);
+        }
+    };
+
+    /**
+     * @brief Replays a recorded game up to the given ply.
+     *
+     * The game is dealt from the recorded set and the events are applied in order, the acting player of each
+     * event becoming the current player. Replaying all events finishes the game. The state at the ply is then
+     * available through the game, e.g. Game::get_game_state_for_player.
+     *
+     * @param record The recorded game.
+     * @param game The game receiving the replay, its policies are not used.
+     * @param n_plies The number of events to be applied.
+     * @return The number of applied events, smaller than n_plies if the game has fewer events or a malformed event,
+     * which ends the replay without finishing the game.
+     */
+    inline unsigned int replay_game(const Mahjong::Game_record &record, Mahjong::Game &game, unsigned int n_plies = std::numeric_limits<unsigned int>::max())
+    {
+        std::array<Mahjong::Tile, N_TILES> wall = record.get_wall();
+        game.reset_with_wall(wall.data(), wall.data() + wall.size());
+
+        unsigned int n_applied = 0;
+        Mahjong::Record_event event;
+        std::uint32_t offset = 0;
+        for (; n_applied < n_plies && record.decode_event(offset, event); n_applied++)
+        {
+            game.set_current_player(event.player_number);
+            switch (event.type)
+            {
+            case Mahjong::Record_event_type::draw:
+                game.player_draw(event.player_number, false);
+                break;
+            case Mahjong::Record_event_type::sort:
+                game.sort_player_hand(event.player_number);
+                break;
+            case Mahjong::Record_event_type::discard:
+                game.player_discard_by_index(event.player_number, event.index);
+                break;
+            case Mahjong::Record_event_type::claim:
+                game.player_claim_from_discard(event.player_number, event.action, event.revealed_mask);
+                break;
+            case Mahjong::Record_event_type::win:
+                game.finish();
+                break;
+            }
+        }
+        if (offset >= record.get_n_event_bytes())
+            game.finish();
+        return n_applied;
+    }
+} // namespace Mahjong
@@ -0,0 +1,81 @@
+/**
+ * @file Game_recorder.hpp
+ * @brief Defines the Game_recorder interface receiving the events of a game as it is played.
+ *
+ * A game with a recorder (see Game::set_recorder) reports the order of its set and every change of a hand, which
+ * suffices to replay the game without its policies or random number generator (see Game_record.hpp).
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Action.hpp"
+#include "Tile.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @class Game_recorder
+     * @brief Interface of the receivers of game events.
+     */
+    class Game_recorder
+    {
+    public:
+        virtual ~Game_recorder() = default;
+
+        /**
+         * @brief Receives the shuffled set of a new game before the hands are dealt.
+         *
+         * @param wall The tiles of the set, the next tile to be drawn being the last one.
+         */
+        virtual void record_start(const std::vector<Mahjong::Tile> &wall) = 0;
+
+        /**
+         * @brief Receives the draw of a tile from the set.
+         *
+         * @param player_number The index of the drawing player.
+         */
+        virtual void record_draw(unsigned int player_number) = 0;
+
+        /**
+         * @brief Receives the sorting of a hand.
+         *
+         * @param player_number The index of the player.
+         */
+        virtual void record_sort(unsigned int player_number) = 0;
+
+        /**
+         * @brief Receives a discard.
+         *
+         * @param player_number The index of the discarding player.
+         * @param index The index of the discarded tile in the player's hand.
+         */
+        virtual void record_discard(unsigned int player_number, unsigned int index) = 0;
+
+        /**
+         * @brief Receives the claim of the latest discard.
+         *
+         * @param player_number The index of the claiming player.
+         * @param action The pickup action.
+         * @param revealed_mask The tiles revealed by the claim, bit i standing for index i of the hand after the pickup.
+         */
+        virtual void record_claim(unsigned int player_number, Mahjong::Pickup_action action, std::uint32_t revealed_mask) = 0;
+
+        /**
+         * @brief Receives a winning hand.
+         *
+         * @param player_number The index of the winning player.
+         */
+        virtual void record_win(unsigned int player_number) = 0;
+
+        /**
+         * @brief Receives the end of the game. Games ended by a win are not necessarily finished explicitly.
+         */
+        virtual void record_end() = 0;
+    };
+} // namespace Mahjong
@@ -0,0 +1,91 @@
+/**
+ * @file Game_snapshot.hpp
+ * @brief Defines the Game_snapshot struct, a trivially copyable copy of the complete state of a Mahjong game.
+ *
+ * Snapshots are meant for lookahead searches, which fork a game many times per decision: copying a snapshot is a
+ * single memcpy, and restoring it into an existing game reuses the storage of the game's hands, set and discard
+ * pile instead of allocating new ones (see Game::snapshot and Game::restore).
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "Action.hpp"
+#include "Tile.hpp"
+
+/** @brief Number of tiles in a complete set. */
+const unsigned int N_TILES = 136;
+
+/** @brief Maximum number of tiles in a hand, four kongs and a pair plus a drawn tile are below this bound. */
+const unsigned int MAX_HAND_TILES = MAX_ACTIONS;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Snapshot of a hand, including its incrementally maintained tile counts, hash and claim masks.
+     */
+    struct Hand_snapshot
+    {
+        std::array<Mahjong::Tile, MAX_HAND_TILES> tiles;            ///< The tiles in hand, in order.
+        unsigned char n_tiles;                                       ///< The number of tiles in hand.
+        Mahjong::Tile_counts hidden_counts;                          ///< Number of hidden tiles per tile kind.
+        Mahjong::Tile_counts revealed_counts;                        ///< Number of revealed tiles per tile kind.
+        std::uint64_t count_hash;                                    ///< Zobrist hash of the tile counts.
+        std::array<std::uint64_t, N_PICKUP_ACTIONS> claim_masks;     ///< Claimable tile kinds per pickup action.
+    };
+
+    /**
+     * @brief Snapshot of a player, including the parameters of its policy.
+     */
+    struct Player_snapshot
+    {
+        Hand_snapshot hand;                        ///< The player's hand.
+        unsigned int player_number;                ///< The index of the player.
+        bool is_human;                             ///< Whether the player is a human player.
+        Mahjong::Policy_type policy;               ///< The player's policy.
+        float randomness;                          ///< The randomness factor of the policy.
+        float chow_rate;                           ///< The chow rate of the policy.
+        Mahjong::Search_settings search_settings;  ///< The budget of the policy's search.
+        float money;                               ///< The player's money.
+        int seat_wind;                             ///< The player's seat wind.
+        Mahjong::Tile latest_tile;                 ///< The latest tile added to the hand.
+        bool latest_tile_from_discard;             ///< Whether the latest tile was picked up from the discard pile.
+    };
+
+    /**
+     * @brief Trivially copyable snapshot of a game with four players.
+     *
+     * The set and the discard pile are stored as fixed arrays, the first `wall_size` resp. `n_discards` tiles being
+     * valid. The undrawn tiles are drawn from the end of the wall.
+     */
+    struct Game_snapshot
+    {
+        std::array<Mahjong::Tile, N_TILES> wall;        ///< The undrawn tiles of the set.
+        unsigned char wall_size;                        ///< The number of undrawn tiles.
+        std::array<Mahjong::Tile, N_TILES> discards;    ///< The tiles of the discard pile.
+        unsigned char n_discards;                       ///< The number of tiles in the discard pile.
+        std::array<Player_snapshot, 4> players;         ///< The players.
+        std::array<int, 4> scores;                      ///< The cumulative scores of the players.
+        Mahjong::Tile_counts seen_counts;               ///< Number of visible tiles per tile kind.
+        std::array<std::uint64_t, 4> rng_state;         ///< The state of the game's random number generator.
+        int id;                                         ///< The identifier of the game.
+        bool running;                                   ///< Whether the game is running.
+        unsigned int current_player;                    ///< The index of the current player.
+        int n_rounds;                                   ///< The number of completed rounds.
+        int round_wind;                                 ///< The round wind.
+        int phase;                                      ///< The progress of the game between two decisions, a Game_phase.
+        std::array<bool, 4> external_players;           ///< Whether the decisions of a player are submitted by the driver.
+        std::array<Mahjong::Pickup_action, 4> claim_actions; ///< The pickup actions chosen for the latest discard.
+        unsigned int next_claimant;                     ///< The index of the next player to be asked for a pickup action.
+        int winner;                                     ///< The index of the winning player, -1 if nobody won (yet).
+        bool win_by_discard;                            ///< Whether the winner completed the hand with a claimed discard.
+    };
+
+    static_assert(std::is_trivially_copyable_v<Game_snapshot>, "Game snapshots must be copyable with memcpy");
+} // namespace Mahjong
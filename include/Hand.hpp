@@ -4,21 +4,28 @@
  */
 
 #pragma once
+#include <array>
 #include <vector>
 #include <iostream>
 #include <assert.h>
 #include <algorithm>
 #include <set>
-#include <random>
 #include <map>
 #include <string>
 #include <tuple>
 
+#include "Action.hpp"
+#include "Instrumentation.hpp"
+#include "Logging.hpp"
+#include "Random.hpp"
 #include "Tile.hpp"
 #include "Set.hpp"
 #include "Discard_pile.hpp"
+#include "decomposition_table.hpp"
+#include "Game_snapshot.hpp"
 #include "dlx_exact_cover_solver.hpp"
 #include "score_table.hpp"
+#include "score_cache.hpp"
 #include "Wind.hpp"
 
 /** @brief Initial number of tiles in hand. */
@@ -30,6 +37,41 @@ const unsigned int HAND_SIZE = 13;
  */
 namespace Mahjong
 {
+    /**
+     * @brief Computes, for every pattern of hidden ranks present in a ground suit, the ranks a chow can be claimed with.
+     *
+     * A chow can be claimed (see Hand::check_chow) if the hidden ranks within a distance of two of the claimed
+     * rank contain more than one start of three consecutive ranks.
+     *
+     * @return Bit masks of the claimable ranks, indexed by the bit mask of present ranks.
+     */
+    constexpr std::array<std::uint16_t, 512> make_chow_claim_table()
+    {
+        std::array<std::uint16_t, 512> table{};
+        for (unsigned int present = 0; present < 512; present++)
+        {
+            for (int rank = 0; rank < 9; rank++)
+            {
+                unsigned int window = 0;
+                for (int other = rank - 2; other <= rank + 2; other++)
+                {
+                    if (0 <= other && other < 9)
+                        window |= present & (1u << other);
+                }
+                unsigned int starters = window & (window >> 1) & (window >> 2);
+                unsigned int n_starters = 0;
+                for (; starters != 0; starters &= starters - 1)
+                    n_starters++;
+                if (n_starters > 1)
+                    table[present] |= 1u << rank;
+            }
+        }
+        return table;
+    }
+
+    /** @brief Claimable chow ranks per pattern of present hidden ranks, computed at compile time. */
+    inline constexpr std::array<std::uint16_t, 512> CHOW_CLAIM_TABLE = make_chow_claim_table();
+
     /**
      * @brief The `Hand` class represents a player's hand in a Mahjong game.
      *
@@ -39,7 +81,96 @@ namespace Mahjong
     class Hand
     {
     private:
-        std::vector<Mahjong::Tile> tiles; /**< The tiles currently in hand. */
+        std::vector<Mahjong::Tile> tiles;                           /**< The tiles currently in hand. */
+        std::array<unsigned char, N_TILE_KINDS> hidden_counts{};   /**< Number of hidden tiles in hand per tile kind. */
+        std::array<unsigned char, N_TILE_KINDS> revealed_counts{}; /**< Number of revealed tiles in hand per tile kind. */
+        std::uint64_t count_hash = 0;                               /**< Zobrist hash of the hidden and revealed tile counts. */
+        std::array<std::uint64_t, N_PICKUP_ACTIONS> claim_masks{};  /**< Tile kinds claimable by each pickup action, one bit per kind. */
+
+        /**
+         * @brief Updates the claim masks after the hidden count of a tile kind changed.
+         *
+         * @param kind The tile kind.
+         * @param old_count The hidden count before the change.
+         */
+        void update_claim_masks(unsigned int kind, unsigned int old_count)
+        {
+            const std::uint64_t bit = std::uint64_t(1) << kind;
+            const unsigned int count = hidden_counts[kind];
+            std::uint64_t &pong_mask = claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::pong)];
+            std::uint64_t &kong_mask = claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::kong)];
+            pong_mask = (count == 2) ? (pong_mask | bit) : (pong_mask & ~bit);
+            kong_mask = (count == 3) ? (kong_mask | bit) : (kong_mask & ~bit);
+
+            // Chows only depend on which ranks of the suit are present, so they only change with their presence.
+            if (kind < 27 && (old_count == 0) != (count == 0))
+            {
+                const unsigned int suit = kind / 9;
+                unsigned int present = 0;
+                for (unsigned int rank = 0; rank < 9; rank++)
+                {
+                    if (hidden_counts[suit * 9 + rank] > 0)
+                        present |= 1u << rank;
+                }
+                std::uint64_t &chow_mask = claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::chow)];
+                chow_mask = (chow_mask & ~(std::uint64_t(0x1ff) << (suit * 9))) | (std::uint64_t(CHOW_CLAIM_TABLE[present]) << (suit * 9));
+            }
+        }
+
+        /**
+         * @brief Changes the hidden or revealed count of a tile kind by one and updates the hash accordingly.
+         *
+         * @param hidden Whether the hidden (true) or revealed (false) count changes.
+         * @param kind The tile kind.
+         * @param delta The change of the count, +1 or -1.
+         */
+        void update_count(bool hidden, unsigned int kind, int delta)
+        {
+            unsigned char &count = hidden ? hidden_counts[kind] : revealed_counts[kind];
+            unsigned int old_count = count;
+            count_hash ^= Mahjong::get_count_hash_update(hidden, kind, count, count + delta);
+            count += delta;
+            if (hidden)
+                update_claim_masks(kind, old_count);
+        }
+
+        /**
+         * @brief Adds a tile to the hand and updates the tile counts accordingly.
+         *
+         * @param tile Tile to be added.
+         */
+        void push_tile(Mahjong::Tile tile)
+        {
+            tiles.push_back(tile);
+            update_count(tile.is_hidden(), tile.get_kind(), 1);
+        }
+
+        /**
+         * @brief Removes the tile at the given index from the hand and updates the tile counts accordingly.
+         *
+         * @param index Index of the tile to be removed.
+         */
+        void erase_tile(int index)
+        {
+            const Mahjong::Tile &tile = tiles[index];
+            update_count(tile.is_hidden(), tile.get_kind(), -1);
+            tiles.erase(tiles.begin() + index);
+        }
+
+        /**
+         * @brief Sets the tile at the given index visible and updates the tile counts accordingly.
+         *
+         * @param index Index of the tile to be revealed.
+         */
+        void reveal_tile(int index)
+        {
+            Mahjong::Tile &tile = tiles[index];
+            if (!tile.is_hidden())
+                return;
+            tile.set_visible();
+            update_count(true, tile.get_kind(), -1);
+            update_count(false, tile.get_kind(), 1);
+        }
 
     public:
         /**
@@ -54,10 +185,22 @@ namespace Mahjong
             tiles = {};
             for (auto tile : input_tiles)
             {
-                tiles.push_back(Mahjong::Tile(tile.first, tile.second));
+                push_tile(Mahjong::Tile(tile.first, tile.second));
             }
         }
 
+        /**
+         * @brief Removes all tiles from the hand, keeping the storage of the tiles.
+         */
+        void clear()
+        {
+            tiles.clear();
+            hidden_counts.fill(0);
+            revealed_counts.fill(0);
+            count_hash = 0;
+            claim_masks.fill(0);
+        }
+
         /**
          * @brief Draws a complete hand from the given tile set.
          *
@@ -68,7 +211,7 @@ namespace Mahjong
             assert(tiles.size() == 0);
             for (size_t i = 0; i < HAND_SIZE; i++)
             {
-                tiles.push_back(set.pop_tile());
+                push_tile(set.pop_tile());
             }
         }
 
@@ -82,17 +225,17 @@ namespace Mahjong
         {
             if (tiles.size() == HAND_SIZE)
             {
-                tiles.push_back(set.pop_tile());
+                push_tile(set.pop_tile());
                 if (broadcast)
                 {
-                    std::cout << "Draw tile: " << tiles.back().get_tile_as_string() << std::endl;
+                    MAHJONG_LOG(Mahjong::Log_level::info, "Draw tile: " << tiles.back().get_tile_as_string() << "\n");
                 }
             }
             else
             {
                 if (broadcast)
                 {
-                    std::cout << "Too many tiles in hand. Discard tiles first." << std::endl;
+                    MAHJONG_LOG(Mahjong::Log_level::warning, "Too many tiles in hand. Discard tiles first.\n");
                 }
             }
         }
@@ -104,7 +247,7 @@ namespace Mahjong
          */
         void add_tile(Mahjong::Tile tile)
         {
-            tiles.push_back(tile);
+            push_tile(tile);
         }
 
         /**
@@ -116,11 +259,11 @@ namespace Mahjong
         {
             if (tiles.size() == HAND_SIZE)
             {
-                tiles.push_back(discard_pile.pop_tile());
+                push_tile(discard_pile.pop_tile());
             }
             else
             {
-                std::cout << "Too many tiles in hand. Discard tiles first." << std::endl;
+                MAHJONG_LOG(Mahjong::Log_level::warning, "Too many tiles in hand. Discard tiles first.\n");
             }
         }
 
@@ -130,8 +273,9 @@ namespace Mahjong
          * The user is prompted to select a tile to discard.
          *
          * @param discard_pile Reference to the game's discard pile.
+         * @return The index of the discarded tile, or -1 if no tile was discarded.
          */
-        void discard_tile(Discard_pile &discard_pile)
+        int discard_tile(Discard_pile &discard_pile)
         {
             if (tiles.size() == HAND_SIZE + 1)
             {
@@ -146,9 +290,9 @@ namespace Mahjong
                     {
                         if (tiles[to_discard].is_hidden())
                         {
-                            std::cout << "Discard " << tiles[to_discard].get_tile_as_string() << std::endl;
+                            MAHJONG_LOG(Mahjong::Log_level::info, "Discard " << tiles[to_discard].get_tile_as_string() << "\n");
                             discard_pile.add_discarded_tile(tiles[to_discard]);
-                            tiles.erase(tiles.begin() + to_discard);
+                            erase_tile(to_discard);
                             valid_discard_tile = true;
                         }
                         else
@@ -161,10 +305,12 @@ namespace Mahjong
                         std::cout << "Invalid number. Choice must be between 0 and 13." << std::endl;
                     }
                 }
+                return to_discard;
             }
             else
             {
-                std::cout << "Not enough tiles in hand. Draw tiles first." << std::endl;
+                MAHJONG_LOG(Mahjong::Log_level::warning, "Not enough tiles in hand. Draw tiles first.\n");
+                return -1;
             }
         }
 
@@ -175,23 +321,24 @@ namespace Mahjong
          * and adds it to the specified discard pile. The discarded tile is removed from the hand.
          *
          * @param discard_pile Reference to the game's discard pile.
+         * @param rng The random number generator of the game.
          */
-        void discard_random_tile(Discard_pile &discard_pile)
+        void discard_random_tile(Discard_pile &discard_pile, Mahjong::Rng &rng)
         {
             unsigned int to_discard;
             bool valid_discard = false;
-            if (get_hidden_hand().size() == 0)
+            if (get_n_hidden_tiles() == 0)
             {
                 return;
             }
             while (valid_discard == false)
             {
-                to_discard = std::rand() % (HAND_SIZE + 1);
+                to_discard = rng.bounded(HAND_SIZE + 1);
                 valid_discard = tiles[to_discard].is_hidden();
             }
-            std::cout << "Discard " << tiles[to_discard].get_tile_as_string() << std::endl;
+            MAHJONG_LOG(Mahjong::Log_level::info, "Discard " << tiles[to_discard].get_tile_as_string() << "\n");
             discard_pile.add_discarded_tile(tiles[to_discard]);
-            tiles.erase(tiles.begin() + to_discard);
+            erase_tile(to_discard);
         }
 
         /**
@@ -205,9 +352,39 @@ namespace Mahjong
          */
         void discard_tile_by_index(Discard_pile &discard_pile, int index)
         {
-            std::cout << "Discard " << tiles[index].get_tile_as_string() << std::endl;
+            MAHJONG_LOG(Mahjong::Log_level::info, "Discard " << tiles[index].get_tile_as_string() << "\n");
             discard_pile.add_discarded_tile(tiles[index]);
-            tiles.erase(tiles.begin() + index);
+            erase_tile(index);
+        }
+
+        /**
+         * @brief Returns the hidden tiles of the hand as a bit mask, one bit per index.
+         *
+         * @return The mask with bit i set if the tile at index i is hidden.
+         */
+        std::uint32_t get_hidden_mask() const
+        {
+            std::uint32_t hidden_mask = 0;
+            for (unsigned int index = 0; index < tiles.size(); index++)
+            {
+                if (tiles[index].is_hidden())
+                    hidden_mask |= std::uint32_t(1) << index;
+            }
+            return hidden_mask;
+        }
+
+        /**
+         * @brief Reveals the tiles at the given indices, e.g. to replay a recorded claim.
+         *
+         * @param index_mask The mask with bit i set if the tile at index i is to be revealed.
+         */
+        void reveal_tiles(std::uint32_t index_mask)
+        {
+            for (unsigned int index = 0; index < tiles.size(); index++)
+            {
+                if (index_mask & (std::uint32_t(1) << index))
+                    reveal_tile(index);
+            }
         }
 
         /**
@@ -219,9 +396,9 @@ namespace Mahjong
          *
          * @return A vector of integers representing the indices of valid tiles for discarding.
          */
-        std::vector<int> get_valid_discards()
+        Mahjong::Action_list<int> get_valid_discards() const
         {
-            std::vector<int> valid_discards = {};
+            Mahjong::Action_list<int> valid_discards;
             for (int index = 0; index < tiles.size(); index++)
             {
                 if (tiles[index].is_hidden())
@@ -247,10 +424,15 @@ namespace Mahjong
          */
         void display_hand() const
         {
+            if (!Mahjong::is_log_enabled(Mahjong::Log_level::info))
+                return;
+
+            std::ostringstream display;
             for (size_t i = 0; i < tiles.size(); i++)
             {
-                std::cout << i << ": " << tiles[i].get_tile_as_string_with_visibility() << std::endl;
+                display << i << ": " << tiles[i].get_tile_as_string_with_visibility() << "\n";
             }
+            MAHJONG_LOG(Mahjong::Log_level::info, display.str());
         }
 
         /**
@@ -260,8 +442,12 @@ namespace Mahjong
          */
         void display_visible_hand() const
         {
+            if (!Mahjong::is_log_enabled(Mahjong::Log_level::info))
+                return;
+
             unsigned int hand_size = tiles.size();
-            std::cout << "Known tiles: " << std::endl;
+            std::ostringstream display;
+            display << "Known tiles: \n";
             for (size_t i = 0; i < hand_size; i++)
             {
                 if (tiles[i].is_hidden())
@@ -269,9 +455,10 @@ namespace Mahjong
                     continue;
                 }
 
-                std::cout << tiles[i].get_tile_as_string() << "  ";
+                display << tiles[i].get_tile_as_string() << "  ";
             }
-            std::cout << std::endl;
+            display << "\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, display.str());
         }
 
         /**
@@ -313,14 +500,36 @@ namespace Mahjong
         /**
          * @brief Check if the current hand is a winning Mahjong hand.
          *
+         * A winning hand consists of 14 tiles covered by exactly 5 combinations, with at least one of the
+         * combinations being a pair. The check is answered from the tile counts using the precomputed
+         * suit decompositions of `Decomposition_table`, without building the combinations.
+         *
+         * If `MAHJONG_VALIDATE_WINNING_HAND` is defined, the result is compared against `is_winning_hand_reference`.
+         *
+         * @return True if the hand is a winning Mahjong hand, false otherwise.
+         */
+        bool is_winning_hand() const
+        {
+            bool winning = Mahjong::is_complete_hand(hidden_counts, revealed_counts);
+#ifdef MAHJONG_VALIDATE_WINNING_HAND
+            assert(winning == is_winning_hand_reference());
+#endif
+            return winning;
+        }
+
+        /**
+         * @brief Check if the current hand is a winning Mahjong hand using the exact cover solver.
+         *
          * This function determines if the given set of tiles forms a winning Mahjong hand.
          * The hand must consist of 14 tiles, contain at least one pair, and have enough combinations
          * to form an exact cover using Knuth's algorithm X. A winning hand is defined as an exact cover
          * of 5 combinations, with at least one of the combinations being a pair.
          *
+         * @note Reference implementation for validating `is_winning_hand`.
+         *
          * @return True if the hand is a winning Mahjong hand, false otherwise.
          */
-        bool is_winning_hand() const
+        bool is_winning_hand_reference() const
         {
             // std::cout << "Checking winning hand...\n";
 
@@ -332,7 +541,8 @@ namespace Mahjong
             }
 
             // Early abort of computations if no pair in hand.
-            if (get_pairs().size() == 0)
+            if (std::none_of(hidden_counts.begin(), hidden_counts.end(), [](unsigned char count)
+                             { return count >= 2; }))
             {
                 // std::cout << "No pair in hand.\n";
                 return false;
@@ -360,26 +570,24 @@ namespace Mahjong
                 return false;
             }
 
-            // Find all exact covers (i.e. a set of combinations such that each tile is in exactly one combination).
-            std::cout << "Computing covers...\n";
-            DLX::exact_cover_solver ecs = DLX::exact_cover_solver();
-            std::vector<std::set<int>> covers = ecs.find_exact_covers(combinations);
-            print_combinations(covers);
-
-            // Check if there is a winning cover, i.e. an exact cover of 5 combinations and containing at least one pair.
-            for (std::set<int> cover : covers)
-            {
-                if (cover.size() == 5)
-                {
-                    for (int index : cover)
-                    {
-                        if (combinations[index].size() == 2)
-                            return true;
-                    }
-                }
-            }
-            // std::cout << "Not the right covers in hand.\n";
-            return false;
+            // Search for a winning cover, i.e. an exact cover (a set of combinations such that each tile is in exactly
+            // one combination) of 5 combinations and containing at least one pair.
+            MAHJONG_LOG(Mahjong::Log_level::debug, "Computing covers...\n");
+            thread_local DLX::reusable_exact_cover_solver ecs;
+            ecs.reset(HAND_SIZE + 1);
+            for (const std::set<int> &combination : combinations)
+                ecs.add_row(combination);
+
+            return ecs.for_each_cover([&combinations](const std::vector<int> &cover)
+                                      {
+                                          if (cover.size() != 5)
+                                              return false;
+                                          for (int index : cover)
+                                          {
+                                              if (combinations[index].size() == 2)
+                                                  return true;
+                                          }
+                                          return false; });
         }
 
         /**
@@ -407,37 +615,33 @@ namespace Mahjong
          * @brief Reveals the correspondinig tiles after a pick up is performed.
          *
          * @param tile An instance of class Tile representing the tile that was picked up.
-         * @param action A string parameter to indicate which pick up action was performed (i.e. kong, pong or chow).
+         * @param action The pick up action that was performed (i.e. kong, pong or chow).
+         * @param is_human Flag indicating whether the choice between multiple chows is made by a human.
+         * @param rng The random number generator used to choose between multiple chows otherwise.
          */
-        void reveal_combination(Mahjong::Tile tile, std::string action, bool is_human)
+        void reveal_combination(Mahjong::Tile tile, Mahjong::Pickup_action action, bool is_human, Mahjong::Rng &rng)
         {
-            if (action == "kong")
+            if (action == Mahjong::Pickup_action::kong)
             {
-                auto it = tiles.begin();
-                while (it != tiles.end())
+                for (int index = 0; index < tiles.size(); index++)
                 {
-                    it = std::find(it, tiles.end(), tile);
-                    auto pos = std::distance(tiles.begin(), it);
-                    Mahjong::Tile &tile = tiles[pos];
-                    tile.set_visible();
-                    it++;
+                    if (tiles[index] == tile)
+                        reveal_tile(index);
                 }
             }
-            else if (action == "pong")
+            else if (action == Mahjong::Pickup_action::pong)
             {
-                auto it = tiles.begin();
                 unsigned int n_matches = 0;
-                while (it != tiles.end() && n_matches < 3)
+                for (int index = 0; index < tiles.size() && n_matches < 3; index++)
                 {
-                    it = std::find(it, tiles.end(), tile);
-                    auto pos = std::distance(tiles.begin(), it);
-                    Mahjong::Tile &tile = tiles[pos];
-                    tile.set_visible();
-                    n_matches += 1;
-                    it++;
+                    if (tiles[index] == tile)
+                    {
+                        reveal_tile(index);
+                        n_matches += 1;
+                    }
                 }
             }
-            else if (action == "chow")
+            else if (action == Mahjong::Pickup_action::chow)
             {
                 std::vector<int> relevant_indices = {};
                 unsigned int relevant_suit = tile.get_suit();
@@ -461,8 +665,7 @@ namespace Mahjong
                 {
                     for (int index : relevant_indices)
                     {
-                        Mahjong::Tile &tile_to_reveal = tiles[index];
-                        tile_to_reveal.set_visible();
+                        reveal_tile(index);
                     }
                     return;
                 }
@@ -480,9 +683,7 @@ namespace Mahjong
                     {
                         Mahjong::Tile relevant_tile = Mahjong::Tile(relevant_suit, rank);
                         auto it = std::find(tiles.begin(), tiles.end(), relevant_tile);
-                        auto pos = std::distance(tiles.begin(), it);
-                        Mahjong::Tile &tile_to_reveal = tiles[pos];
-                        tile_to_reveal.set_visible();
+                        reveal_tile(std::distance(tiles.begin(), it));
                     }
                     return;
                 }
@@ -522,7 +723,7 @@ namespace Mahjong
                     // Select random chow choice if not human player
                     else
                     {
-                        unsigned int input = std::rand() % (chow_starters.size());
+                        unsigned int input = rng.bounded(chow_starters.size());
                         chow_starter = *std::next(chow_starters.begin(), input);
                     }
 
@@ -531,9 +732,7 @@ namespace Mahjong
                     {
                         Mahjong::Tile relevant_tile = Mahjong::Tile(relevant_suit, chow_starter + rank_add);
                         auto it = std::find(tiles.begin(), tiles.end(), relevant_tile);
-                        auto pos = std::distance(tiles.begin(), it);
-                        Mahjong::Tile &tile_to_reveal = tiles[pos];
-                        tile_to_reveal.set_visible();
+                        reveal_tile(std::distance(tiles.begin(), it));
                     }
                 }
             }
@@ -549,7 +748,7 @@ namespace Mahjong
          * @param all_ranks A set of integers representing Mahjong tile ranks.
          * @return A set of integers that can be used as the starting point for Mahjong chow combinations.
          */
-        std::set<int> find_chow_starter_ranks(const std::set<int> &all_ranks)
+        std::set<int> find_chow_starter_ranks(const std::set<int> &all_ranks) const
         {
             std::set<int> result;
 
@@ -579,6 +778,9 @@ namespace Mahjong
             // Iterate through the vector
             for (int i = 0; i < tiles.size(); ++i)
             {
+                // Skip tiles that can't form a hidden pair
+                if (!tiles[i].is_hidden() || hidden_counts[tiles[i].get_kind()] < 2)
+                    continue;
                 for (int j = i + 1; j < tiles.size(); ++j)
                 {
                     // Check if the tiles are identical and are both hidden
@@ -608,7 +810,7 @@ namespace Mahjong
             // Iterate through the vector
             for (int i = 0; i < tiles.size(); ++i)
             {
-                if (tiles[i].get_suit() == 3 || tiles[i].get_suit() == 3)
+                if (tiles[i].get_suit() == 3 || tiles[i].get_suit() == 4)
                     continue;
                 for (int j = i + 1; j < tiles.size(); ++j)
                 {
@@ -648,6 +850,9 @@ namespace Mahjong
             // Iterate through the vector
             for (int i = 0; i < tiles.size(); ++i)
             {
+                // Skip tiles that can't form a pong
+                if (hidden_counts[tiles[i].get_kind()] < 3 && revealed_counts[tiles[i].get_kind()] < 3)
+                    continue;
                 for (int j = i + 1; j < tiles.size(); ++j)
                 {
                     for (int k = j + 1; k < tiles.size(); k++)
@@ -680,6 +885,9 @@ namespace Mahjong
             // Iterate through the vector
             for (int i = 0; i < tiles.size(); ++i)
             {
+                // Skip tiles that can't form a kong
+                if (get_n_tile_occurence(tiles[i]) < 4)
+                    continue;
                 for (int j = i + 1; j < tiles.size(); ++j)
                 {
                     for (int k = j + 1; k < tiles.size(); k++)
@@ -741,8 +949,7 @@ namespace Mahjong
          */
         bool check_kong(const Mahjong::Tile tile) const
         {
-            std::vector<Mahjong::Tile> hidden_hand = get_hidden_hand();
-            return std::count(hidden_hand.begin(), hidden_hand.end(), tile) == 3;
+            return hidden_counts[tile.get_kind()] == 3;
         }
 
         /**
@@ -757,8 +964,7 @@ namespace Mahjong
          */
         bool check_pong(const Mahjong::Tile tile) const
         {
-            std::vector<Mahjong::Tile> hidden_hand = get_hidden_hand();
-            return std::count(hidden_hand.begin(), hidden_hand.end(), tile) == 2;
+            return hidden_counts[tile.get_kind()] == 2;
         }
 
         /**
@@ -772,35 +978,21 @@ namespace Mahjong
          *
          * @return True if the provided tile forms a chow in the concealed hand, false otherwise.
          */
-        bool check_chow(const Mahjong::Tile tile)
+        bool check_chow(const Mahjong::Tile tile) const
         {
             unsigned int relevant_suit = tile.get_suit();
 
             if (relevant_suit == 3 || relevant_suit == 4)
                 return false;
 
-            unsigned int relevant_rank = tile.get_rank();
-
-            std::vector<int> relevant_indices = {};
-
-            // Get all indexes of relevant tiles
-            for (int index = 0; index < tiles.size(); index++)
-            {
-                Mahjong::Tile hand_tile = tiles[index];
-                if (!hand_tile.is_hidden())
-                    continue;
-                if (relevant_suit != hand_tile.get_suit())
-                    continue;
-                if (std::abs(tile.get_rank() - hand_tile.get_rank()) > 2)
-                    continue;
-
-                relevant_indices.push_back(index);
-            }
+            int relevant_rank = tile.get_rank();
 
+            // Get all ranks of relevant hidden tiles
             std::set<int> all_ranks = {};
-            for (int index : relevant_indices)
+            for (int rank = std::max(relevant_rank - 2, 0); rank <= std::min(relevant_rank + 2, 8); rank++)
             {
-                all_ranks.insert(tiles[index].get_rank());
+                if (hidden_counts[relevant_suit * 9 + rank] > 0)
+                    all_ranks.insert(rank);
             }
 
             std::set<int> chow_starters = find_chow_starter_ranks(all_ranks);
@@ -809,6 +1001,73 @@ namespace Mahjong
             return false;
         }
 
+        /**
+         * @brief Checks whether a tile can be claimed with the given pickup action.
+         *
+         * Equivalent to check_kong, check_pong resp. check_chow, but answered by a bit test of the claim masks,
+         * which are updated with every change of the hidden tiles.
+         *
+         * @param tile The tile to be claimed.
+         * @param action The pickup action.
+         * @return True if the action can claim the tile, false otherwise (always false for Pickup_action::none).
+         */
+        bool can_claim(Mahjong::Tile tile, Mahjong::Pickup_action action) const
+        {
+            return (claim_masks[static_cast<unsigned int>(action)] >> tile.get_kind()) & 1;
+        }
+
+        /**
+         * @brief Gets the tile kinds that can be claimed by any pickup action.
+         *
+         * @param include_chows Whether chows are allowed, i.e. whether the hand belongs to the next player in turn.
+         * @return Bit mask with one bit per claimable tile kind (see Tile::get_kind).
+         */
+        std::uint64_t get_claim_mask(bool include_chows) const
+        {
+            std::uint64_t mask = claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::pong)] | claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::kong)];
+            if (include_chows)
+                mask |= claim_masks[static_cast<unsigned int>(Mahjong::Pickup_action::chow)];
+            return mask;
+        }
+
+        /**
+         * @brief Gets the tile kinds that would complete the hand, i.e. the hand's waits.
+         *
+         * The mask is computed on every call with one table-based check per tile kind. It is only non-empty for
+         * hands one tile short of a complete hand. The game itself doesn't need the waits: a discard can only be won
+         * through a chow, pong or kong claim, which the claim masks already cover.
+         *
+         * @return Bit mask with one bit per tile kind that makes the hand a winning hand if added as hidden tile.
+         */
+        std::uint64_t get_wait_mask() const
+        {
+            std::uint64_t wait_mask = 0;
+            if (tiles.size() != HAND_SIZE)
+                return wait_mask;
+            std::array<unsigned char, N_TILE_KINDS> counts = hidden_counts;
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            {
+                if (hidden_counts[kind] + revealed_counts[kind] >= 4)
+                    continue;
+                counts[kind] += 1;
+                if (Mahjong::is_complete_hand(counts, revealed_counts))
+                    wait_mask |= std::uint64_t(1) << kind;
+                counts[kind] -= 1;
+            }
+            return wait_mask;
+        }
+
+        /**
+         * @brief Checks whether a tile would complete the hand (see get_wait_mask).
+         *
+         * @param tile The tile to be checked.
+         * @return True if adding the tile makes the hand a winning hand, false otherwise.
+         */
+        bool is_winning_tile(Mahjong::Tile tile) const
+        {
+            return (get_wait_mask() >> tile.get_kind()) & 1;
+        }
+
         /**
          * @brief Check a given player's available pickup actions based on the latest discard tile.
          *
@@ -819,27 +1078,30 @@ namespace Mahjong
          * @param player_number Integer referring to the player performing the pickup.
          * @param current_player Integer referring to the current player, i.e., the player who discarded the last tile.
          *
-         * @return Vector containing all available actions as strings.
+         * @return List containing all available actions.
          *
-         * @note The available actions include "kong" if a kong is possible, "pong" if a pong is possible,
-         * and "chow" if a chow is possible and the pickup is performed by the next player in turn.
+         * @note The available actions include kong if a kong is possible, pong if a pong is possible,
+         * and chow if a chow is possible and the pickup is performed by the next player in turn.
+         * Claims leaving no hidden tile to be discarded afterwards are not available.
          */
-        std::vector<std::string> check_available_actions(const Discard_pile &discard_pile, unsigned int player_number, int current_player)
+        Mahjong::Action_list<Mahjong::Pickup_action, N_PICKUP_ACTIONS> check_available_actions(const Discard_pile &discard_pile, unsigned int player_number, int current_player) const
         {
-            std::vector<std::string> available_actions = {};
+            Mahjong::Action_list<Mahjong::Pickup_action, N_PICKUP_ACTIONS> available_actions;
             Mahjong::Tile tile = discard_pile.back();
-            if (check_kong(tile))
+            const unsigned int n_hidden_tiles = get_n_hidden_tiles();
+            // A claim reveals the claimed tile with 3 (kong) or 2 (pong, chow) hidden tiles and must leave a hidden
+            // tile for the following discard. A kong lacking that tile falls back to the pong of the same tile.
+            if (n_hidden_tiles > 3 && can_claim(tile, Mahjong::Pickup_action::kong))
             {
-                available_actions.push_back("kong");
+                available_actions.push_back(Mahjong::Pickup_action::kong);
             }
-            else if (check_pong(tile))
+            else if (n_hidden_tiles > 2 && (can_claim(tile, Mahjong::Pickup_action::pong) || can_claim(tile, Mahjong::Pickup_action::kong)))
             {
-                available_actions.push_back("pong");
+                available_actions.push_back(Mahjong::Pickup_action::pong);
             }
-            else if (check_chow(tile) && (player_number == ((current_player + 1) % 4)))
-
+            else if (n_hidden_tiles > 2 && can_claim(tile, Mahjong::Pickup_action::chow) && (player_number == ((current_player + 1) % 4)))
             {
-                available_actions.push_back("chow");
+                available_actions.push_back(Mahjong::Pickup_action::chow);
             }
             return available_actions;
         }
@@ -857,7 +1119,7 @@ namespace Mahjong
          *         - 2: Pong
          *         - 3: Kong
          */
-        unsigned int get_combination_type(std::set<int> combination) const
+        unsigned int get_combination_type(const std::set<int> &combination) const
         {
             // If combination contains two tiles then it must be a pair.
             if (combination.size() == 2)
@@ -878,8 +1140,11 @@ namespace Mahjong
         /**
          * @brief Computes the maximum Mahjong score and its corresponding multiplier for the current hand.
          *
-         * This function initializes the Mahjong score table, generates all possible combinations of tiles,
-         * and calculates the maximum score and the sum of multipliers for the current hand based on the scoring table.
+         * The score only depends on the hidden and revealed tile counts and the winds, so results are memoized in
+         * the thread's Score_cache, keyed by the hash of the counts and the winds. On a miss, the score is computed
+         * on a copy of the hand with canonically ordered tiles, such that ties between equally scoring decompositions
+         * are broken independently of the tile order and of the cache contents.
+         * If `MAHJONG_VALIDATE_SCORE_CACHE` is defined, cached scores are compared against a fresh computation.
          *
          * @param round_wind The current round wind.
          * @param seat_wind The corresponding player's seat wind.
@@ -887,12 +1152,107 @@ namespace Mahjong
          * @return A tuple containing the maximum Mahjong score and the corresponding sum of multipliers.
          */
         std::tuple<int, int> get_max_score(Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
+        {
+            Mahjong::Score_cache &cache = Mahjong::Score_cache::get_instance();
+            std::uint64_t key = get_score_key(round_wind, seat_wind);
+
+            Mahjong::Combination_score score;
+            if (cache.find(key, score))
+            {
+                MAHJONG_COUNT(score_cache_hits);
+#ifdef MAHJONG_VALIDATE_SCORE_CACHE
+                assert(std::make_tuple(score.score, score.multiplier) == get_canonical_hand().compute_max_score(round_wind, seat_wind));
+#endif
+                return std::make_tuple(score.score, score.multiplier);
+            }
+
+            MAHJONG_COUNT(score_cache_misses);
+            std::tie(score.score, score.multiplier) = get_canonical_hand().compute_max_score(round_wind, seat_wind);
+            cache.insert(key, score);
+            return std::make_tuple(score.score, score.multiplier);
+        }
+
+        /**
+         * @brief Gets the key of the hand in the score cache.
+         *
+         * @param round_wind The current round wind.
+         * @param seat_wind The corresponding player's seat wind.
+         *
+         * @return The hash of the hidden and revealed tile counts combined with the winds.
+         */
+        std::uint64_t get_score_key(Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
+        {
+            return count_hash ^ Mahjong::get_wind_hash(round_wind.get_wind(), seat_wind.get_wind());
+        }
+
+        /**
+         * @brief Gets a copy of the hand with the tiles ordered by kind, hidden tiles before revealed ones.
+         *
+         * @return The canonically ordered hand.
+         */
+        Mahjong::Hand get_canonical_hand() const
+        {
+            Mahjong::Hand canonical = *this;
+            std::sort(canonical.tiles.begin(), canonical.tiles.end(), [](const Mahjong::Tile &a, const Mahjong::Tile &b)
+                      { return std::make_tuple(a.get_kind(), !a.is_hidden()) < std::make_tuple(b.get_kind(), !b.is_hidden()); });
+            return canonical;
+        }
+
+        /**
+         * @brief Computes the maximum Mahjong score and its corresponding multiplier without using the score cache.
+         *
+         * This function generates all possible combinations of tiles, represents each of them as bit mask of tile
+         * slots and searches the non-overlapping selection of combinations with the maximum score. The search
+         * memoizes its results by the next combination and the relevant used slots. Its result, including the
+         * multiplier chosen among equally scoring selections, equals that of compute_max_score_reference.
+         * If `MAHJONG_VALIDATE_MAX_SCORE` is defined, the result is compared against the reference.
+         *
+         * @param round_wind The current round wind.
+         * @param seat_wind The corresponding player's seat wind.
+         *
+         * @return A tuple containing the maximum Mahjong score and the corresponding sum of multipliers.
+         */
+        std::tuple<int, int> compute_max_score(Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
+        {
+            std::vector<std::set<int>> combinations = get_combinations();
+
+            std::vector<std::uint32_t> masks(combinations.size());
+            std::vector<Mahjong::Combination_score> scores(combinations.size());
+            std::vector<std::uint32_t> remaining(combinations.size() + 1, 0);
+            for (size_t i = 0; i < combinations.size(); i++)
+            {
+                for (int index : combinations[i])
+                    masks[i] |= std::uint32_t(1) << index;
+                std::tie(scores[i].score, scores[i].multiplier) = get_combination_score(combinations[i], round_wind, seat_wind);
+            }
+            for (size_t i = combinations.size(); i > 0; i--)
+                remaining[i - 1] = remaining[i] | masks[i - 1];
+
+            Mahjong::Score_memo &memo = Mahjong::Score_memo::get_instance();
+            memo.clear();
+            Mahjong::Combination_score max_score = search_max_score(masks, scores, remaining, 0, 0, memo);
+
+#ifdef MAHJONG_VALIDATE_MAX_SCORE
+            assert(std::make_tuple(max_score.score, max_score.multiplier) == compute_max_score_reference(round_wind, seat_wind));
+#endif
+            return std::make_tuple(max_score.score, max_score.multiplier);
+        }
+
+        /**
+         * @brief Computes the maximum Mahjong score and its corresponding multiplier by plain backtracking.
+         *
+         * This is the original, exponential implementation of compute_max_score, used as reference.
+         *
+         * @param round_wind The current round wind.
+         * @param seat_wind The corresponding player's seat wind.
+         *
+         * @return A tuple containing the maximum Mahjong score and the corresponding sum of multipliers.
+         */
+        std::tuple<int, int> compute_max_score_reference(Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
         {
             unsigned int max_sum = 0;
             unsigned int max_multiplier_sum = 0;
 
-            Mahjong::initialize_score_table();
-
             std::vector<std::set<int>> combinations = get_combinations();
             std::set<int> used_tiles;
 
@@ -901,6 +1261,50 @@ namespace Mahjong
             return std::make_tuple(max_sum, max_multiplier_sum);
         }
 
+        /**
+         * @brief Searches the maximum score of the combinations from the given index on, not using the given slots.
+         *
+         * The combination at the current index is either skipped or (if it doesn't overlap the used slots) taken.
+         * Taking it is preferred on equal scores, and selections without any score yield a multiplier of zero,
+         * which reproduces the choices of get_score_recursive.
+         *
+         * @param masks The tile slots of each combination.
+         * @param scores The score and multiplier of each combination.
+         * @param remaining The union of the masks from each index on.
+         * @param index The index of the next combination.
+         * @param used The slots used by the selected combinations.
+         * @param memo The table memoizing the partial results.
+         *
+         * @return The maximum score and the corresponding sum of multipliers.
+         */
+        Mahjong::Combination_score search_max_score(const std::vector<std::uint32_t> &masks, const std::vector<Mahjong::Combination_score> &scores, const std::vector<std::uint32_t> &remaining, size_t index, std::uint32_t used, Mahjong::Score_memo &memo) const
+        {
+            MAHJONG_COUNT(max_score_search_nodes);
+            if (index == masks.size())
+                return Mahjong::Combination_score{0, 0};
+
+            // Only slots of the remaining combinations affect the result.
+            std::uint64_t key = (static_cast<std::uint64_t>(index) << 32) | (used & remaining[index]);
+            Mahjong::Combination_score best;
+            if (memo.find(key, best))
+            {
+                MAHJONG_COUNT(max_score_memo_hits);
+                return best;
+            }
+
+            best = search_max_score(masks, scores, remaining, index + 1, used, memo);
+            if ((masks[index] & used) == 0)
+            {
+                Mahjong::Combination_score next = search_max_score(masks, scores, remaining, index + 1, used | masks[index], memo);
+                int take_sum = next.score + scores[index].score;
+                if (take_sum > 0 && take_sum >= best.score)
+                    best = Mahjong::Combination_score{take_sum, next.multiplier + scores[index].multiplier};
+            }
+
+            memo.insert(key, best);
+            return best;
+        }
+
         /**
          * @brief Recursively explores all possible combinations of tiles to find the maximum Mahjong score.
          *
@@ -918,6 +1322,7 @@ namespace Mahjong
          */
         std::tuple<int, int> get_score_recursive(const std::vector<std::set<int>> &combinations, std::set<int> &used_tiles, int current_index, int current_multiplier_sum, Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
         {
+            MAHJONG_COUNT(score_recursive_calls);
             int max_sum = 0;
             int max_multiplier_sum = current_multiplier_sum;
 
@@ -964,7 +1369,7 @@ namespace Mahjong
         /**
          * @brief Computes the Mahjong score for a given combination of tiles.
          *
-         * This function initializes the Mahjong score table and calculates the score for a specific combination
+         * This function looks up the score for a specific combination
          * of tiles based on the combination type, suit, visibility of the tiles as well as the current seat and round winds.
          *
          * @param combination A set of integers representing the indices of tiles in the combination.
@@ -973,26 +1378,28 @@ namespace Mahjong
          *
          * @return A tuple containing the Mahjong score and the corresponding multiplier for the given combination.
          */
-        std::tuple<int, int> get_combination_score(std::set<int> combination, Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
+        std::tuple<int, int> get_combination_score(const std::set<int> &combination, Mahjong::Wind round_wind, Mahjong::Wind seat_wind) const
         {
-            Mahjong::initialize_score_table();
-
             unsigned int type = get_combination_type(combination);
             unsigned int suit = tiles[*std::next(combination.begin(), 0)].get_suit();
             unsigned int visibility = 0;
             unsigned int wind = 0;
 
-            std::set<int> all_visibilities;
+            bool any_hidden = false;
+            bool any_visible = false;
             for (int index : combination)
             {
-                all_visibilities.insert(static_cast<int>(tiles[index].is_hidden()));
+                if (tiles[index].is_hidden())
+                    any_hidden = true;
+                else
+                    any_visible = true;
             }
 
-            if (all_visibilities.count(0) == 0)
+            if (!any_visible)
             {
                 visibility = 1; // No visible tiles, i.e. all hidden.
             }
-            else if (all_visibilities.count(1) == 0)
+            else if (!any_hidden)
             {
                 visibility = 1; // No hidden tiles, i.e. all visible.
             }
@@ -1018,7 +1425,8 @@ namespace Mahjong
 
             // std::cout << type << suit << visibility << wind << "\n";
 
-            return Mahjong::score_table[{type, suit, visibility, wind}];
+            Mahjong::Combination_score score = Mahjong::lookup_combination_score(type, suit, visibility, wind);
+            return std::make_tuple(score.score, score.multiplier);
         }
 
         /**
@@ -1054,6 +1462,38 @@ namespace Mahjong
             return tiles;
         }
 
+        /**
+         * @brief Stores the tiles and the derived tile counts of the hand in a snapshot.
+         *
+         * @param snapshot The snapshot receiving the hand.
+         */
+        void save_snapshot(Mahjong::Hand_snapshot &snapshot) const
+        {
+            assert(tiles.size() <= MAX_HAND_TILES);
+            std::copy(tiles.begin(), tiles.end(), snapshot.tiles.begin());
+            snapshot.n_tiles = static_cast<unsigned char>(tiles.size());
+            snapshot.hidden_counts = hidden_counts;
+            snapshot.revealed_counts = revealed_counts;
+            snapshot.count_hash = count_hash;
+            snapshot.claim_masks = claim_masks;
+        }
+
+        /**
+         * @brief Restores the hand from a snapshot, reusing the storage of the tiles.
+         *
+         * The tile counts, count_hash and claim masks are copied instead of being recomputed.
+         *
+         * @param snapshot The snapshot of the hand.
+         */
+        void restore_snapshot(const Mahjong::Hand_snapshot &snapshot)
+        {
+            tiles.assign(snapshot.tiles.begin(), snapshot.tiles.begin() + snapshot.n_tiles);
+            hidden_counts = snapshot.hidden_counts;
+            revealed_counts = snapshot.revealed_counts;
+            count_hash = snapshot.count_hash;
+            claim_masks = snapshot.claim_masks;
+        }
+
         /**
          * @brief Returns the tile at the specified index in the player's hand.
          *
@@ -1079,7 +1519,64 @@ namespace Mahjong
          */
         unsigned int get_n_tile_occurence(Mahjong::Tile tile) const
         {
-            return std::count(tiles.begin(), tiles.end(), tile);
+            return hidden_counts[tile.get_kind()] + revealed_counts[tile.get_kind()];
+        }
+
+        /**
+         * @brief Returns the number of hidden occurrences of a specific tile in the player's hand.
+         *
+         * @param tile The tile whose hidden occurrences are to be counted.
+         *
+         * @return The number of hidden occurrences of the specified tile.
+         */
+        unsigned int get_n_hidden_tile_occurence(Mahjong::Tile tile) const
+        {
+            return hidden_counts[tile.get_kind()];
+        }
+
+        /**
+         * @brief Returns the number of revealed occurrences of a specific tile in the player's hand.
+         *
+         * @param tile The tile whose revealed occurrences are to be counted.
+         *
+         * @return The number of revealed occurrences of the specified tile.
+         */
+        unsigned int get_n_revealed_tile_occurence(Mahjong::Tile tile) const
+        {
+            return revealed_counts[tile.get_kind()];
+        }
+
+        /**
+         * @brief Returns the number of hidden tiles in the player's hand.
+         *
+         * @return The number of hidden tiles.
+         */
+        unsigned int get_n_hidden_tiles() const
+        {
+            unsigned int n = 0;
+            for (unsigned char count : hidden_counts)
+                n += count;
+            return n;
+        }
+
+        /**
+         * @brief Returns the number of hidden tiles per tile kind (see Tile::get_kind).
+         *
+         * @return Reference to the array of hidden tile counts.
+         */
+        const std::array<unsigned char, N_TILE_KINDS> &get_hidden_counts() const
+        {
+            return hidden_counts;
+        }
+
+        /**
+         * @brief Returns the number of revealed tiles per tile kind (see Tile::get_kind).
+         *
+         * @return Reference to the array of revealed tile counts.
+         */
+        const std::array<unsigned char, N_TILE_KINDS> &get_revealed_counts() const
+        {
+            return revealed_counts;
         }
 
         /**
@@ -1091,12 +1588,11 @@ namespace Mahjong
          */
         unsigned int get_n_tiles_of_suit(int suit) const
         {
+            unsigned int first_kind = Mahjong::Tile(suit, 0).get_kind();
+            unsigned int n_ranks = (suit == 3) ? 4 : (suit == 4) ? 3 : 9;
             unsigned int n = 0;
-            for (Mahjong::Tile tile : tiles)
-            {
-                if (tile.get_suit() == suit)
-                    n += 1;
-            }
+            for (unsigned int kind = first_kind; kind < first_kind + n_ranks; kind++)
+                n += hidden_counts[kind] + revealed_counts[kind];
             return n;
         }
 
@@ -1109,8 +1605,7 @@ namespace Mahjong
         {
             for (int index : indices)
             {
-                Mahjong::Tile &tile = tiles[index];
-                tile.set_visible();
+                reveal_tile(index);
             }
         }
 
@@ -1122,9 +1617,10 @@ namespace Mahjong
         std::set<int> get_all_suits() const
         {
             std::set<int> all_suits;
-            for (Mahjong::Tile tile : tiles)
+            for (int suit = 0; suit < 5; suit++)
             {
-                all_suits.insert(tile.get_suit());
+                if (get_n_tiles_of_suit(suit) > 0)
+                    all_suits.insert(suit);
             }
             return all_suits;
         }
@@ -1137,12 +1633,10 @@ namespace Mahjong
         std::set<int> get_all_ranks() const
         {
             std::set<int> all_ranks;
-            for (Mahjong::Tile tile : tiles)
+            for (unsigned int kind = 0; kind < 27; kind++)
             {
-                if (tile.get_suit() < 3)
-                {
-                    all_ranks.insert(tile.get_rank());
-                }
+                if (hidden_counts[kind] + revealed_counts[kind] > 0)
+                    all_ranks.insert(kind % 9);
             }
             return all_ranks;
         }
@@ -0,0 +1,414 @@
+/**
+ * @file Inference_queue.hpp
+ * @brief Defines the batched inference of network policies over many suspended games.
+ *
+ * The seats played by a network are external players (see Game::set_external_player), so a game suspends at each
+ * of their decisions instead of blocking a thread. The decision is encoded as an observation and a legal-action
+ * mask (see Observation.hpp and Environment.hpp) and pushed to a shared Inference_queue. The queue hands a batch of
+ * requests to a pluggable inference callback once it holds batch_size requests or its oldest request waited
+ * max_delay, whichever comes first, and dispatches the chosen actions back to the clients owning the games.
+ * Batched_inference_runner plays many games per thread this way, so a single network evaluation serves the
+ * decisions of thousands of games while all game and policy logic is reused.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Environment.hpp"
+#include "Game.hpp"
+#include "Observation.hpp"
+#include "Simulation_runner.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Callback evaluating a batch of requests, e.g. by running a network on an accelerator.
+     *
+     * Called with n_requests rows of OBSERVATION_SIZE observation values and N_ENVIRONMENT_ACTIONS mask flags, it
+     * writes one legal environment action per row (see Environment.hpp) to the n_requests actions. Illegal actions
+     * are replaced by the first legal one.
+     */
+    using Inference_callback = std::function<void(const float *observations, const unsigned char *action_masks, std::size_t n_requests, int *actions)>;
+
+    /**
+     * @brief A request answered by an inference, identified by the tag given by its client.
+     */
+    struct Inference_result
+    {
+        std::uint64_t tag; ///< Tag of the request, e.g. the index of the waiting game.
+        int action;        ///< The chosen environment action.
+    };
+
+    /**
+     * @class Inference_client
+     * @brief Mailbox of the answered requests of one producer, e.g. one thread playing a set of games.
+     */
+    class Inference_client
+    {
+    private:
+        friend class Inference_queue;
+
+        std::mutex mutex;                      ///< Guards the results.
+        std::condition_variable results_ready; ///< Notified when results are added.
+        std::vector<Inference_result> results; ///< Answered requests not yet taken.
+    };
+
+    /**
+     * @class Inference_queue
+     * @brief Collects inference requests of many games and evaluates them in batches.
+     *
+     * Requests may be pushed from several threads. A batch is evaluated by the thread completing it, or by a
+     * waiting client once the oldest request is due, and requests arriving meanwhile collect in the next batch.
+     */
+    class Inference_queue
+    {
+    private:
+        /**
+         * @brief Requests evaluated together.
+         */
+        struct Batch
+        {
+            std::vector<float> observations;         ///< OBSERVATION_SIZE values per request.
+            std::vector<unsigned char> action_masks; ///< N_ENVIRONMENT_ACTIONS flags per request.
+            std::vector<std::uint64_t> tags;         ///< Tag per request.
+            std::vector<Inference_client *> clients; ///< Client per request.
+            std::chrono::steady_clock::time_point oldest; ///< Time of the first request.
+
+            /**
+             * @brief Gets the number of requests.
+             */
+            std::size_t size() const
+            {
+                return tags.size();
+            }
+
+            /**
+             * @brief Removes all requests, keeping the allocated buffers.
+             */
+            void clear()
+            {
+                observations.clear();
+                action_masks.clear();
+                tags.clear();
+                clients.clear();
+            }
+        };
+
+        std::size_t batch_size;               ///< Number of requests triggering an evaluation.
+        std::chrono::microseconds max_delay;  ///< Time after which a request triggers an evaluation.
+        Mahjong::Inference_callback callback; ///< The evaluation of a batch.
+
+        std::mutex mutex;         ///< Guards the pending batch and the statistics.
+        Batch pending;            ///< Requests not yet evaluated.
+        std::uint64_t n_batches = 0;  ///< Number of evaluated batches.
+        std::uint64_t n_requests = 0; ///< Number of evaluated requests.
+
+        std::mutex flush_mutex; ///< Serializes the evaluations and guards the buffers below.
+        Batch flushing;         ///< The batch being evaluated.
+        std::vector<int> actions; ///< The actions chosen for the batch being evaluated.
+
+        /**
+         * @brief Gets whether the pending batch must be evaluated, the mutex being locked.
+         */
+        bool is_due(std::chrono::steady_clock::time_point now) const
+        {
+            return pending.size() >= batch_size || (pending.size() > 0 && now - pending.oldest >= max_delay);
+        }
+
+    public:
+        /**
+         * @brief Constructor for the Inference_queue class.
+         *
+         * @param batch_size_in Number of requests triggering an evaluation (at least one).
+         * @param max_delay_in Time after which the oldest request triggers an evaluation.
+         * @param callback_in The evaluation of a batch.
+         */
+        Inference_queue(std::size_t batch_size_in, std::chrono::microseconds max_delay_in, Mahjong::Inference_callback callback_in)
+            : batch_size(std::max<std::size_t>(1, batch_size_in)), max_delay(max_delay_in), callback(std::move(callback_in))
+        {
+            pending.observations.reserve(batch_size * OBSERVATION_SIZE);
+            pending.action_masks.reserve(batch_size * N_ENVIRONMENT_ACTIONS);
+            pending.tags.reserve(batch_size);
+            pending.clients.reserve(batch_size);
+        }
+
+        Inference_queue(const Inference_queue &) = delete;
+        Inference_queue &operator=(const Inference_queue &) = delete;
+
+        /**
+         * @brief Pushes the pending decision of an external player, evaluating the batch once it is full.
+         *
+         * @param client The client receiving the result.
+         * @param tag The tag of the result.
+         * @param game The game waiting for the decision.
+         */
+        void push(Mahjong::Inference_client &client, std::uint64_t tag, const Mahjong::Game &game)
+        {
+            Mahjong::Decision decision = game.pending_decision();
+            bool full;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending.size() == 0)
+                    pending.oldest = std::chrono::steady_clock::now();
+                pending.observations.resize(pending.observations.size() + OBSERVATION_SIZE);
+                pending.action_masks.resize(pending.action_masks.size() + N_ENVIRONMENT_ACTIONS);
+                encode_observation(game.get_game_state_for_player(decision.player_number), decision.action_type, pending.observations.data() + pending.observations.size() - OBSERVATION_SIZE);
+                write_environment_action_mask(game.get_player_hand(decision.player_number), decision, pending.action_masks.data() + pending.action_masks.size() - N_ENVIRONMENT_ACTIONS);
+                pending.tags.push_back(tag);
+                pending.clients.push_back(&client);
+                full = pending.size() >= batch_size;
+            }
+            if (full)
+                flush_if_due();
+        }
+
+        /**
+         * @brief Evaluates the pending requests and dispatches the results to their clients.
+         *
+         * @param force Whether to evaluate the requests even if the batch is neither full nor due.
+         * @return True if requests were evaluated.
+         */
+        bool flush_if_due(bool force = false)
+        {
+            std::lock_guard<std::mutex> flush_lock(flush_mutex);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending.size() == 0 || !(force || is_due(std::chrono::steady_clock::now())))
+                    return false;
+                std::swap(pending, flushing);
+                pending.clear();
+                n_batches += 1;
+                n_requests += flushing.size();
+            }
+
+            const std::size_t n = flushing.size();
+            actions.assign(n, -1);
+            callback(flushing.observations.data(), flushing.action_masks.data(), n, actions.data());
+
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const unsigned char *mask = flushing.action_masks.data() + i * N_ENVIRONMENT_ACTIONS;
+                if (actions[i] < 0 || actions[i] >= static_cast<int>(N_ENVIRONMENT_ACTIONS) || !mask[actions[i]])
+                    actions[i] = std::find(mask, mask + N_ENVIRONMENT_ACTIONS, 1) - mask;
+            }
+            // Clients of consecutive requests are usually the same, so results are handed over in runs.
+            for (std::size_t begin = 0; begin < n;)
+            {
+                Inference_client &client = *flushing.clients[begin];
+                std::size_t end = begin;
+                {
+                    std::lock_guard<std::mutex> lock(client.mutex);
+                    for (; end < n && flushing.clients[end] == &client; end++)
+                        client.results.push_back({flushing.tags[end], actions[end]});
+                }
+                client.results_ready.notify_all();
+                begin = end;
+            }
+            flushing.clear();
+            return true;
+        }
+
+        /**
+         * @brief Waits until results of the client are available, evaluating the pending requests once they are due.
+         *
+         * The client must have requests in the queue which are not answered yet, or answered results not yet taken.
+         *
+         * @param client The waiting client.
+         * @param results Receives the results of the client.
+         */
+        void wait_for_results(Mahjong::Inference_client &client, std::vector<Mahjong::Inference_result> &results)
+        {
+            results.clear();
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(client.mutex);
+                    if (!client.results.empty())
+                    {
+                        results.swap(client.results);
+                        return;
+                    }
+                }
+                if (flush_if_due())
+                    continue;
+
+                bool has_pending;
+                std::chrono::steady_clock::time_point deadline;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    has_pending = pending.size() > 0;
+                    deadline = pending.oldest + max_delay;
+                }
+                // Without pending requests the results of the client are being evaluated by another thread.
+                std::unique_lock<std::mutex> lock(client.mutex);
+                if (has_pending)
+                    client.results_ready.wait_until(lock, deadline, [&]()
+                                                    { return !client.results.empty(); });
+                else
+                    client.results_ready.wait(lock, [&]()
+                                              { return !client.results.empty(); });
+            }
+        }
+
+        /**
+         * @brief Gets the number of evaluated batches.
+         */
+        std::uint64_t get_n_batches()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return n_batches;
+        }
+
+        /**
+         * @brief Gets the number of evaluated requests.
+         */
+        std::uint64_t get_n_requests()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return n_requests;
+        }
+    };
+
+    /**
+     * @class Batched_inference_runner
+     * @brief Plays a batch of headless games whose network seats are decided through an Inference_queue.
+     *
+     * Every thread keeps several games in flight, advancing the others while a game waits for its inference, and
+     * only blocks once all of its games wait. The queue may be shared with other runners.
+     */
+    class Batched_inference_runner
+    {
+    private:
+        unsigned int n_games;                         ///< Number of games to be played.
+        unsigned int n_threads;                       ///< Number of worker threads.
+        unsigned int n_games_per_thread;              ///< Number of games in flight per worker thread.
+        std::array<Mahjong::Policy_type, 4> policies; ///< Policy per seat, ignored for network seats.
+        std::array<bool, 4> network_seats;            ///< Whether the network decides for a seat.
+        std::uint64_t seed;                           ///< Base seed, the seed of each game is derived from it and the game index.
+        Mahjong::Inference_queue &queue;              ///< The queue evaluating the network decisions.
+
+    public:
+        /**
+         * @brief Constructor for the Batched_inference_runner class.
+         *
+         * @param n_games_in Number of games to be played.
+         * @param n_threads_in Number of worker threads (at least one is used).
+         * @param n_games_per_thread_in Number of games in flight per worker thread (at least one).
+         * @param policies_in Policy per seat, ignored for network seats.
+         * @param network_seats_in Whether the network decides for a seat.
+         * @param queue_in The queue evaluating the network decisions, which must outlive the run.
+         * @param seed_in Base seed of the simulation.
+         */
+        Batched_inference_runner(unsigned int n_games_in, unsigned int n_threads_in, unsigned int n_games_per_thread_in, std::array<Mahjong::Policy_type, 4> policies_in,
+                                 std::array<bool, 4> network_seats_in, Mahjong::Inference_queue &queue_in, std::uint64_t seed_in = 0)
+            : n_games(n_games_in), n_threads(std::max(1u, n_threads_in)), n_games_per_thread(std::max(1u, n_games_per_thread_in)), policies(policies_in),
+              network_seats(network_seats_in), seed(seed_in), queue(queue_in) {}
+
+        /**
+         * @brief Plays all games and returns the merged results.
+         *
+         * Every game is seeded from the base seed and its index like in Simulation_runner, so the results depend
+         * on the inference callback only, not on the batching, the number of threads or the order of the games.
+         *
+         * @return The merged results of all games.
+         */
+        Simulation_results run()
+        {
+            Work_stealing_queue indices(n_games, n_threads);
+            std::vector<Simulation_results> worker_results(n_threads);
+
+            auto worker = [&](unsigned int worker_index)
+            {
+                std::vector<Mahjong::Game> games;
+                games.reserve(n_games_per_thread);
+                for (unsigned int slot = 0; slot < n_games_per_thread; slot++)
+                {
+                    games.emplace_back(worker_index);
+                    for (unsigned int seat = 0; seat < policies.size(); seat++)
+                    {
+                        games[slot].set_player_policy(seat, policies[seat]);
+                        games[slot].set_external_player(seat, network_seats[seat]);
+                    }
+                }
+                Simulation_results &results = worker_results[worker_index];
+                Inference_client client;
+                std::vector<Inference_result> answered;
+                unsigned int n_waiting = 0;
+
+                // Plays the game of a slot until it waits for the network, starting new games as long as any are left.
+                auto advance_slot = [&](unsigned int slot)
+                {
+                    Mahjong::Game &game = games[slot];
+                    while (true)
+                    {
+                        game.advance();
+                        if (game.has_pending_decision())
+                        {
+                            queue.push(client, slot, game);
+                            n_waiting += 1;
+                            return;
+                        }
+                        Simulation_runner::add_game_results(game, results);
+
+                        unsigned int game_index;
+                        if (!indices.pop(worker_index, game_index))
+                            return;
+                        game.reset(Mahjong::derive_seed(seed, game_index));
+                        game.set_current_player(game.get_rng().bounded(N_PLAYERS));
+                    }
+                };
+
+                for (unsigned int slot = 0; slot < n_games_per_thread; slot++)
+                {
+                    unsigned int game_index;
+                    if (!indices.pop(worker_index, game_index))
+                        break;
+                    games[slot].reset(Mahjong::derive_seed(seed, game_index));
+                    games[slot].set_current_player(games[slot].get_rng().bounded(N_PLAYERS));
+                    advance_slot(slot);
+                }
+
+                while (n_waiting > 0)
+                {
+                    queue.wait_for_results(client, answered);
+                    for (const Inference_result &result : answered)
+                    {
+                        Mahjong::Game &game = games[result.tag];
+                        Mahjong::Decision decision = game.pending_decision();
+                        bool submitted = game.submit(get_decision_action(game.get_player_hand(decision.player_number), decision, result.action));
+                        assert(submitted);
+                        (void)submitted;
+                        n_waiting -= 1;
+                        advance_slot(result.tag);
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int worker_index = 0; worker_index < n_threads; worker_index++)
+                threads.emplace_back(worker, worker_index);
+            for (std::thread &thread : threads)
+                thread.join();
+
+            Simulation_results results;
+            for (const Simulation_results &partial : worker_results)
+                results.merge(partial);
+            return results;
+        }
+    };
+} // namespace Mahjong
@@ -0,0 +1,373 @@
+/**
+ * @file Instrumentation.hpp
+ * @brief Defines opt-in counters and timers of the hot paths of the game and its policies.
+ *
+ * The hot paths count their work through the MAHJONG_COUNT and MAHJONG_TIME_SCOPE macros. Unless
+ * `MAHJONG_INSTRUMENT` is defined, both macros expand to nothing and the instrumentation is not even compiled.
+ * Each thread counts into its own Instrumentation_counters, which are only merged when a report is requested
+ * (see get_instrumentation_report), so counting needs neither atomics nor locks.
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "Action.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+#ifdef MAHJONG_INSTRUMENT
+    /** @brief Whether the instrumentation is compiled in. */
+    constexpr bool INSTRUMENTATION_ENABLED = true;
+#else
+    /** @brief Whether the instrumentation is compiled in. */
+    constexpr bool INSTRUMENTATION_ENABLED = false;
+#endif
+
+    /**
+     * @brief Counted events of the hot paths.
+     */
+    enum class Counter
+    {
+        winning_hand_checks,                    ///< Calls of is_complete_hand, i.e. of Hand::is_winning_hand.
+        winning_hand_wrong_tile_count,          ///< Checks rejected because the hand does not hold 14 tiles.
+        winning_hand_no_revealed_decomposition, ///< Checks rejected because the revealed tiles do not decompose.
+        winning_hand_no_hidden_decomposition,   ///< Checks rejected because the hidden tiles do not decompose.
+        winning_hand_no_pair,                   ///< Checks rejected because no decomposition holds exactly one pair.
+        winning_hands,                          ///< Checks finding a winning hand.
+        decomposition_lookups,                  ///< Lookups of suit and honour decompositions by get_decomposition_values.
+        score_cache_hits,                       ///< Hands scored from the Score_cache by Hand::get_max_score.
+        score_cache_misses,                     ///< Hands scored by Hand::compute_max_score after a cache miss.
+        max_score_search_nodes,                 ///< Calls of Hand::search_max_score, including memo hits.
+        max_score_memo_hits,                    ///< Calls of Hand::search_max_score answered by the Score_memo.
+        dlx_nodes_visited,                      ///< Search nodes of the exact cover solvers, which only the benchmarks use.
+        dlx_covers_found,                       ///< Exact covers found by the exact cover solvers.
+        score_recursive_calls,                  ///< Calls of Hand::get_score_recursive, i.e. of the reference scoring.
+    };
+
+    /** @brief Number of counters. */
+    const unsigned int N_COUNTERS = 14;
+
+    /** @brief String names of the counters, indexed by their value. */
+    constexpr std::array<const char *, N_COUNTERS> COUNTER_NAMES = {
+        "winning_hand_checks", "winning_hand_wrong_tile_count", "winning_hand_no_revealed_decomposition",
+        "winning_hand_no_hidden_decomposition", "winning_hand_no_pair", "winning_hands", "decomposition_lookups",
+        "score_cache_hits", "score_cache_misses", "max_score_search_nodes", "max_score_memo_hits", "dlx_nodes_visited",
+        "dlx_covers_found", "score_recursive_calls"};
+
+    /**
+     * @brief Accumulated durations of a timed section.
+     */
+    struct Timer_stats
+    {
+        std::uint64_t n_calls = 0;  ///< Number of timed calls.
+        std::uint64_t total_ns = 0; ///< Sum of the durations in nanoseconds.
+        std::uint64_t max_ns = 0;   ///< Longest duration in nanoseconds.
+
+        /**
+         * @brief Adds a single duration.
+         *
+         * @param ns The duration in nanoseconds.
+         */
+        void add(std::uint64_t ns)
+        {
+            n_calls += 1;
+            total_ns += ns;
+            if (ns > max_ns)
+                max_ns = ns;
+        }
+
+        /**
+         * @brief Adds the durations of another timer to this one.
+         *
+         * @param other The timer to be merged.
+         */
+        void merge(const Timer_stats &other)
+        {
+            n_calls += other.n_calls;
+            total_ns += other.total_ns;
+            if (other.max_ns > max_ns)
+                max_ns = other.max_ns;
+        }
+    };
+
+    /**
+     * @brief Counters and timers of a single thread, or the merged ones of several threads.
+     */
+    struct Instrumentation_counters
+    {
+        std::array<std::uint64_t, N_COUNTERS> counts = {};              ///< Count per counter.
+        std::array<Timer_stats, N_POLICY_TYPES * 2> select_action = {}; ///< Policy::select_action per policy and action type.
+        Timer_stats game;                                               ///< Wall-clock time of the simulated games.
+
+        /**
+         * @brief Gets the count of a counter.
+         *
+         * @param counter The counter.
+         * @return A reference to its count.
+         */
+        std::uint64_t &get_count(Mahjong::Counter counter)
+        {
+            return counts[static_cast<std::size_t>(counter)];
+        }
+
+        /**
+         * @brief Gets the timer of the decisions of a policy.
+         *
+         * @param policy The configured policy of the deciding player.
+         * @param action_type The type of the decision.
+         * @return A reference to the timer.
+         */
+        Timer_stats &get_select_action_timer(Mahjong::Policy_type policy, Mahjong::Action_type action_type)
+        {
+            return select_action[static_cast<std::size_t>(policy) * 2 + static_cast<std::size_t>(action_type)];
+        }
+
+        /**
+         * @brief Adds the counters and timers of another thread to these ones.
+         *
+         * @param other The counters to be merged.
+         */
+        void merge(const Instrumentation_counters &other)
+        {
+            for (std::size_t i = 0; i < counts.size(); i++)
+                counts[i] += other.counts[i];
+            for (std::size_t i = 0; i < select_action.size(); i++)
+                select_action[i].merge(other.select_action[i]);
+            game.merge(other.game);
+        }
+    };
+
+    /**
+     * @class Instrumentation_registry
+     * @brief Keeps track of the counters of all threads, folding the counters of finished threads into a total.
+     */
+    class Instrumentation_registry
+    {
+    private:
+        std::mutex mutex;                             ///< Guards the members below.
+        std::vector<Instrumentation_counters *> live; ///< Counters of the running threads.
+        Instrumentation_counters retired;             ///< Merged counters of the finished threads.
+
+    public:
+        /**
+         * @brief Registers the counters of a starting thread.
+         *
+         * @param counters The counters of the thread.
+         */
+        void add(Instrumentation_counters &counters)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            live.push_back(&counters);
+        }
+
+        /**
+         * @brief Folds the counters of a finishing thread into the total.
+         *
+         * @param counters The counters of the thread.
+         */
+        void remove(const Instrumentation_counters &counters)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired.merge(counters);
+            for (std::size_t i = 0; i < live.size(); i++)
+            {
+                if (live[i] == &counters)
+                {
+                    live[i] = live.back();
+                    live.pop_back();
+                    break;
+                }
+            }
+        }
+
+        /**
+         * @brief Merges the counters of all threads.
+         *
+         * The counters of running threads are read without synchronization, so they must be idle, e.g. waiting
+         * for work in a thread pool.
+         *
+         * @return The merged counters.
+         */
+        Instrumentation_counters get_report()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Instrumentation_counters report = retired;
+            for (const Instrumentation_counters *counters : live)
+                report.merge(*counters);
+            return report;
+        }
+
+        /**
+         * @brief Zeroes the counters of all threads, which must be idle.
+         */
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            retired = Instrumentation_counters();
+            for (Instrumentation_counters *counters : live)
+                *counters = Instrumentation_counters();
+        }
+    };
+
+    /**
+     * @brief Gets the registry of the counters of all threads.
+     *
+     * @return The registry.
+     */
+    inline Instrumentation_registry &get_instrumentation_registry()
+    {
+        static Instrumentation_registry registry;
+        return registry;
+    }
+
+    /**
+     * @class Thread_instrumentation
+     * @brief The counters of a thread, registered for the lifetime of the thread.
+     */
+    class Thread_instrumentation
+    {
+    private:
+        Instrumentation_counters counters; ///< The counters of the thread.
+
+    public:
+        Thread_instrumentation()
+        {
+            get_instrumentation_registry().add(counters);
+        }
+
+        ~Thread_instrumentation()
+        {
+            get_instrumentation_registry().remove(counters);
+        }
+
+        Thread_instrumentation(const Thread_instrumentation &) = delete;
+        Thread_instrumentation &operator=(const Thread_instrumentation &) = delete;
+
+        /**
+         * @brief Gets the counters of the thread.
+         *
+         * @return A reference to the counters.
+         */
+        Instrumentation_counters &get_counters()
+        {
+            return counters;
+        }
+    };
+
+    /**
+     * @brief Gets the counters of the calling thread.
+     *
+     * @return A reference to the counters.
+     */
+    inline Instrumentation_counters &get_thread_instrumentation()
+    {
+        thread_local Thread_instrumentation instrumentation;
+        return instrumentation.get_counters();
+    }
+
+    /**
+     * @brief Merges the counters of all threads, which must be idle or finished.
+     *
+     * @return The merged counters.
+     */
+    inline Instrumentation_counters get_instrumentation_report()
+    {
+        return get_instrumentation_registry().get_report();
+    }
+
+    /**
+     * @brief Zeroes the counters of all threads, which must be idle or finished.
+     */
+    inline void reset_instrumentation()
+    {
+        get_instrumentation_registry().clear();
+    }
+
+    /**
+     * @class Scoped_timer
+     * @brief Adds the lifetime of the timer to a Timer_stats.
+     */
+    class Scoped_timer
+    {
+    private:
+        Timer_stats &stats;                          ///< The receiver of the duration.
+        std::chrono::steady_clock::time_point start; ///< Construction time of the timer.
+
+    public:
+        /**
+         * @brief Constructor starting the timer.
+         *
+         * @param stats_in The receiver of the duration.
+         */
+        explicit Scoped_timer(Timer_stats &stats_in) : stats(stats_in), start(std::chrono::steady_clock::now()) {}
+
+        ~Scoped_timer()
+        {
+            stats.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        Scoped_timer(const Scoped_timer &) = delete;
+        Scoped_timer &operator=(const Scoped_timer &) = delete;
+    };
+
+    /**
+     * @brief Writes a timer as a JSON object.
+     *
+     * @param out The output stream.
+     * @param stats The timer.
+     */
+    inline void write_timer_json(std::ostream &out, const Timer_stats &stats)
+    {
+        out << "{\"n_calls\": " << stats.n_calls << ", \"total_ns\": " << stats.total_ns
+            << ", \"mean_ns\": " << (stats.n_calls > 0 ? static_cast<double>(stats.total_ns) / stats.n_calls : 0.0)
+            << ", \"max_ns\": " << stats.max_ns << "}";
+    }
+
+    /**
+     * @brief Writes counters and timers as a JSON document.
+     *
+     * Timers of policies which never decided are omitted.
+     *
+     * @param out The output stream.
+     * @param counters The counters, e.g. from get_instrumentation_report.
+     */
+    inline void write_instrumentation_json(std::ostream &out, const Instrumentation_counters &counters)
+    {
+        out << "{\n  \"enabled\": " << (INSTRUMENTATION_ENABLED ? "true" : "false") << ",\n  \"counters\": {\n";
+        for (std::size_t i = 0; i < N_COUNTERS; i++)
+            out << "    \"" << COUNTER_NAMES[i] << "\": " << counters.counts[i] << (i + 1 < N_COUNTERS ? "," : "") << "\n";
+        out << "  },\n  \"select_action\": {";
+        bool first = true;
+        for (std::size_t i = 0; i < counters.select_action.size(); i++)
+        {
+            if (counters.select_action[i].n_calls == 0)
+                continue;
+            out << (first ? "\n" : ",\n") << "    \"" << POLICY_NAMES[i / 2] << "/" << (i % 2 == 0 ? "discard" : "pickup") << "\": ";
+            write_timer_json(out, counters.select_action[i]);
+            first = false;
+        }
+        out << (first ? "" : "\n  ") << "},\n  \"game\": ";
+        write_timer_json(out, counters.game);
+        out << "\n}\n";
+    }
+} // namespace Mahjong
+
+#ifdef MAHJONG_INSTRUMENT
+/** @brief Increments a counter of the calling thread (see Mahjong::Counter). */
+#define MAHJONG_COUNT(counter) (++Mahjong::get_thread_instrumentation().get_count(Mahjong::Counter::counter))
+/** @brief Times the rest of the enclosing scope into the given Timer_stats of the calling thread. */
+#define MAHJONG_TIME_SCOPE(timer) Mahjong::Scoped_timer mahjong_scoped_timer(Mahjong::get_thread_instrumentation().timer)
+#else
+#define MAHJONG_COUNT(counter) ((void)0)
+#define MAHJONG_TIME_SCOPE(timer) ((void)0)
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file Logging.hpp
+ * @brief Defines the log sinks receiving the text output of a Mahjong game.
+ *
+ * Messages are emitted through the MAHJONG_LOG macro, which only formats a message if the current sink accepts
+ * its level. If `MAHJONG_SILENT` is defined, MAHJONG_LOG generates no code and the messages are only checked by
+ * the compiler, which is meant for headless simulations.
+ */
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Severity levels of log messages, ordered by increasing importance.
+     */
+    enum class Log_level
+    {
+        debug,   ///< Diagnostic output of the algorithms.
+        info,    ///< Game events and displayed hands, i.e. the regular console output.
+        warning, ///< Invalid requests, e.g. drawing into a full hand.
+    };
+
+#ifdef MAHJONG_SILENT
+    /** @brief Whether log messages are compiled in. */
+    constexpr bool LOGGING_ENABLED = false;
+#else
+    /** @brief Whether log messages are compiled in. */
+    constexpr bool LOGGING_ENABLED = true;
+#endif
+
+    /**
+     * @class Log_sink
+     * @brief Interface of the receivers of log messages.
+     */
+    class Log_sink
+    {
+    private:
+        Log_level min_level; ///< The lowest level accepted by the sink.
+
+    public:
+        /**
+         * @brief Constructor for the Log_sink class.
+         *
+         * @param min_level_in The lowest level accepted by the sink.
+         */
+        explicit Log_sink(Log_level min_level_in = Log_level::debug) : min_level(min_level_in) {}
+
+        virtual ~Log_sink() = default;
+
+        /**
+         * @brief Checks whether messages of the given level are accepted, i.e. whether they need to be formatted.
+         *
+         * @param level The level of the message.
+         * @return True if the sink accepts the level, false otherwise.
+         */
+        virtual bool accepts(Log_level level) const
+        {
+            return level >= min_level;
+        }
+
+        /**
+         * @brief Sets the lowest level accepted by the sink.
+         *
+         * @param min_level_in The new lowest level.
+         */
+        void set_min_level(Log_level min_level_in)
+        {
+            min_level = min_level_in;
+        }
+
+        /**
+         * @brief Receives a formatted message.
+         *
+         * @param level The level of the message.
+         * @param message The message, including its line breaks.
+         */
+        virtual void write(Log_level level, const std::string &message) = 0;
+    };
+
+    /**
+     * @class Console_sink
+     * @brief Writes all messages to std::cout, the output of the interactive game.
+     */
+    class Console_sink : public Log_sink
+    {
+    public:
+        using Log_sink::Log_sink;
+
+        void write(Log_level, const std::string &message) override
+        {
+            std::cout << message << std::flush;
+        }
+    };
+
+    /**
+     * @class Null_sink
+     * @brief Discards all messages without formatting them.
+     */
+    class Null_sink : public Log_sink
+    {
+    public:
+        bool accepts(Log_level) const override
+        {
+            return false;
+        }
+
+        void write(Log_level, const std::string &) override {}
+    };
+
+    /**
+     * @brief Gets the storage of the current sink, initially a console sink.
+     */
+    inline std::atomic<Log_sink *> &get_log_sink_storage()
+    {
+        static Console_sink console_sink;
+        static std::atomic<Log_sink *> sink(&console_sink);
+        return sink;
+    }
+
+    /**
+     * @brief Gets the sink overriding the shared sink on the calling thread, nullptr if there is none.
+     */
+    inline Log_sink *&get_thread_log_sink()
+    {
+        thread_local Log_sink *sink = nullptr;
+        return sink;
+    }
+
+    /**
+     * @brief Gets the sink receiving the log messages of the calling thread.
+     *
+     * @return Reference to the sink of the thread if one is set (see Scoped_log_sink), the shared sink otherwise.
+     */
+    inline Log_sink &get_log_sink()
+    {
+        Log_sink *thread_sink = get_thread_log_sink();
+        if (thread_sink != nullptr)
+            return *thread_sink;
+        return *get_log_sink_storage().load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Replaces the sink receiving all log messages.
+     *
+     * The sink must outlive its use and should be set before games are played on multiple threads.
+     *
+     * @param sink The new sink.
+     */
+    inline void set_log_sink(Log_sink &sink)
+    {
+        get_log_sink_storage().store(&sink, std::memory_order_release);
+    }
+
+    /**
+     * @class Scoped_log_sink
+     * @brief Redirects the log messages of the calling thread to another sink while it is alive.
+     *
+     * Used to silence games played internally, e.g. the rollouts of a search, without affecting other threads.
+     */
+    class Scoped_log_sink
+    {
+    private:
+        Log_sink *previous_sink; ///< The sink of the thread before the redirection.
+
+    public:
+        /**
+         * @brief Constructor redirecting the messages of the calling thread.
+         *
+         * @param sink The sink receiving the messages, it must outlive this object.
+         */
+        explicit Scoped_log_sink(Log_sink &sink) : previous_sink(get_thread_log_sink())
+        {
+            get_thread_log_sink() = &sink;
+        }
+
+        Scoped_log_sink(const Scoped_log_sink &) = delete;
+        Scoped_log_sink &operator=(const Scoped_log_sink &) = delete;
+
+        /**
+         * @brief Destructor restoring the previous sink of the thread.
+         */
+        ~Scoped_log_sink()
+        {
+            get_thread_log_sink() = previous_sink;
+        }
+    };
+
+    /**
+     * @brief Checks whether messages of the given level are compiled in and accepted by the current sink.
+     *
+     * Used to skip the preparation of whole displays, e.g. computing a score only to print it.
+     *
+     * @param level The level of the message.
+     * @return True if messages of the level are written, false otherwise.
+     */
+    inline bool is_log_enabled(Log_level level)
+    {
+        return LOGGING_ENABLED && get_log_sink().accepts(level);
+    }
+} // namespace Mahjong
+
+#ifdef MAHJONG_SILENT
+// The message stays in a discarded branch, so it is still checked and its variables count as used.
+#define MAHJONG_LOG(level, message)                \
+    do                                             \
+    {                                              \
+        if constexpr (false)                       \
+        {                                          \
+            std::ostringstream mahjong_log_stream; \
+            mahjong_log_stream << message;         \
+            (void)(level);                         \
+        }                                          \
+    } while (false)
+#else
+/**
+ * @brief Formats a message with operator<< and writes it to the current sink, if the sink accepts the level.
+ *
+ * Example: `MAHJONG_LOG(Mahjong::Log_level::info, "Discard " << tile.get_tile_as_string() << "\n");`
+ */
+#define MAHJONG_LOG(level, message)                                    \
+    do                                                                 \
+    {                                                                  \
+        Mahjong::Log_sink &mahjong_log_sink = Mahjong::get_log_sink(); \
+        if (mahjong_log_sink.accepts(level))                           \
+        {                                                              \
+            std::ostringstream mahjong_log_stream;                     \
+            mahjong_log_stream << message;                             \
+            mahjong_log_sink.write(level, mahjong_log_stream.str());   \
+        }                                                              \
+    } while (false)
+#endif
@@ -0,0 +1,421 @@
+/**
+ * @file Monte_carlo.hpp
+ * @brief Defines the monte_carlo policy, choosing actions by determinized rollouts on a pool of worker threads.
+ *
+ * For every decision the hidden tiles of the opponents and the order of the set are sampled consistently with
+ * what the deciding player has seen (determinization). Each candidate action is applied to such a sampled game,
+ * which is then played to its end by the cheap rollout policy. The candidate with the best average final score of
+ * the deciding player is chosen. Every hand is scored on its own at the end of a game, so the opponents' scores
+ * are not part of the outcome.
+ */
+#pragma once
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Action.hpp"
+#include "Game.hpp"
+#include "Game_snapshot.hpp"
+#include "Logging.hpp"
+#include "Random.hpp"
+#include "State_view.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @class Rollout_pool
+     * @brief Persistent worker threads sharing the rollouts of a decision with the deciding thread.
+     *
+     * Only one decision uses the workers at a time. Decisions made while the workers are busy, e.g. by games
+     * simulated in parallel, run on their own thread only, so the pool never oversubscribes the machine.
+     * The log messages of the workers are discarded.
+     */
+    class Rollout_pool
+    {
+    private:
+        std::vector<std::thread> workers;         ///< The worker threads.
+        std::mutex job_mutex;                     ///< Held by the decision currently using the workers.
+        std::mutex mutex;                         ///< Protects the members below.
+        std::condition_variable job_ready;        ///< Signals a new job or the shutdown to the workers.
+        std::condition_variable job_done;         ///< Signals that all workers finished the current job.
+        const std::function<void()> *job = nullptr; ///< The current job.
+        unsigned int n_job_workers = 0;           ///< Number of workers taking part in the current job.
+        unsigned int n_active_workers = 0;        ///< Number of workers still running the current job.
+        std::uint64_t generation = 0;             ///< Number of jobs started so far.
+        bool stopping = false;                    ///< Whether the workers are to be shut down.
+
+        /**
+         * @brief Runs the jobs assigned to a worker until the pool is destroyed.
+         *
+         * @param worker_index The index of the worker.
+         */
+        void work(unsigned int worker_index)
+        {
+            Mahjong::Null_sink null_sink;
+            Mahjong::Scoped_log_sink scoped_sink(null_sink);
+
+            std::uint64_t seen_generation = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                job_ready.wait(lock, [&]()
+                               { return stopping || generation != seen_generation; });
+                if (stopping)
+                    return;
+                seen_generation = generation;
+                if (worker_index >= n_job_workers)
+                    continue;
+
+                const std::function<void()> *current_job = job;
+                lock.unlock();
+                (*current_job)();
+                lock.lock();
+                if (--n_active_workers == 0)
+                    job_done.notify_all();
+            }
+        }
+
+    public:
+        /**
+         * @brief Constructor starting the worker threads.
+         *
+         * @param n_workers Number of worker threads, the deciding thread always takes part in addition.
+         */
+        explicit Rollout_pool(unsigned int n_workers)
+        {
+            for (unsigned int worker_index = 0; worker_index < n_workers; worker_index++)
+                workers.emplace_back(&Rollout_pool::work, this, worker_index);
+        }
+
+        Rollout_pool(const Rollout_pool &) = delete;
+        Rollout_pool &operator=(const Rollout_pool &) = delete;
+
+        /**
+         * @brief Destructor stopping and joining the worker threads.
+         */
+        ~Rollout_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            job_ready.notify_all();
+            for (std::thread &worker : workers)
+                worker.join();
+        }
+
+        /**
+         * @brief Gets the number of worker threads.
+         */
+        unsigned int get_n_workers() const
+        {
+            return workers.size();
+        }
+
+        /**
+         * @brief Runs a job on the calling thread and on idle workers, and waits until all of them returned.
+         *
+         * The job is called once per thread and has to distribute the work itself, e.g. by an atomic counter.
+         *
+         * @param n_threads Maximal number of threads including the calling one.
+         * @param task The job to be run.
+         */
+        void run(unsigned int n_threads, const std::function<void()> &task)
+        {
+            std::unique_lock<std::mutex> job_lock(job_mutex, std::try_to_lock);
+            unsigned int n_helpers = job_lock.owns_lock() ? std::min<unsigned int>(std::max(1u, n_threads) - 1, workers.size()) : 0;
+
+            if (n_helpers > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = &task;
+                n_job_workers = n_helpers;
+                n_active_workers = n_helpers;
+                generation += 1;
+            }
+            job_ready.notify_all();
+
+            task();
+
+            if (n_helpers > 0)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_done.wait(lock, [&]()
+                              { return n_active_workers == 0; });
+                job = nullptr;
+            }
+        }
+
+        /**
+         * @brief Gets the shared pool with one worker per additional hardware thread.
+         *
+         * @return Reference to the pool.
+         */
+        static Rollout_pool &get_instance()
+        {
+            static Rollout_pool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            return pool;
+        }
+    };
+
+    /**
+     * @brief Stores the part of a determinized game known to the deciding player in a snapshot.
+     *
+     * The hidden tiles of the opponents and the set are left empty (see determinize). All players use the
+     * rollout policy of the settings.
+     *
+     * @param game_state The game state from the perspective of the deciding player.
+     * @param settings The settings of the search.
+     * @param snapshot The snapshot receiving the known part of the game.
+     */
+    inline void make_determinization_base(const Mahjong::State_view &game_state, const Mahjong::Search_settings &settings, Mahjong::Game_snapshot &snapshot)
+    {
+        const unsigned int own_player = game_state.get_player_number();
+        const std::vector<Mahjong::Tile> &discards = game_state.get_discard_pile().get_tiles();
+        std::copy(discards.begin(), discards.end(), snapshot.discards.begin());
+        snapshot.n_discards = static_cast<unsigned char>(discards.size());
+        snapshot.wall_size = 0;
+
+        // The rollouts must not search themselves.
+        Mahjong::Policy_type rollout_policy = settings.rollout_policy;
+        if (rollout_policy == Mahjong::Policy_type::monte_carlo || rollout_policy == Mahjong::Policy_type::human)
+            rollout_policy = Mahjong::Policy_type::tile_count;
+
+        for (unsigned int player_number = 0; player_number < snapshot.players.size(); player_number++)
+        {
+            Mahjong::Player_snapshot &player = snapshot.players[player_number];
+            if (player_number == own_player)
+                game_state.get_own_hand().save_snapshot(player.hand);
+            player.player_number = player_number;
+            player.is_human = false;
+            player.policy = rollout_policy;
+            player.randomness = 1.0; // The randomness is applied inversely, so this always uses the rollout policy.
+            player.chow_rate = 0.5;
+            player.search_settings = settings;
+            player.money = STARTING_MONEY;
+            player.seat_wind = (game_state.get_seat_wind().get_wind() + 4 + player_number - own_player) % 4;
+            player.latest_tile = Mahjong::Tile();
+            player.latest_tile_from_discard = false;
+            snapshot.scores[player_number] = 0;
+        }
+
+        snapshot.seen_counts = game_state.get_seen_counts();
+        snapshot.id = 0;
+        snapshot.running = true;
+        snapshot.current_player = game_state.get_current_player();
+        snapshot.n_rounds = 0;
+        snapshot.round_wind = game_state.get_round_wind().get_wind();
+        // The rollouts play all seats and start through play_until_finished.
+        snapshot.phase = static_cast<int>(Mahjong::Game_phase::turn);
+        snapshot.external_players.fill(false);
+        snapshot.claim_actions.fill(Mahjong::Pickup_action::none);
+        snapshot.next_claimant = 0;
+        snapshot.winner = -1;
+        snapshot.win_by_discard = false;
+    }
+
+    /**
+     * @brief Samples the hidden tiles of the opponents and the order of the set.
+     *
+     * The tiles not seen by the deciding player are shuffled and dealt to the opponents, keeping their numbers
+     * of hidden tiles, the remaining tiles form the set.
+     *
+     * @param game_state The game state from the perspective of the deciding player.
+     * @param unseen_tiles The tiles not seen by the deciding player, shuffled in place.
+     * @param rng The random number generator of the sample.
+     * @param snapshot The snapshot filled by make_determinization_base, receiving the sampled tiles.
+     */
+    inline void determinize(const Mahjong::State_view &game_state, std::vector<Mahjong::Tile> &unseen_tiles, Mahjong::Rng &rng, Mahjong::Game_snapshot &snapshot)
+    {
+        thread_local Mahjong::Hand hand;
+        static const Mahjong::Hand_snapshot EMPTY_HAND{};
+
+        rng.shuffle(unseen_tiles.begin(), unseen_tiles.end());
+        size_t n_dealt = 0;
+        for (unsigned int player_number = 0; player_number < snapshot.players.size(); player_number++)
+        {
+            if (player_number == game_state.get_player_number())
+                continue;
+
+            hand.restore_snapshot(EMPTY_HAND);
+            const Mahjong::Tile_counts &revealed_counts = game_state.get_revealed_counts(player_number);
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            {
+                for (unsigned int n = 0; n < revealed_counts[kind]; n++)
+                {
+                    Mahjong::Tile tile = Mahjong::Tile::from_kind(kind);
+                    tile.set_visible();
+                    hand.add_tile(tile);
+                }
+            }
+            unsigned int n_hidden = game_state.get_hand_size(player_number) - game_state.get_n_visible_tiles(player_number);
+            for (unsigned int n = 0; n < n_hidden; n++)
+                hand.add_tile(unseen_tiles[n_dealt++]);
+            hand.save_snapshot(snapshot.players[player_number].hand);
+        }
+
+        assert(unseen_tiles.size() - n_dealt == game_state.get_wall_size());
+        std::copy(unseen_tiles.begin() + n_dealt, unseen_tiles.end(), snapshot.wall.begin());
+        snapshot.wall_size = static_cast<unsigned char>(unseen_tiles.size() - n_dealt);
+        snapshot.rng_state = rng.get_state();
+    }
+
+    /**
+     * @brief Plays a determinized game to its end after applying a candidate action of the deciding player.
+     *
+     * A claim is followed by the deciding player's discard. Declining a claim continues with the turn of the
+     * player after the discarding one, so the opponents' claims of that discard are not simulated.
+     *
+     * @param game The determinized game.
+     * @param action_type The type of the decision.
+     * @param action The candidate action, a tile index for discards and a Pickup_action value for pickups.
+     * @param own_player The index of the deciding player.
+     * @return The final score of the deciding player.
+     */
+    inline long long play_rollout(Mahjong::Game &game, Mahjong::Action_type action_type, int action, unsigned int own_player)
+    {
+        int winner = -1;
+        if (action_type == Mahjong::Action_type::discard)
+        {
+            game.player_discard_by_index(own_player, action);
+            winner = game.play_until_finished();
+        }
+        else if (static_cast<Mahjong::Pickup_action>(action) != Mahjong::Pickup_action::none)
+        {
+            game.player_pick_from_discard(own_player, static_cast<Mahjong::Pickup_action>(action));
+            game.set_current_player(own_player);
+            game.player_has_winning_hand(own_player);
+            if (game.is_running())
+            {
+                game.player_discard(own_player);
+                winner = game.play_until_finished();
+            }
+            else
+                winner = own_player;
+        }
+        else
+        {
+            unsigned int next_player = (game.get_current_player() + 1) % N_PLAYERS;
+            game.set_current_player(next_player);
+            game.player_turn(next_player, false);
+            winner = game.is_running() ? game.play_until_finished() : static_cast<int>(next_player);
+        }
+
+        return game.get_player_score(own_player, true, static_cast<int>(own_player) == winner);
+    }
+
+    /**
+     * @brief Selects the candidate action with the best average rollout outcome (declared in Policy.hpp).
+     *
+     * Discards of the same tile kind are evaluated once. Rollouts are assigned to the candidates round-robin,
+     * all candidates of a round sharing the same sample, until the rollout or time budget is used up.
+     *
+     * @param action_type The type of the decision.
+     * @param available_actions The available actions.
+     * @param game_state The game state from the perspective of the deciding player.
+     * @param rng The random number generator of the game, drawn from once per decision.
+     * @param settings The budget, threads and rollout policy of the search.
+     * @return The selected action.
+     */
+    inline int select_monte_carlo_action(Mahjong::Action_type action_type, const Mahjong::Action_list<int> &available_actions, const Mahjong::State_view &game_state, Mahjong::Rng &rng, const Mahjong::Search_settings &settings)
+    {
+        const unsigned int own_player = game_state.get_player_number();
+
+        // Discarding any of several hidden tiles of the same kind leads to the same game.
+        Mahjong::Action_list<int> candidates;
+        std::uint64_t candidate_kinds = 0;
+        for (int action : available_actions)
+        {
+            if (action_type == Mahjong::Action_type::discard)
+            {
+                std::uint64_t kind_bit = std::uint64_t(1) << game_state.get_own_hand().get_tile_by_index(action).get_kind();
+                if (candidate_kinds & kind_bit)
+                    continue;
+                candidate_kinds |= kind_bit;
+            }
+            candidates.push_back(action);
+        }
+        if (candidates.size() == 1)
+            return candidates[0];
+
+        Mahjong::Game_snapshot base;
+        make_determinization_base(game_state, settings, base);
+
+        std::vector<Mahjong::Tile> unseen_tiles;
+        Mahjong::Tile_counts live_counts = game_state.get_live_counts();
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            for (unsigned int n = 0; n < live_counts[kind]; n++)
+                unseen_tiles.push_back(Mahjong::Tile::from_kind(kind));
+        }
+
+        // Every rollout is seeded by its index, so without a time limit the result doesn't depend on the threads.
+        const std::uint64_t decision_seed = rng();
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(settings.max_seconds);
+        const unsigned int n_candidates = candidates.size();
+        std::atomic<unsigned int> next_rollout{0};
+        std::array<std::atomic<long long>, MAX_ACTIONS> value_sums{};
+        std::array<std::atomic<unsigned int>, MAX_ACTIONS> n_rollouts{};
+
+        std::function<void()> task = [&]()
+        {
+            thread_local Mahjong::Game rollout_game(0);
+            Mahjong::Game_snapshot snapshot = base;
+            std::vector<Mahjong::Tile> tiles = unseen_tiles;
+            while (true)
+            {
+                unsigned int rollout = next_rollout.fetch_add(1);
+                if (rollout >= n_candidates)
+                {
+                    bool out_of_rollouts = (settings.n_rollouts > 0 && rollout >= settings.n_rollouts) || (settings.n_rollouts == 0 && settings.max_seconds <= 0);
+                    bool out_of_time = settings.max_seconds > 0 && std::chrono::steady_clock::now() >= deadline;
+                    if (out_of_rollouts || out_of_time)
+                        break;
+                }
+
+                // All candidates are evaluated on the same samples, round by round.
+                unsigned int candidate = rollout % n_candidates;
+                std::copy(unseen_tiles.begin(), unseen_tiles.end(), tiles.begin());
+                Mahjong::Rng sample_rng(Mahjong::derive_seed(decision_seed, rollout / n_candidates));
+                determinize(game_state, tiles, sample_rng, snapshot);
+                rollout_game.restore(snapshot);
+
+                value_sums[candidate] += play_rollout(rollout_game, action_type, candidates[candidate], own_player);
+                n_rollouts[candidate] += 1;
+            }
+        };
+
+        Mahjong::Null_sink null_sink;
+        Mahjong::Scoped_log_sink scoped_sink(null_sink);
+        Mahjong::Rollout_pool &pool = Mahjong::Rollout_pool::get_instance();
+        pool.run(settings.n_threads == 0 ? pool.get_n_workers() + 1 : settings.n_threads, task);
+
+        int prefered_action = candidates[0];
+        double best_value = 0;
+        bool found = false;
+        for (unsigned int candidate = 0; candidate < n_candidates; candidate++)
+        {
+            if (n_rollouts[candidate] == 0)
+                continue;
+            double value = static_cast<double>(value_sums[candidate]) / n_rollouts[candidate];
+            if (!found || value > best_value)
+            {
+                prefered_action = candidates[candidate];
+                best_value = value;
+                found = true;
+            }
+        }
+        return prefered_action;
+    }
+} // namespace Mahjong
@@ -0,0 +1,147 @@
+/**
+ * @file Observation.hpp
+ * @brief Defines the encoding of a game state into a fixed-size feature vector for learned policies.
+ *
+ * The encoder writes directly into a caller-provided float or uint8 buffer and reads the game through a
+ * State_view, so no hand or discard pile is copied. A Mahjong::State is encoded through its view (see
+ * State::get_view); as its opponents' hands only hold their visible tiles, their hidden tiles are then counted
+ * as undrawn. The layout is identified by OBSERVATION_VERSION, which is increased whenever it changes.
+ *
+ * Layout of version 1, all values being counts or 0/1 flags:
+ *
+ * | Offset | Size | Content                                                                        |
+ * |--------|------|--------------------------------------------------------------------------------|
+ * | 0      | 34   | Hidden tiles of the viewing player per tile kind.                              |
+ * | 34     | 136  | Revealed tiles per kind of the viewing, next, opposite and previous player.    |
+ * | 170    | 34   | Tiles in the discard pile per tile kind.                                       |
+ * | 204    | 34   | Live tiles per tile kind, i.e. tiles neither seen nor in the own hand.         |
+ * | 238    | 136  | The latest four discards, most recent first, one-hot per tile kind.            |
+ * | 374    | 4    | Seat wind of the viewing player, one-hot.                                      |
+ * | 378    | 4    | Round wind, one-hot.                                                           |
+ * | 382    | 2    | Type of the decision (discard, pickup), one-hot.                               |
+ * | 384    | 1    | Number of undrawn tiles.                                                       |
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Action.hpp"
+#include "State_view.hpp"
+#include "Tile.hpp"
+
+/** @brief Version of the observation layout. */
+const unsigned int OBSERVATION_VERSION = 1;
+
+/** @brief Number of latest discards included in an observation. */
+const unsigned int N_OBSERVED_DISCARDS = 4;
+
+/** @brief Number of planes of an observation holding one value per tile kind. */
+const unsigned int N_OBSERVATION_PLANES = 7 + N_OBSERVED_DISCARDS;
+
+/** @brief Offset of the values following the tile kind planes of an observation. */
+const unsigned int OBSERVATION_SCALARS_OFFSET = N_OBSERVATION_PLANES * N_TILE_KINDS;
+
+/** @brief Number of values of an observation. */
+const unsigned int OBSERVATION_SIZE = OBSERVATION_SCALARS_OFFSET + 11;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Planes of an observation, each holding one value per tile kind.
+     */
+    enum class Observation_plane
+    {
+        hidden = 0,          ///< Hidden tiles of the viewing player.
+        revealed = 1,        ///< Revealed tiles, one plane per player starting with the viewing one.
+        discarded = 5,       ///< Tiles in the discard pile.
+        live = 6,            ///< Tiles neither seen nor in the own hand.
+        latest_discards = 7, ///< One plane per latest discard, most recent first.
+    };
+
+    /**
+     * @brief Gets the offset of a plane of an observation.
+     *
+     * @param plane The plane.
+     * @param index The index of the plane within a group of planes, e.g. the relative player of a revealed plane.
+     * @return The offset of the first value of the plane.
+     */
+    constexpr unsigned int get_observation_offset(Mahjong::Observation_plane plane, unsigned int index = 0)
+    {
+        return (static_cast<unsigned int>(plane) + index) * N_TILE_KINDS;
+    }
+
+    /**
+     * @brief Encodes a game state from the perspective of the viewing player for a decision (see the file comment).
+     *
+     * @tparam Value The type of the values, e.g. float or std::uint8_t.
+     * @param state The game state from the perspective of the deciding player, with the hands of all four players.
+     * @param action_type The type of the decision.
+     * @param observation The OBSERVATION_SIZE values receiving the observation.
+     */
+    template <typename Value>
+    void encode_observation(const Mahjong::State_view &state, Mahjong::Action_type action_type, Value *observation)
+    {
+        std::fill(observation, observation + OBSERVATION_SIZE, Value(0));
+        const unsigned int player_number = state.get_player_number();
+        const Mahjong::Tile_counts &hidden_counts = state.get_own_hand().get_hidden_counts();
+        const Mahjong::Tile_counts &seen_counts = state.get_seen_counts();
+
+        Value *hidden = observation + get_observation_offset(Mahjong::Observation_plane::hidden);
+        Value *discarded = observation + get_observation_offset(Mahjong::Observation_plane::discarded);
+        Value *live = observation + get_observation_offset(Mahjong::Observation_plane::live);
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            hidden[kind] = hidden_counts[kind];
+            discarded[kind] = seen_counts[kind];
+            live[kind] = 4 - seen_counts[kind] - hidden_counts[kind];
+        }
+
+        for (unsigned int offset = 0; offset < 4; offset++)
+        {
+            const Mahjong::Tile_counts &revealed_counts = state.get_revealed_counts((player_number + offset) % 4);
+            Value *revealed = observation + get_observation_offset(Mahjong::Observation_plane::revealed, offset);
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            {
+                revealed[kind] = revealed_counts[kind];
+                discarded[kind] -= revealed_counts[kind];
+            }
+        }
+
+        const std::vector<Mahjong::Tile> &discards = state.get_discard_pile().get_tiles();
+        const std::size_t n_discards = std::min<std::size_t>(discards.size(), N_OBSERVED_DISCARDS);
+        for (std::size_t index = 0; index < n_discards; index++)
+        {
+            Value *latest_discard = observation + get_observation_offset(Mahjong::Observation_plane::latest_discards, index);
+            latest_discard[discards[discards.size() - 1 - index].get_kind()] = 1;
+        }
+
+        Value *scalars = observation + OBSERVATION_SCALARS_OFFSET;
+        scalars[state.get_seat_wind().get_wind()] = 1;
+        scalars[4 + state.get_round_wind().get_wind()] = 1;
+        scalars[(action_type == Mahjong::Action_type::discard) ? 8 : 9] = 1;
+        scalars[10] = state.get_wall_size();
+    }
+
+    /**
+     * @brief Encodes a batch of game states into a contiguous block of N rows of OBSERVATION_SIZE values.
+     *
+     * @tparam Value The type of the values, e.g. float or std::uint8_t.
+     * @param states The game states, each from the perspective of its deciding player.
+     * @param action_types The type of the decision of each state.
+     * @param n_states The number of states.
+     * @param observations The n_states * OBSERVATION_SIZE values receiving the observations.
+     */
+    template <typename Value>
+    void encode_observations(const Mahjong::State_view *states, const Mahjong::Action_type *action_types, std::size_t n_states, Value *observations)
+    {
+        for (std::size_t index = 0; index < n_states; index++)
+            encode_observation(states[index], action_types[index], observations + index * OBSERVATION_SIZE);
+    }
+} // namespace Mahjong
@@ -7,21 +7,20 @@
 
 #include <algorithm>
 #include <cmath>
-#include <map>
-#include <random>
 
+#include "Action.hpp"
 #include "Hand.hpp"
+#include "Logging.hpp"
 #include "Policy.hpp"
+#include "Random.hpp"
 #include "Set.hpp"
-#include "State.hpp"
+#include "State_view.hpp"
 #include "Discard_pile.hpp"
 #include "Wind.hpp"
 
 /** @brief Initial money for each player. */
-float STARTING_MONEY = 100;
+inline constexpr float STARTING_MONEY = 100;
 
-std::map<std::string, int> PICKUP_ACTION_TO_INT = {{"none", 0}, {"chow", 1}, {"pong", 2}, {"kong", 3}};
-std::map<int, std::string> PICKUP_ACTION_TO_STRING = {{0, "none"}, {1, "chow"}, {2, "pong"}, {3, "kong"}};
 
 /**
  * @namespace Mahjong
@@ -60,6 +59,24 @@ namespace Mahjong
             latest_tile = std::tuple(hand.get_tile_by_index(-1), "set");
         }
 
+        /**
+         * @brief Resets the player for a new round, reusing the storage of the hand.
+         *
+         * The policy and its parameters are kept, while the player becomes an AI player again.
+         *
+         * @param set Reference to the tile set for drawing the new hand.
+         * @param new_seat_wind The player's seat wind in the new round.
+         */
+        void reset(Mahjong::Set &set, Mahjong::Wind new_seat_wind)
+        {
+            is_human = false;
+            money = STARTING_MONEY;
+            seat_wind = new_seat_wind;
+            hand.clear();
+            hand.draw_hand(set);
+            latest_tile = std::tuple(hand.get_tile_by_index(-1), "set");
+        }
+
         /**
          * @brief Display the player's complete hand.
          */
@@ -108,59 +125,75 @@ namespace Mahjong
         /**
          * @brief Discard a tile from the player's hand.
          * @param discard_pile Reference to the discard pile.
+         * @param game_state The game state from the perspective of the player.
+         * @param rng The random number generator of the game.
+         * @return The index of the discarded tile, or -1 if no tile was discarded.
          */
-        void discard_tile(Discard_pile &discard_pile, State game_state)
+        int discard_tile(Discard_pile &discard_pile, const State_view &game_state, Mahjong::Rng &rng)
         {
             if (is_human)
             {
-                hand.discard_tile(discard_pile);
+                return hand.discard_tile(discard_pile);
             }
             else
             {
-                // hand.discard_random_tile(discard_pile);
-                std::vector<int> valid_discards = hand.get_valid_discards();
-                int action = policy.select_action("Discard", valid_discards, game_state);
+                // hand.discard_random_tile(discard_pile, rng);
+                Mahjong::Action_list<int> valid_discards = hand.get_valid_discards();
+                int action = policy.select_action(Mahjong::Action_type::discard, valid_discards, game_state, rng);
                 // std::cout << policy.get_policy() << "\n";
                 hand.discard_tile_by_index(discard_pile, action);
+                return action;
             }
         }
 
+        /**
+         * @brief Discard the tile at the given index, bypassing the player's policy.
+         * @param discard_pile Reference to the discard pile.
+         * @param index The index of the hidden tile to be discarded.
+         */
+        void discard_tile_by_index(Discard_pile &discard_pile, int index)
+        {
+            hand.discard_tile_by_index(discard_pile, index);
+        }
+
         /**
          * @brief Choose a pickup action based on the game state.
          * @param discard_pile Reference to the discard pile.
          * @param current_player The player who discarded the last tile.
-         * @return The chosen action as a string.
+         * @param game_state The game state from the perspective of the player.
+         * @param rng The random number generator of the game.
+         * @return The chosen action.
          */
-        std::string choose_pickup_action(Discard_pile &discard_pile, unsigned int current_player, Mahjong::State game_state)
+        Mahjong::Pickup_action choose_pickup_action(Discard_pile &discard_pile, unsigned int current_player, const Mahjong::State_view &game_state, Mahjong::Rng &rng)
         {
-            std::vector<std::string> available_actions = hand.check_available_actions(discard_pile, player_number, current_player);
+            Mahjong::Action_list<Mahjong::Pickup_action, N_PICKUP_ACTIONS> available_actions = hand.check_available_actions(discard_pile, player_number, current_player);
             // std::cout << player_number << ", " << is_human << ", " << available_actions.size() << std::endl;
             if (is_human && available_actions.size() > 0)
             {
                 std::cout << "Available actions:" << std::endl;
                 for (size_t i = 0; i < available_actions.size(); i++)
                 {
-                    std::cout << i << ": " << available_actions[i] << std ::endl;
+                    std::cout << i << ": " << Mahjong::to_string(available_actions[i]) << std ::endl;
                 }
                 int chosen_action;
                 std::cout << "Select action:" << std::endl;
                 std::cin >> chosen_action;
                 if (chosen_action == -1)
                 {
-                    return "none";
+                    return Mahjong::Pickup_action::none;
                 }
                 assert(chosen_action < available_actions.size());
                 return available_actions[chosen_action];
             }
             else if (available_actions.size() > 0)
             {
-                available_actions.push_back("none");
-                std::vector<int> available_actions_int = {};
-                for (std::string action : available_actions)
-                    available_actions_int.push_back(PICKUP_ACTION_TO_INT[action]);
-                return PICKUP_ACTION_TO_STRING[policy.select_action("Pickup", available_actions_int, game_state)];
+                Mahjong::Action_list<int> available_actions_int;
+                for (Mahjong::Pickup_action action : available_actions)
+                    available_actions_int.push_back(static_cast<int>(action));
+                available_actions_int.push_back(static_cast<int>(Mahjong::Pickup_action::none));
+                return static_cast<Mahjong::Pickup_action>(policy.select_action(Mahjong::Action_type::pickup, available_actions_int, game_state, rng));
             }
-            return "none";
+            return Mahjong::Pickup_action::none;
         }
 
         /**
@@ -182,21 +215,50 @@ namespace Mahjong
 
         /**
          * @brief Set the player's policy.
-         * @param new_policy The new policy as string.
+         * @param new_policy The new policy.
          */
-        void set_policy(std::string new_policy)
+        void set_policy(Mahjong::Policy_type new_policy)
         {
             policy.set_policy(new_policy);
         }
 
+        /**
+         * @brief Set the randomness and chow rate of the player's policy.
+         * @param parameters The new policy parameters.
+         */
+        void set_policy_parameters(const Mahjong::Policy_parameters &parameters)
+        {
+            policy.set_randomness(parameters.randomness);
+            policy.set_chow_rate(parameters.chow_rate);
+        }
+
+        /**
+         * @brief Set the budget and rollout policy of the player's monte_carlo policy.
+         * @param settings The new search settings.
+         */
+        void set_search_settings(const Mahjong::Search_settings &settings)
+        {
+            policy.set_search_settings(settings);
+        }
+
+        /**
+         * @brief Reveal the tiles at the given indices of the player's hand.
+         * @param index_mask The mask with bit i set if the tile at index i is to be revealed.
+         */
+        void reveal_tiles(std::uint32_t index_mask)
+        {
+            hand.reveal_tiles(index_mask);
+        }
+
         /**
          * @brief Reveal a combination (set of tiles) based on a pickup action.
          * @param tile The tile that triggered the action.
          * @param action The pickup action (kong, pong, chow) to reveal.
+         * @param rng The random number generator of the game.
          */
-        void reveal_combination(Mahjong::Tile tile, std::string action)
+        void reveal_combination(Mahjong::Tile tile, Mahjong::Pickup_action action, Mahjong::Rng &rng)
         {
-            hand.reveal_combination(tile, action, is_human);
+            hand.reveal_combination(tile, action, is_human, rng);
         }
 
         /**
@@ -237,7 +299,7 @@ namespace Mahjong
                 std::get<0>(score) += 20;
 
                 // Bonus points for completely hidden hand
-                if (hand.get_hidden_hand().size() == hand.get_hand_size())
+                if (hand.get_n_hidden_tiles() == hand.get_hand_size())
                 {
                     std::get<0>(score) += 20;
                 }
@@ -296,19 +358,15 @@ namespace Mahjong
          */
         void display_player_score(Mahjong::Wind round_wind, bool full_hand = false, bool mahjong = false) const
         {
+            if (!Mahjong::is_log_enabled(Mahjong::Log_level::info))
+                return;
+
             std::tuple<int, int> score = get_player_score(round_wind, full_hand, mahjong);
             unsigned int unmodified_score = std::get<0>(score);
             unsigned int multiplier = std::get<1>(score);
 
-            if (full_hand)
-            {
-                std::cout << "Total score: " << unmodified_score * std::pow(2, multiplier);
-            }
-            else
-            {
-                std::cout << "Known score: " << unmodified_score * std::pow(2, multiplier);
-            }
-            std::cout << " (" << unmodified_score << " doubled " << multiplier << " times)\n";
+            MAHJONG_LOG(Mahjong::Log_level::info, (full_hand ? "Total score: " : "Known score: ") << unmodified_score * std::pow(2, multiplier)
+                                                                         << " (" << unmodified_score << " doubled " << multiplier << " times)\n");
         }
 
         /**
@@ -339,6 +397,16 @@ namespace Mahjong
             return hand;
         }
 
+        /**
+         * @brief Returns a read-only reference to the hand of the player.
+         *
+         * @return Reference to the hand of the player.
+         */
+        const Mahjong::Hand &get_hand() const
+        {
+            return hand;
+        }
+
         /**
          * @brief Get the seat wind of the player.
          *
@@ -367,5 +435,44 @@ namespace Mahjong
         {
             return player_number;
         }
+
+        /**
+         * @brief Stores the player, including its hand and policy, in a snapshot.
+         *
+         * @param snapshot The snapshot receiving the player.
+         */
+        void save_snapshot(Mahjong::Player_snapshot &snapshot) const
+        {
+            hand.save_snapshot(snapshot.hand);
+            snapshot.player_number = player_number;
+            snapshot.is_human = is_human;
+            snapshot.policy = policy.get_policy();
+            snapshot.randomness = policy.get_randomness();
+            snapshot.chow_rate = policy.get_chow_rate();
+            snapshot.search_settings = policy.get_search_settings();
+            snapshot.money = money;
+            snapshot.seat_wind = seat_wind.get_wind();
+            snapshot.latest_tile = std::get<0>(latest_tile);
+            snapshot.latest_tile_from_discard = (std::get<1>(latest_tile) == "discard");
+        }
+
+        /**
+         * @brief Restores the player from a snapshot.
+         *
+         * @param snapshot The snapshot of the player.
+         */
+        void restore_snapshot(const Mahjong::Player_snapshot &snapshot)
+        {
+            hand.restore_snapshot(snapshot.hand);
+            player_number = snapshot.player_number;
+            is_human = snapshot.is_human;
+            policy.set_policy(snapshot.policy);
+            policy.set_randomness(snapshot.randomness);
+            policy.set_chow_rate(snapshot.chow_rate);
+            policy.set_search_settings(snapshot.search_settings);
+            money = snapshot.money;
+            seat_wind = Mahjong::Wind(snapshot.seat_wind);
+            latest_tile = std::tuple(snapshot.latest_tile, snapshot.latest_tile_from_discard ? "discard" : "set");
+        }
     };
 } // namespace Mahjong
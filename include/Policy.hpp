@@ -1,14 +1,12 @@
 #pragma once
 
 #include <algorithm>
-#include <random>
-#include <set>
-#include <string>
-#include <vector>
 
-#include "State.hpp"
-
-std::set<std::string> VALID_POLICIES = {"random", "human", "tile_count"};
+#include "Action.hpp"
+#include "Instrumentation.hpp"
+#include "Random.hpp"
+#include "Shanten.hpp"
+#include "State_view.hpp"
 
 /**
  * @namespace Mahjong
@@ -16,15 +14,23 @@ std::set<std::string> VALID_POLICIES = {"random", "human", "tile_count"};
  */
 namespace Mahjong
 {
+    /**
+     * @brief Selects an action by determinized Monte-Carlo rollouts, see Policy_type::monte_carlo.
+     *
+     * Defined in Monte_carlo.hpp, which is included by Game.hpp, since the rollouts play complete games.
+     */
+    inline int select_monte_carlo_action(Mahjong::Action_type action_type, const Mahjong::Action_list<int> &available_actions, const Mahjong::State_view &game_state, Mahjong::Rng &rng, const Mahjong::Search_settings &settings);
+
     /**
      * @brief Class representing a policy for decision-making in Mahjong game.
      */
     class Policy
     {
     private:
-        std::string policy = "random"; ///< The current policy for decision-making.
-        float random = 0.05;           ///< The randomness factor for decision-making.
-        float chow_rate = 0.5;         ///< The rate for selecting Chow action.
+        Mahjong::Policy_type policy = Mahjong::Policy_type::random; ///< The current policy for decision-making.
+        float random = 0.05;                                        ///< The randomness factor for decision-making.
+        float chow_rate = 0.5;                                      ///< The rate for selecting Chow action.
+        Mahjong::Search_settings search_settings;                   ///< The budget of the monte_carlo policy.
 
     public:
         /**
@@ -37,28 +43,25 @@ namespace Mahjong
          */
         void set_human()
         {
-            policy = "human";
+            policy = Mahjong::Policy_type::human;
         }
 
         /**
-         * @brief Sets the policy to the specified one if it's valid.
+         * @brief Sets the policy to the specified one.
          *
          * @param new_policy The new policy to be set.
          */
-        void set_policy(std::string new_policy)
+        void set_policy(Mahjong::Policy_type new_policy)
         {
-            if (VALID_POLICIES.find(new_policy) != VALID_POLICIES.end())
-                policy = new_policy;
-            else
-                std::cout << "Invalid policy " << new_policy << "\n";
+            policy = new_policy;
         }
 
         /**
          * @brief Returns the current policy.
          *
-         * @return The current policy as a string.
+         * @return The current policy.
          */
-        std::string get_policy() const
+        Mahjong::Policy_type get_policy() const
         {
             return policy;
         }
@@ -73,37 +76,88 @@ namespace Mahjong
             random = new_random;
         }
 
+        /**
+         * @brief Returns the randomness factor for decision-making.
+         *
+         * @return The randomness factor.
+         */
+        float get_randomness() const
+        {
+            return random;
+        }
+
+        /**
+         * @brief Sets the rate for selecting the Chow action.
+         *
+         * @param new_chow_rate The new chow rate.
+         */
+        void set_chow_rate(float new_chow_rate)
+        {
+            chow_rate = new_chow_rate;
+        }
+
+        /**
+         * @brief Returns the rate for selecting the Chow action.
+         *
+         * @return The chow rate.
+         */
+        float get_chow_rate() const
+        {
+            return chow_rate;
+        }
+
+        /**
+         * @brief Sets the budget and rollout policy of the monte_carlo policy.
+         *
+         * @param new_search_settings The new search settings.
+         */
+        void set_search_settings(const Mahjong::Search_settings &new_search_settings)
+        {
+            search_settings = new_search_settings;
+        }
+
+        /**
+         * @brief Returns the budget and rollout policy of the monte_carlo policy.
+         *
+         * @return The search settings.
+         */
+        const Mahjong::Search_settings &get_search_settings() const
+        {
+            return search_settings;
+        }
+
         /**
          * @brief Selects an action based on the policy, available actions, and game state.
          *
          * This method selects an action based on the current policy, available actions, and the game state.
          *
          * @param action_type The type of action to select.
-         * @param available_actions A vector of available actions.
+         * @param available_actions The available actions, tile indices for discards and Pickup_action values for pickups.
          * @param game_state The current game state.
+         * @param rng The random number generator of the game.
          * @return The index of the selected action.
          */
-        int select_action(std::string action_type, std::vector<int> available_actions, Mahjong::State game_state)
+        int select_action(Mahjong::Action_type action_type, const Mahjong::Action_list<int> &available_actions, const Mahjong::State_view &game_state, Mahjong::Rng &rng)
         {
-            std::string decision_policy = policy;
+            MAHJONG_TIME_SCOPE(get_select_action_timer(policy, action_type));
+            Mahjong::Policy_type decision_policy = policy;
 
             // Select a random action with predefined chance given by randomness
-            int random_number = std::rand() % 100;
+            int random_number = rng.bounded(100);
 
             if (random * 100 < random_number)
-                decision_policy = "random";
+                decision_policy = Mahjong::Policy_type::random;
 
-            if (decision_policy == "random")
+            if (decision_policy == Mahjong::Policy_type::random)
             {
-                return available_actions[std::rand() % available_actions.size()];
+                return available_actions[rng.bounded(available_actions.size())];
             }
 
-            if (decision_policy == "tile_count")
+            if (decision_policy == Mahjong::Policy_type::tile_count)
             {
-                if (action_type == "Discard")
+                if (action_type == Mahjong::Action_type::discard)
                 {
-                    unsigned int player_number = game_state.get_player_number();
-                    Mahjong::Hand player_hand = game_state.get_player_hand(player_number);
+                    const Mahjong::Hand &player_hand = game_state.get_own_hand();
 
                     int prefered_action;
                     int minimal_score = 5000;
@@ -125,21 +179,128 @@ namespace Mahjong
                         }
 
                         if (score == minimal_score)
-                            prefered_action = (std::rand() % 10 < 5) ? prefered_action : index;
+                            prefered_action = (rng.bounded(10) < 5) ? prefered_action : index;
                     }
                     // std::cout << "Minimal score " << minimal_score << " for " << player_hand.get_tile_by_index(prefered_action).get_tile_as_string() << "\n";
                     return prefered_action;
                 }
-                else if (action_type == "Pickup")
+                else if (action_type == Mahjong::Action_type::pickup)
                 {
                     int prefered_action = *std::max_element(available_actions.begin(), available_actions.end());
-                    if (prefered_action == 1)
-                        return ((std::rand() % 10) < (chow_rate * 10)) ? 0 : 1;
+                    if (prefered_action == static_cast<int>(Mahjong::Pickup_action::chow))
+                        return static_cast<int>((rng.bounded(10) < (chow_rate * 10)) ? Mahjong::Pickup_action::none : Mahjong::Pickup_action::chow);
                     return prefered_action;
                 }
             }
 
-            return available_actions[std::rand() % available_actions.size()];
+            if (decision_policy == Mahjong::Policy_type::monte_carlo && available_actions.size() > 1)
+                return Mahjong::select_monte_carlo_action(action_type, available_actions, game_state, rng, search_settings);
+
+            if (decision_policy == Mahjong::Policy_type::shanten)
+            {
+                if (action_type == Mahjong::Action_type::discard)
+                    return select_shanten_discard(available_actions, game_state, rng);
+                else if (action_type == Mahjong::Action_type::pickup)
+                    return select_shanten_pickup(available_actions, game_state);
+            }
+
+            return available_actions[rng.bounded(available_actions.size())];
+        }
+
+    private:
+        /**
+         * @brief Selects the discard leading to the lowest shanten number, preferring hands with a larger ukeire.
+         *
+         * Every tile kind is evaluated once and the ukeire only for the kinds of the lowest shanten number,
+         * remaining ties are resolved uniformly at random.
+         */
+        int select_shanten_discard(const Mahjong::Action_list<int> &available_actions, const Mahjong::State_view &game_state, Mahjong::Rng &rng) const
+        {
+            const Mahjong::Hand &player_hand = game_state.get_own_hand();
+            Mahjong::Shanten_discard_evaluator evaluator(player_hand.get_hidden_counts(), player_hand.get_revealed_counts());
+
+            std::array<int, N_TILE_KINDS> kind_shanten;
+            kind_shanten.fill(-2);
+            int minimal_shanten = 8;
+            for (int index : available_actions)
+            {
+                unsigned int kind = player_hand.get_tile_by_index(static_cast<unsigned int>(index)).get_kind();
+                if (kind_shanten[kind] == -2)
+                {
+                    kind_shanten[kind] = evaluator.get_shanten(kind);
+                    minimal_shanten = std::min(minimal_shanten, kind_shanten[kind]);
+                }
+            }
+
+            Mahjong::Tile_counts live_counts = game_state.get_live_counts();
+            std::array<int, N_TILE_KINDS> kind_ukeire;
+            kind_ukeire.fill(-1);
+            int prefered_action = available_actions[0];
+            int maximal_ukeire = -1;
+            unsigned int n_ties = 0;
+
+            for (int index : available_actions)
+            {
+                unsigned int kind = player_hand.get_tile_by_index(static_cast<unsigned int>(index)).get_kind();
+                if (kind_shanten[kind] != minimal_shanten)
+                    continue;
+                if (kind_ukeire[kind] < 0)
+                    kind_ukeire[kind] = static_cast<int>(evaluator.get_ukeire(kind, live_counts));
+
+                int ukeire = kind_ukeire[kind];
+                if (ukeire > maximal_ukeire)
+                {
+                    prefered_action = index;
+                    maximal_ukeire = ukeire;
+                    n_ties = 1;
+                }
+                else if (ukeire == maximal_ukeire && rng.bounded(++n_ties) == 0)
+                    prefered_action = index;
+            }
+            return prefered_action;
+        }
+
+        /**
+         * @brief Selects the pickup action reducing the shanten number the most, or none if no claim reduces it.
+         *
+         * Ties between claims are resolved in favour of the action with the higher priority.
+         */
+        int select_shanten_pickup(const Mahjong::Action_list<int> &available_actions, const Mahjong::State_view &game_state) const
+        {
+            const Mahjong::Hand &player_hand = game_state.get_own_hand();
+            const Mahjong::Tile_counts &counts = player_hand.get_hidden_counts();
+            const Mahjong::Tile_counts &revealed_counts = player_hand.get_revealed_counts();
+            unsigned int kind = game_state.get_discard_pile().back().get_kind();
+
+            int prefered_action = static_cast<int>(Mahjong::Pickup_action::none);
+            int minimal_shanten = Mahjong::get_shanten(counts, revealed_counts);
+
+            for (int action : available_actions)
+            {
+                unsigned int n_claimed_tiles;
+                switch (static_cast<Mahjong::Pickup_action>(action))
+                {
+                case Mahjong::Pickup_action::chow:
+                    n_claimed_tiles = 0;
+                    break;
+                case Mahjong::Pickup_action::pong:
+                    n_claimed_tiles = 2;
+                    break;
+                case Mahjong::Pickup_action::kong:
+                    n_claimed_tiles = 3;
+                    break;
+                default:
+                    continue;
+                }
+
+                int shanten = Mahjong::get_claim_shanten(counts, revealed_counts, kind, n_claimed_tiles);
+                if (shanten < minimal_shanten || (shanten == minimal_shanten && prefered_action != static_cast<int>(Mahjong::Pickup_action::none) && action > prefered_action))
+                {
+                    prefered_action = action;
+                    minimal_shanten = shanten;
+                }
+            }
+            return prefered_action;
         }
     };
 } // namespace Mahjong
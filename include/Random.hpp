@@ -0,0 +1,194 @@
+/**
+ * @file Random.hpp
+ * @brief Defines the Rng class, a small, fast and seedable random number generator.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Mixes a 64-bit value using the SplitMix64 finalizer.
+     *
+     * Used to expand seeds into generator states and to derive independent seeds (e.g. one per game)
+     * from a base seed.
+     *
+     * @param value The value to be mixed.
+     * @return The mixed value.
+     */
+    constexpr std::uint64_t mix_seed(std::uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     * @brief Derives the seed of a single item (e.g. a game) from a base seed and the item's index.
+     *
+     * @param base_seed The base seed.
+     * @param index The index of the item.
+     * @return The derived seed.
+     */
+    inline std::uint64_t derive_seed(std::uint64_t base_seed, std::uint64_t index)
+    {
+        return mix_seed(mix_seed(base_seed) ^ index);
+    }
+
+    /**
+     * @class Rng
+     * @brief Random number generator based on xoshiro256**.
+     *
+     * Every game owns its own generator, which makes games reproducible from their seed and avoids the
+     * hidden global state of `std::rand`. The generator fulfills the requirements of a uniform random bit
+     * generator, but provides its own `bounded` and `shuffle` helpers, whose results (unlike those of the
+     * standard distributions) do not depend on the standard library implementation.
+     */
+    class Rng
+    {
+    private:
+        std::array<std::uint64_t, 4> state; ///< The internal state of the generator.
+
+        /**
+         * @brief Rotates the bits of a value to the left.
+         */
+        static std::uint64_t rotl(std::uint64_t value, int shift)
+        {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+    public:
+        using result_type = std::uint64_t;
+
+        /**
+         * @brief Constructor seeding the generator.
+         *
+         * @param seed_in The seed of the generator.
+         */
+        explicit Rng(std::uint64_t seed_in = 0)
+        {
+            seed(seed_in);
+        }
+
+        /**
+         * @brief Resets the generator to the state defined by the given seed.
+         *
+         * @param seed_in The new seed.
+         */
+        void seed(std::uint64_t seed_in)
+        {
+            std::uint64_t value = seed_in;
+            for (std::uint64_t &word : state)
+            {
+                value = mix_seed(value);
+                word = value;
+            }
+        }
+
+        /**
+         * @brief Gets the complete internal state of the generator.
+         *
+         * @return The internal state.
+         */
+        const std::array<std::uint64_t, 4> &get_state() const
+        {
+            return state;
+        }
+
+        /**
+         * @brief Sets the complete internal state of the generator.
+         *
+         * @param state_in The new internal state, as returned by get_state().
+         */
+        void set_state(const std::array<std::uint64_t, 4> &state_in)
+        {
+            state = state_in;
+        }
+
+        /** @brief Smallest value returned by the generator. */
+        static constexpr result_type min() { return 0; }
+
+        /** @brief Largest value returned by the generator. */
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        /**
+         * @brief Generates the next random 64-bit value.
+         *
+         * @return The random value.
+         */
+        result_type operator()()
+        {
+            const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+            const std::uint64_t t = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+
+            return result;
+        }
+
+        /**
+         * @brief Generates a uniformly distributed integer in [0, bound).
+         *
+         * Uses Lemire's multiply-shift method with rejection, so the result is unbiased.
+         *
+         * @param bound The exclusive upper bound, must be positive.
+         * @return The random integer.
+         */
+        std::uint32_t bounded(std::uint32_t bound)
+        {
+            std::uint64_t product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+            std::uint32_t low = static_cast<std::uint32_t>(product);
+            if (low < bound)
+            {
+                const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+                while (low < threshold)
+                {
+                    product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+                    low = static_cast<std::uint32_t>(product);
+                }
+            }
+            return static_cast<std::uint32_t>(product >> 32);
+        }
+
+        /**
+         * @brief Generates a uniformly distributed float in [0, 1).
+         *
+         * @return The random float.
+         */
+        float uniform()
+        {
+            return static_cast<float>((*this)() >> 40) * (1.0f / 16777216.0f);
+        }
+
+        /**
+         * @brief Shuffles the given range using the Fisher-Yates shuffle algorithm.
+         *
+         * @param first Iterator to the first element of the range.
+         * @param last Iterator past the last element of the range.
+         */
+        template <class RandomIt>
+        void shuffle(RandomIt first, RandomIt last)
+        {
+            auto n = last - first;
+            for (auto i = n - 1; i > 0; i--)
+            {
+                auto j = bounded(static_cast<std::uint32_t>(i + 1));
+                using std::swap;
+                swap(first[i], first[j]);
+            }
+        }
+    };
+} // namespace Mahjong
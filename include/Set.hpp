@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <vector>
 
+#include "Random.hpp"
 #include "Tile.hpp"
 
 /**
@@ -28,37 +29,59 @@ namespace Mahjong
     private:
         std::vector<Tile> tiles; /**< The collection of tiles in the set. */
 
-    public:
         /**
-         * @brief Default constructor for Set.
-         *
-         * Initializes the set with a standard collection of Mahjong tiles.
+         * @brief Get the standard collection of Mahjong tiles, in the order of a fresh set.
+         * @return Reference to the 136 tiles, built on first use.
          */
-        Set()
+        static const std::vector<Tile> &get_full_set()
         {
-            tiles = {};
-            for (size_t i = 0; i < 5; i++)
+            static const std::vector<Tile> full_set = []()
             {
-                int max_rank;
-                if (i == 3)
+                std::vector<Tile> tiles = {};
+                for (size_t i = 0; i < 5; i++)
                 {
-                    max_rank = 4;
-                }
-                else if (i == 4)
-                {
-                    max_rank = 3;
-                }
-                else
-                {
-                    max_rank = 9;
-                }
+                    int max_rank;
+                    if (i == 3)
+                    {
+                        max_rank = 4;
+                    }
+                    else if (i == 4)
+                    {
+                        max_rank = 3;
+                    }
+                    else
+                    {
+                        max_rank = 9;
+                    }
 
-                for (size_t j = 0; j < max_rank; j++)
-                {
-                    for (size_t n = 0; n < 4; n++)
-                        tiles.push_back(Tile(i, j));
+                    for (int j = 0; j < max_rank; j++)
+                    {
+                        for (size_t n = 0; n < 4; n++)
+                            tiles.push_back(Tile(i, j));
+                    }
                 }
-            }
+                return tiles;
+            }();
+            return full_set;
+        }
+
+    public:
+        /**
+         * @brief Default constructor for Set.
+         *
+         * Initializes the set with a standard collection of Mahjong tiles.
+         */
+        Set() : tiles(get_full_set()) {}
+
+        /**
+         * @brief Refill the set with the standard collection of Mahjong tiles, reusing its storage.
+         *
+         * The tiles are in the order of a fresh set and need to be shuffled.
+         */
+        void refill()
+        {
+            const std::vector<Tile> &full_set = get_full_set();
+            tiles.assign(full_set.begin(), full_set.end());
         }
 
         /**
@@ -73,11 +96,13 @@ namespace Mahjong
         /**
          * @brief Shuffle the tiles in the set.
          *
-         * Uses a random seed to shuffle the tiles using the Fisher-Yates shuffle algorithm.
+         * Shuffles the tiles using the Fisher-Yates shuffle algorithm.
+         *
+         * @param rng The random number generator of the game.
          */
-        void shuffle()
+        void shuffle(Mahjong::Rng &rng)
         {
-            std::shuffle(tiles.begin(), tiles.end(), std::default_random_engine(time(NULL)));
+            rng.shuffle(tiles.begin(), tiles.end());
         }
 
         /**
@@ -94,6 +119,25 @@ namespace Mahjong
             tiles.pop_back();
             return tile_to_return;
         }
+
+        /**
+         * @brief Get the undrawn tiles, the next tile to be drawn being the last one.
+         * @return Reference to the undrawn tiles.
+         */
+        const std::vector<Tile> &get_tiles() const
+        {
+            return tiles;
+        }
+
+        /**
+         * @brief Replace the undrawn tiles, reusing the storage of the set.
+         * @param first Pointer to the first tile.
+         * @param last Pointer past the last tile, which is drawn next.
+         */
+        void assign_tiles(const Tile *first, const Tile *last)
+        {
+            tiles.assign(first, last);
+        }
     };
 
 } // namespace Mahjong
@@ -0,0 +1,928 @@
+/**
+ * @file Shanten.hpp
+ * @brief Shanten (distance to a ready hand) and ukeire (number of improving tiles) of Mahjong hands.
+ *
+ * A complete hand consists of 14 tiles covered by pairs, chows, pongs and kongs with one pair more than kongs
+ * (see is_complete_hand), i.e. of four blocks and a pair, where a chow or pong fills one block and a kong
+ * together with its additional pair fills two. The shanten number is derived from the decompositions of a hand
+ * into complete and partial (two tiles of a chow or pong) combinations: every decomposition keeps the tiles of
+ * its combinations, one further tile for every block or pair it can't fill otherwise, and has to exchange the
+ * remaining tiles.
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "Tile.hpp"
+#include "decomposition_table.hpp"
+
+/** @brief Number of blocks of a complete hand besides the pair, where a chow or pong fills one block and a kong two. */
+const int N_HAND_BLOCKS = 4;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Pair excess (pairs - kongs) and number of used blocks of the decompositions of a group of tiles.
+     */
+    struct Shanten_entry
+    {
+        int pair_excess;   ///< Number of pairs minus number of kongs.
+        int n_used_blocks; ///< Blocks of the chows and pongs, two for every kong and one for every partial.
+    };
+
+    /**
+     * @brief Checks whether decompositions with the given pair excess and used blocks can be part of a complete hand.
+     *
+     * Every kong lowers the pair excess by one and uses two blocks, so the pair excess is at least -w / 2 for w
+     * used blocks and at most 1 + (N_HAND_BLOCKS - w) / 2, the kongs of the other blocks lowering it to 1.
+     */
+    constexpr bool is_relevant_shanten_entry(int pair_excess, int n_used_blocks)
+    {
+        return n_used_blocks >= 0 && n_used_blocks <= N_HAND_BLOCKS && pair_excess >= -(n_used_blocks / 2) && pair_excess <= 1 + (N_HAND_BLOCKS - n_used_blocks) / 2;
+    }
+
+    /** @brief Number of relevant combinations of pair excess and used blocks. */
+    inline constexpr unsigned int N_SHANTEN_ENTRIES = 18;
+
+    /** @brief The relevant combinations of pair excess and used blocks, ordered by used blocks. */
+    inline constexpr std::array<Shanten_entry, N_SHANTEN_ENTRIES> SHANTEN_ENTRIES = []
+    {
+        std::array<Shanten_entry, N_SHANTEN_ENTRIES> entries{};
+        unsigned int index = 0;
+        for (int n_used_blocks = 0; n_used_blocks <= N_HAND_BLOCKS; n_used_blocks++)
+        {
+            for (int pair_excess = -N_HAND_BLOCKS; pair_excess <= N_HAND_BLOCKS; pair_excess++)
+            {
+                if (is_relevant_shanten_entry(pair_excess, n_used_blocks))
+                    entries[index++] = {pair_excess, n_used_blocks};
+            }
+        }
+        return entries;
+    }();
+
+    /**
+     * @brief Gets the index of a combination of pair excess and used blocks in SHANTEN_ENTRIES.
+     *
+     * @return The index, -1 if the combination isn't relevant.
+     */
+    constexpr int get_shanten_entry_index(int pair_excess, int n_used_blocks)
+    {
+        for (unsigned int index = 0; index < N_SHANTEN_ENTRIES; index++)
+        {
+            if (SHANTEN_ENTRIES[index].pair_excess == pair_excess && SHANTEN_ENTRIES[index].n_used_blocks == n_used_blocks)
+                return static_cast<int>(index);
+        }
+        return -1;
+    }
+
+    /** @brief Index of the entry of the sum of two entries, -1 if the sum isn't relevant. */
+    inline constexpr std::array<std::array<signed char, N_SHANTEN_ENTRIES>, N_SHANTEN_ENTRIES> SHANTEN_ENTRY_SUMS = []
+    {
+        std::array<std::array<signed char, N_SHANTEN_ENTRIES>, N_SHANTEN_ENTRIES> sums{};
+        for (unsigned int first = 0; first < N_SHANTEN_ENTRIES; first++)
+        {
+            for (unsigned int second = 0; second < N_SHANTEN_ENTRIES; second++)
+                sums[first][second] = static_cast<signed char>(get_shanten_entry_index(SHANTEN_ENTRIES[first].pair_excess + SHANTEN_ENTRIES[second].pair_excess,
+                                                                                        SHANTEN_ENTRIES[first].n_used_blocks + SHANTEN_ENTRIES[second].n_used_blocks));
+        }
+        return sums;
+    }();
+
+    /** @brief Bit mask of the lowest bit of the three-bit field of every entry of Shanten_values. */
+    inline constexpr std::uint64_t SHANTEN_FIELD_BITS = 0x0009249249249249;
+
+    /**
+     * @brief Best partial decompositions of a group of tiles.
+     *
+     * For every relevant entry of SHANTEN_ENTRIES, i.e. pair excess e and used blocks w that can be part of a
+     * complete hand, the values hold the maximal number of blocks filled by complete combinations of the
+     * decompositions with e and w. A hand keeps complete + w + e tiles more than the seven tiles of four empty
+     * blocks and two empty pairs, so its shanten number is 8 - (complete + w + e) for e <= 1.
+     *
+     * The values are packed into 54 bits, three bits (complete blocks + 1, 0 if no such decomposition exists)
+     * per entry, so tables store them directly and the evaluation of a hand only touches the achievable entries.
+     */
+    struct Shanten_values
+    {
+        std::uint64_t fields = 0; ///< Complete blocks + 1 per entry, three bits each.
+
+        /**
+         * @brief Gets the values of an empty group, i.e. only nothing is achievable.
+         */
+        static Shanten_values empty()
+        {
+            Shanten_values values;
+            values.set(get_shanten_entry_index(0, 0), 0);
+            return values;
+        }
+
+        /**
+         * @brief Gets the values with no achievable decomposition.
+         */
+        static Shanten_values none()
+        {
+            return Shanten_values();
+        }
+
+        /**
+         * @brief Gets the lowest bit of the field of every achievable entry, i.e. bit 3 * index.
+         */
+        std::uint64_t get_achievable() const
+        {
+            return (fields | (fields >> 1) | (fields >> 2)) & SHANTEN_FIELD_BITS;
+        }
+
+        /**
+         * @brief Gets the maximal number of complete blocks of an achievable entry.
+         *
+         * @param bit The lowest bit of the field of the entry, i.e. 3 * index.
+         */
+        int get_complete_blocks(int bit) const
+        {
+            return static_cast<int>((fields >> bit) & 7) - 1;
+        }
+
+        /**
+         * @brief Raises the complete blocks of an entry to the given number.
+         *
+         * @param index Index of the entry in SHANTEN_ENTRIES.
+         * @param n_complete_blocks The number of complete blocks.
+         */
+        void set(int index, int n_complete_blocks)
+        {
+            std::uint64_t field = (fields >> (3 * index)) & 7;
+            std::uint64_t new_field = n_complete_blocks + 1;
+            if (new_field > field)
+                fields += (new_field - field) << (3 * index);
+        }
+
+        /**
+         * @brief Adds the decompositions of another group, given the same tiles, to the achievable decompositions.
+         *
+         * @param other The values of the other decompositions.
+         * @param added_excess Pair excess added to the other decompositions.
+         * @param added_blocks Number of used blocks added to the other decompositions.
+         * @param added_complete Number of complete blocks added to the other decompositions.
+         */
+        void include(const Shanten_values &other, int added_excess, int added_blocks, int added_complete)
+        {
+            for (std::uint64_t bits = other.get_achievable(); bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                const Shanten_entry &entry = SHANTEN_ENTRIES[bit / 3];
+                int target = get_shanten_entry_index(entry.pair_excess + added_excess, entry.n_used_blocks + added_blocks);
+                if (target >= 0)
+                    set(target, other.get_complete_blocks(bit) + added_complete);
+            }
+        }
+
+        /**
+         * @brief Combines the decompositions of two disjoint groups of tiles.
+         *
+         * @param other The values of the other group.
+         * @return The values of the union of both groups.
+         */
+        Shanten_values combine(const Shanten_values &other) const
+        {
+            Shanten_values result;
+            std::uint64_t other_achievable = other.get_achievable();
+            for (std::uint64_t bits = get_achievable(); bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                for (std::uint64_t other_bits = other_achievable; other_bits != 0; other_bits &= other_bits - 1)
+                {
+                    int other_bit = __builtin_ctzll(other_bits);
+                    int target = SHANTEN_ENTRY_SUMS[bit / 3][other_bit / 3];
+                    if (target >= 0)
+                        result.set(target, get_complete_blocks(bit) + other.get_complete_blocks(other_bit));
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Removes the entries dominated by another one, which the evaluation of a hand never selects.
+         *
+         * An entry is dominated by an entry with at most its pair excess and used blocks that keeps at least as
+         * many tiles: replacing it in any decomposition of a hand keeps the hand completable and its shanten
+         * number at most the same.
+         */
+        void remove_dominated()
+        {
+            std::uint64_t achievable = get_achievable();
+            std::uint64_t dominated = 0;
+            for (std::uint64_t bits = achievable; bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                const Shanten_entry &entry = SHANTEN_ENTRIES[bit / 3];
+                for (std::uint64_t other_bits = achievable & ~(std::uint64_t(1) << bit); other_bits != 0; other_bits &= other_bits - 1)
+                {
+                    int other_bit = __builtin_ctzll(other_bits);
+                    const Shanten_entry &other = SHANTEN_ENTRIES[other_bit / 3];
+                    if (other.pair_excess <= entry.pair_excess && other.n_used_blocks <= entry.n_used_blocks &&
+                        get_complete_blocks(other_bit) + other.n_used_blocks + other.pair_excess >= get_complete_blocks(bit) + entry.n_used_blocks + entry.pair_excess)
+                        dominated |= std::uint64_t(7) << bit;
+                }
+            }
+            fields &= ~dominated;
+        }
+
+        /**
+         * @brief Computes the shanten number given these values for all tiles of a hand, including the revealed ones.
+         *
+         * -1 denotes a complete hand, 0 a ready hand.
+         *
+         * @return The minimal shanten number, 8 if the hand can't be completed.
+         */
+        int get_shanten() const
+        {
+            int kept = 0;
+            for (std::uint64_t bits = get_achievable(); bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                const Shanten_entry &entry = SHANTEN_ENTRIES[bit / 3];
+                if (entry.pair_excess <= 1)
+                    kept = std::max(kept, get_complete_blocks(bit) + entry.n_used_blocks + entry.pair_excess);
+            }
+            return 8 - kept;
+        }
+
+        /**
+         * @brief Computes the shanten number of a hand split into two groups, without combining their values.
+         *
+         * @param other The values of the other group.
+         * @return The shanten number of this group's values combined with the other ones.
+         */
+        int get_shanten(const Shanten_values &other) const
+        {
+            int kept = 0;
+            std::uint64_t other_achievable = other.get_achievable();
+            for (std::uint64_t bits = get_achievable(); bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                for (std::uint64_t other_bits = other_achievable; other_bits != 0; other_bits &= other_bits - 1)
+                {
+                    int other_bit = __builtin_ctzll(other_bits);
+                    int target = SHANTEN_ENTRY_SUMS[bit / 3][other_bit / 3];
+                    if (target >= 0 && SHANTEN_ENTRIES[target].pair_excess <= 1)
+                        kept = std::max(kept, get_complete_blocks(bit) + other.get_complete_blocks(other_bit) + SHANTEN_ENTRIES[target].n_used_blocks + SHANTEN_ENTRIES[target].pair_excess);
+                }
+            }
+            return 8 - kept;
+        }
+    };
+
+    /**
+     * @class Shanten_table
+     * @brief Precomputed Shanten_values of all count patterns of a single ground suit.
+     *
+     * Suit patterns are encoded like in the Decomposition_table. Each pattern is derived from the patterns obtained
+     * by removing a group containing its lowest rank: a single tile, a pair (as pair or as partial), a pong, a kong,
+     * a chow or one of the partial chows.
+     */
+    class Shanten_table
+    {
+    private:
+        std::vector<Shanten_values> values; /**< Values indexed by suit pattern. */
+
+    public:
+        /**
+         * @brief Constructor: Computes the values of all suit patterns with at most 14 tiles.
+         */
+        Shanten_table() : values(N_SUIT_PATTERNS)
+        {
+            const auto &POWERS = Decomposition_table::POWERS;
+            values[0] = Shanten_values::empty();
+
+            for (std::uint32_t key = 1; key < N_SUIT_PATTERNS; key++)
+            {
+                std::array<unsigned int, N_SUIT_RANKS> counts;
+                unsigned int n_tiles = 0;
+                std::uint32_t remainder = key;
+                for (unsigned int rank = 0; rank < N_SUIT_RANKS; rank++)
+                {
+                    counts[rank] = remainder % 5;
+                    remainder /= 5;
+                    n_tiles += counts[rank];
+                }
+                if (n_tiles > 14)
+                    continue;
+
+                unsigned int lowest = 0;
+                while (counts[lowest] == 0)
+                    lowest++;
+
+                Shanten_values result = Shanten_values::none();
+
+                // Single unused tile
+                result.include(get_values(key - POWERS[lowest]), 0, 0, 0);
+
+                // Pair or partial pong
+                if (counts[lowest] >= 2)
+                {
+                    Shanten_values sub = get_values(key - 2 * POWERS[lowest]);
+                    result.include(sub, 1, 0, 0);
+                    result.include(sub, 0, 1, 0);
+                }
+
+                // Pong
+                if (counts[lowest] >= 3)
+                    result.include(get_values(key - 3 * POWERS[lowest]), 0, 1, 1);
+
+                // Kong, filling two blocks with its additional pair
+                if (counts[lowest] == 4)
+                    result.include(get_values(key - 4 * POWERS[lowest]), -1, 2, 2);
+
+                // Chow and partial chows
+                if (lowest + 1 < N_SUIT_RANKS && counts[lowest + 1] > 0)
+                {
+                    result.include(get_values(key - POWERS[lowest] - POWERS[lowest + 1]), 0, 1, 0);
+                    if (lowest + 2 < N_SUIT_RANKS && counts[lowest + 2] > 0)
+                        result.include(get_values(key - POWERS[lowest] - POWERS[lowest + 1] - POWERS[lowest + 2]), 0, 1, 1);
+                }
+                if (lowest + 2 < N_SUIT_RANKS && counts[lowest + 2] > 0)
+                    result.include(get_values(key - POWERS[lowest] - POWERS[lowest + 2]), 0, 1, 0);
+
+                result.remove_dominated();
+                values[key] = result;
+            }
+        }
+
+        /**
+         * @brief Gets the values of the given suit pattern.
+         * @param key Base-5 encoded suit pattern.
+         * @return The values of the pattern.
+         */
+        Shanten_values get_values(std::uint32_t key) const
+        {
+            return values[key];
+        }
+
+        /**
+         * @brief Gets the shared table instance, computing it on first use.
+         * @return Reference to the table.
+         */
+        static const Shanten_table &get_instance()
+        {
+            static const Shanten_table table;
+            return table;
+        }
+    };
+
+    /**
+     * @brief Gets the values of revealed tiles, which always form complete combinations.
+     *
+     * The revealed tiles may be split into chows, pongs and kongs in several ways, e.g. four revealed tiles of a
+     * kind form a kong or a pong and a tile of a chow, so the values hold every achievable number of kongs.
+     *
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @return The values, none if the revealed tiles can't be split into combinations.
+     */
+    inline Shanten_values get_revealed_values(const Tile_counts &revealed_counts)
+    {
+        int n_tiles = 0;
+        for (unsigned char count : revealed_counts)
+            n_tiles += count;
+
+        Shanten_values values = Shanten_values::none();
+        std::uint64_t kong_options = get_decomposition_values(revealed_counts, true);
+        for (int n_kongs = 0; kong_options != 0; n_kongs++, kong_options >>= 1)
+        {
+            int n_blocks = (n_tiles - n_kongs) / 3 + n_kongs;
+            if ((kong_options & 1) && is_relevant_shanten_entry(-n_kongs, n_blocks))
+                values.set(get_shanten_entry_index(-n_kongs, n_blocks), n_blocks);
+        }
+        return values;
+    }
+
+    /**
+     * @brief Gets the kinds of which the hidden and revealed tiles together may form a kong.
+     *
+     * is_complete_hand lets kongs mix hidden and revealed tiles, e.g. a revealed pong and the fourth tile of
+     * its kind drawn later.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @return Bit mask of the tile kinds.
+     */
+    inline std::uint64_t get_mixed_kong_kinds(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts)
+    {
+        std::uint64_t kinds = 0;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            if (hidden_counts[kind] > 0 && revealed_counts[kind] > 0 && hidden_counts[kind] + revealed_counts[kind] == 4)
+                kinds |= std::uint64_t(1) << kind;
+        }
+        return kinds;
+    }
+
+    /** @brief Number of tile groups evaluated separately: the three ground suits and all honours. */
+    const unsigned int N_SHANTEN_GROUPS = 4;
+
+    /**
+     * @brief Gets the key of the honour group, the numbers of honour kinds held twice, three times and four times.
+     *
+     * Honours can't form chows, so the values of the honour group only depend on these numbers. Single honours
+     * never contribute to a combination or partial.
+     */
+    inline unsigned int get_honour_key(const Tile_counts &counts)
+    {
+        unsigned int key = 0;
+        for (unsigned int kind = 27; kind < N_TILE_KINDS; kind++)
+        {
+            if (counts[kind] > 1)
+                key += 1u << (3 * (counts[kind] - 2));
+        }
+        return key;
+    }
+
+    /**
+     * @brief Gets the values of the honour group given its key (see get_honour_key).
+     */
+    inline const Shanten_values &get_honour_values(unsigned int key)
+    {
+        static const std::array<Shanten_values, 512> HONOUR_VALUES = []
+        {
+            const Shanten_table &table = Shanten_table::get_instance();
+            std::array<Shanten_values, 512> honour_values;
+            for (unsigned int key = 0; key < honour_values.size(); key++)
+            {
+                // Values of a single kind are those of a suit pattern with rank 0 only, i.e. without chows.
+                honour_values[key] = Shanten_values::empty();
+                for (unsigned int count = 2; count <= 4; count++)
+                {
+                    for (unsigned int n = 0; n < ((key >> (3 * (count - 2))) & 7); n++)
+                        honour_values[key] = honour_values[key].combine(table.get_values(count));
+                }
+                honour_values[key].remove_dominated();
+            }
+            return honour_values;
+        }();
+        return HONOUR_VALUES[key];
+    }
+
+    /**
+     * @brief Gets the values of the groups of hidden tiles, indexed by suit.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @return The values of the three ground suits and of the honours.
+     */
+    inline std::array<Shanten_values, N_SHANTEN_GROUPS> get_group_values(const Tile_counts &hidden_counts)
+    {
+        const Shanten_table &table = Shanten_table::get_instance();
+        return {table.get_values(get_suit_key(hidden_counts, 0)),
+                table.get_values(get_suit_key(hidden_counts, 1)),
+                table.get_values(get_suit_key(hidden_counts, 2)),
+                get_honour_values(get_honour_key(hidden_counts))};
+    }
+
+    /**
+     * @brief Computes the shanten number of a hand without mixed kongs, given the values of its revealed tiles.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @param revealed_values The values of the revealed tiles (see get_revealed_values).
+     * @return The shanten number.
+     */
+    inline int get_separate_shanten(const Tile_counts &hidden_counts, const Shanten_values &revealed_values)
+    {
+        std::array<Shanten_values, N_SHANTEN_GROUPS> groups = get_group_values(hidden_counts);
+        return revealed_values.combine(groups[0]).combine(groups[1]).get_shanten(groups[2].combine(groups[3]));
+    }
+
+    /**
+     * @brief Computes the shanten number of a hand, i.e. the number of tiles to be exchanged to reach a ready hand.
+     *
+     * Follows the rules of is_complete_hand: pairs, chows, pongs and kongs are formed from the hidden tiles, the
+     * revealed tiles form complete combinations and kongs may mix both. The result is -1 exactly for a complete
+     * hand and 0 for a ready hand. Evaluating a hand takes four table lookups and four combinations of their
+     * values, and further ones for every option of a mixed kong.
+     *
+     * If `MAHJONG_VALIDATE_SHANTEN` is defined, hands of shanten number -1 are compared against is_complete_hand.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @return The shanten number.
+     */
+    inline int get_shanten(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts)
+    {
+        std::uint64_t mixed_kinds = get_mixed_kong_kinds(hidden_counts, revealed_counts);
+        int shanten = get_separate_shanten(hidden_counts, get_revealed_values(revealed_counts));
+
+        // Kinds of mixed kongs are removed from both parts and counted as revealed kongs, try all options.
+        for (std::uint64_t selection = mixed_kinds; selection != 0; selection = (selection - 1) & mixed_kinds)
+        {
+            Tile_counts hidden = hidden_counts;
+            Tile_counts revealed = revealed_counts;
+            int n_mixed_kongs = 0;
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+            {
+                if (selection & (std::uint64_t(1) << kind))
+                {
+                    hidden[kind] = 0;
+                    revealed[kind] = 0;
+                    n_mixed_kongs++;
+                }
+            }
+            Shanten_values revealed_values = Shanten_values::none();
+            revealed_values.include(get_revealed_values(revealed), -n_mixed_kongs, 2 * n_mixed_kongs, 2 * n_mixed_kongs);
+            shanten = std::min(shanten, get_separate_shanten(hidden, revealed_values));
+        }
+#ifdef MAHJONG_VALIDATE_SHANTEN
+        assert((shanten == -1) == is_complete_hand(hidden_counts, revealed_counts));
+#endif
+        return shanten;
+    }
+
+    /**
+     * @brief Computes the minimal shanten number after discarding one of the hidden tiles.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind, usually of a hand of 14 tiles.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @return The minimal shanten number over all discards.
+     */
+    inline int get_discard_shanten(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts)
+    {
+        Tile_counts counts = hidden_counts;
+        int shanten = 8;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            if (counts[kind] == 0)
+                continue;
+            counts[kind] -= 1;
+            shanten = std::min(shanten, get_shanten(counts, revealed_counts));
+            counts[kind] += 1;
+        }
+        return shanten;
+    }
+
+    /**
+     * @brief Computes the shanten number after claiming a discarded tile.
+     *
+     * A claim completing the hand wins, every other claim, including a kong, is followed by the best discard. For
+     * chows the best of all chows containing the tile is used.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind before the claim.
+     * @param revealed_counts Number of revealed tiles per tile kind before the claim.
+     * @param kind The kind of the discarded tile.
+     * @param n_claimed_tiles Number of hidden tiles of the kind revealed with the tile, 2 for a pong and 3 for a kong.
+     *  0 denotes a chow.
+     * @return The shanten number after the claim, -1 if it completes the hand, or 8 if the claim isn't possible.
+     */
+    inline int get_claim_shanten(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts, unsigned int kind, unsigned int n_claimed_tiles)
+    {
+        Tile_counts counts = hidden_counts;
+        Tile_counts revealed = revealed_counts;
+        if (n_claimed_tiles > 0)
+        {
+            if (counts[kind] < n_claimed_tiles)
+                return 8;
+            counts[kind] -= n_claimed_tiles;
+            revealed[kind] += n_claimed_tiles + 1;
+            return (get_shanten(counts, revealed) == -1) ? -1 : get_discard_shanten(counts, revealed);
+        }
+
+        int shanten = 8;
+        if (kind >= 27)
+            return shanten;
+        unsigned int rank = kind % N_SUIT_RANKS;
+        for (unsigned int start = (rank >= 2 ? rank - 2 : 0); start <= rank && start + 2 < N_SUIT_RANKS; start++)
+        {
+            unsigned int first = kind - rank + start;
+            bool available = true;
+            for (unsigned int other = first; other < first + 3; other++)
+                available = available && (other == kind || counts[other] > 0);
+            if (!available)
+                continue;
+            for (unsigned int other = first; other < first + 3; other++)
+            {
+                counts[other] -= (other != kind);
+                revealed[other] += 1;
+            }
+            shanten = std::min(shanten, (get_shanten(counts, revealed) == -1) ? -1 : get_discard_shanten(counts, revealed));
+            for (unsigned int other = first; other < first + 3; other++)
+            {
+                counts[other] += (other != kind);
+                revealed[other] -= 1;
+            }
+        }
+        return shanten;
+    }
+
+    /**
+     * @brief Checks whether adding a tile of the given kind may reduce the shanten number of a hand.
+     *
+     * Only tiles of the same kind or, in ground suits, within a distance of two of a hidden tile can extend a
+     * partial or complete combination, and tiles of a revealed kind may complete a mixed kong.
+     */
+    inline bool may_improve(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts, unsigned int kind)
+    {
+        if (hidden_counts[kind] > 0 || revealed_counts[kind] > 0)
+            return true;
+        if (kind >= 27)
+            return false;
+        unsigned int rank = kind % N_SUIT_RANKS;
+        unsigned int suit_start = kind - rank;
+        for (unsigned int other = (rank >= 2 ? rank - 2 : 0); other <= std::min(rank + 2, N_SUIT_RANKS - 1); other++)
+        {
+            if (hidden_counts[suit_start + other] > 0)
+                return true;
+        }
+        return false;
+    }
+
+    /** @brief Keys of the groups of a hand: the suit patterns of the three ground suits and the honour key. */
+    using Shanten_keys = std::array<std::uint32_t, N_SHANTEN_GROUPS>;
+
+    /**
+     * @brief Gets the group of a tile kind, 0 to 2 for the ground suits and 3 for the honours.
+     */
+    inline unsigned int get_shanten_group(unsigned int kind)
+    {
+        return std::min(kind / N_SUIT_RANKS, N_SHANTEN_GROUPS - 1);
+    }
+
+    /**
+     * @brief Gets the keys of the groups of hidden tiles.
+     */
+    inline Shanten_keys get_shanten_keys(const Tile_counts &hidden_counts)
+    {
+        return {get_suit_key(hidden_counts, 0), get_suit_key(hidden_counts, 1), get_suit_key(hidden_counts, 2), get_honour_key(hidden_counts)};
+    }
+
+    /**
+     * @brief Gets the key of the group of a tile kind after changing the number of hidden tiles of the kind.
+     *
+     * @param key The key of the group of the kind.
+     * @param kind The tile kind.
+     * @param count The number of hidden tiles of the kind.
+     * @param new_count The new number of hidden tiles of the kind.
+     * @return The changed key.
+     */
+    inline std::uint32_t get_changed_key(std::uint32_t key, unsigned int kind, unsigned int count, unsigned int new_count)
+    {
+        if (kind < 27)
+            return key + new_count * Decomposition_table::POWERS[kind % N_SUIT_RANKS] - count * Decomposition_table::POWERS[kind % N_SUIT_RANKS];
+        // The count moves between the buckets of the honour key, single honours aren't counted.
+        if (count > 1)
+            key -= 1u << (3 * (count - 2));
+        if (new_count > 1)
+            key += 1u << (3 * (new_count - 2));
+        return key;
+    }
+
+    /**
+     * @brief Gets the values of a group given its key (see get_shanten_keys).
+     */
+    inline Shanten_values get_key_values(unsigned int group, std::uint32_t key)
+    {
+        return (group < 3) ? Shanten_table::get_instance().get_values(key) : get_honour_values(key);
+    }
+
+    /**
+     * @class Shanten_base
+     * @brief The values of all tiles of a hand but one group, prepared for evaluating the hand with any values of that group.
+     *
+     * For every entry of the group, the base holds the maximal number of tiles kept together with the other tiles,
+     * so a hand in which only that group changes, e.g. by drawing or discarding a tile, is evaluated in one pass
+     * over the achievable entries of the group.
+     */
+    class Shanten_base
+    {
+    private:
+        std::array<signed char, N_SHANTEN_ENTRIES> kept; ///< Complete blocks + w + e of the best sum per entry of the group, -1 if none.
+
+    public:
+        /**
+         * @brief Default constructor for a base without achievable decompositions.
+         */
+        Shanten_base()
+        {
+            kept.fill(-1);
+        }
+
+        /**
+         * @brief Constructor from the values of the other tiles.
+         *
+         * @param others The combined values of the revealed tiles and the other groups.
+         */
+        explicit Shanten_base(const Shanten_values &others)
+        {
+            kept.fill(-1);
+            std::uint64_t others_achievable = others.get_achievable();
+            for (unsigned int index = 0; index < N_SHANTEN_ENTRIES; index++)
+            {
+                for (std::uint64_t bits = others_achievable; bits != 0; bits &= bits - 1)
+                {
+                    int bit = __builtin_ctzll(bits);
+                    int target = SHANTEN_ENTRY_SUMS[index][bit / 3];
+                    if (target >= 0 && SHANTEN_ENTRIES[target].pair_excess <= 1)
+                        kept[index] = static_cast<signed char>(std::max<int>(kept[index], others.get_complete_blocks(bit) + SHANTEN_ENTRIES[target].n_used_blocks + SHANTEN_ENTRIES[target].pair_excess));
+                }
+            }
+        }
+
+        /**
+         * @brief Computes the shanten number of the hand with the given values of the group.
+         *
+         * @param group The values of the group.
+         * @return The shanten number, equal to the one of the combined values.
+         */
+        int get_shanten(const Shanten_values &group) const
+        {
+            int max_kept = 0;
+            for (std::uint64_t bits = group.get_achievable(); bits != 0; bits &= bits - 1)
+            {
+                int bit = __builtin_ctzll(bits);
+                if (kept[bit / 3] >= 0)
+                    max_kept = std::max(max_kept, kept[bit / 3] + group.get_complete_blocks(bit));
+            }
+            return 8 - max_kept;
+        }
+    };
+
+    /**
+     * @brief Counts the live tiles reducing the shanten number of a hand when drawn, given the bases of its groups.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @param live_counts Number of tiles per tile kind that may still be drawn.
+     * @param keys The keys of the groups of the hidden tiles.
+     * @param bases For every group the base of the other groups and the revealed tiles.
+     * @param shanten The shanten number of the hand.
+     * @param has_mixed_kongs Whether the hand may form a mixed kong, which the bases don't cover.
+     * @param improving_kinds Optionally receives a bit mask of the improving tile kinds.
+     * @return The number of improving live tiles.
+     */
+    inline unsigned int count_improving_tiles(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts, const Tile_counts &live_counts, const Shanten_keys &keys,
+                                              const std::array<Shanten_base, N_SHANTEN_GROUPS> &bases, int shanten, bool has_mixed_kongs, std::uint64_t *improving_kinds)
+    {
+        unsigned int ukeire = 0;
+        std::uint64_t kinds = 0;
+        Tile_counts counts = hidden_counts;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            if (live_counts[kind] == 0 || hidden_counts[kind] >= 4 || !may_improve(hidden_counts, revealed_counts, kind))
+                continue;
+
+            int new_shanten;
+            if (has_mixed_kongs || (revealed_counts[kind] > 0 && hidden_counts[kind] + revealed_counts[kind] == 3))
+            {
+                // The tile may complete a mixed kong, which the separate evaluation of the groups doesn't cover.
+                counts[kind] += 1;
+                new_shanten = get_shanten(counts, revealed_counts);
+                counts[kind] -= 1;
+            }
+            else
+            {
+                unsigned int group = get_shanten_group(kind);
+                new_shanten = bases[group].get_shanten(get_key_values(group, get_changed_key(keys[group], kind, hidden_counts[kind], hidden_counts[kind] + 1)));
+            }
+
+            if (new_shanten < shanten)
+            {
+                ukeire += live_counts[kind];
+                kinds |= std::uint64_t(1) << kind;
+            }
+        }
+        if (improving_kinds != nullptr)
+            *improving_kinds = kinds;
+        return ukeire;
+    }
+
+    /**
+     * @brief Computes the ukeire of a hand, i.e. the number of live tiles reducing its shanten number when drawn.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind, usually of a hand of 13 tiles.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @param live_counts Number of tiles per tile kind that may still be drawn (see State_view::get_live_counts).
+     * @param improving_kinds Optionally receives a bit mask of the improving tile kinds.
+     * @return The number of improving live tiles.
+     */
+    inline unsigned int get_ukeire(const Tile_counts &hidden_counts, const Tile_counts &revealed_counts, const Tile_counts &live_counts, std::uint64_t *improving_kinds = nullptr)
+    {
+        // Drawing a tile only changes the values of its own group, so the other groups are combined once.
+        Shanten_keys keys = get_shanten_keys(hidden_counts);
+        std::array<Shanten_values, N_SHANTEN_GROUPS> groups;
+        for (unsigned int group = 0; group < N_SHANTEN_GROUPS; group++)
+            groups[group] = get_key_values(group, keys[group]);
+        Shanten_values revealed_values = get_revealed_values(revealed_counts);
+        std::array<Shanten_base, N_SHANTEN_GROUPS> bases;
+        for (unsigned int group = 0; group < N_SHANTEN_GROUPS; group++)
+        {
+            Shanten_values others = revealed_values;
+            for (unsigned int other = 0; other < N_SHANTEN_GROUPS; other++)
+            {
+                if (other != group)
+                    others = others.combine(groups[other]);
+            }
+            bases[group] = Shanten_base(others);
+        }
+        bool has_mixed_kongs = get_mixed_kong_kinds(hidden_counts, revealed_counts) != 0;
+        int shanten = has_mixed_kongs ? get_shanten(hidden_counts, revealed_counts) : bases[0].get_shanten(groups[0]);
+        return count_improving_tiles(hidden_counts, revealed_counts, live_counts, keys, bases, shanten, has_mixed_kongs, improving_kinds);
+    }
+
+    /**
+     * @class Shanten_discard_evaluator
+     * @brief Shanten number and ukeire of a hand after each of its discards, sharing the work of all discards.
+     *
+     * Discarding a tile only changes the values of its own group and drawing one afterwards those of at most one
+     * further group, so the other groups are combined once per hand. The results equal get_shanten and get_ukeire
+     * of the hand without the discarded tile.
+     */
+    class Shanten_discard_evaluator
+    {
+    private:
+        Tile_counts hidden_counts;                               ///< Number of hidden tiles per tile kind.
+        Tile_counts revealed_counts;                             ///< Number of revealed tiles per tile kind.
+        Shanten_keys keys;                                       ///< The keys of the groups of the hidden tiles.
+        std::uint64_t mixed_kong_kinds;                          ///< The kinds that may form a mixed kong (see get_mixed_kong_kinds).
+        std::array<Shanten_base, N_SHANTEN_GROUPS> bases;        ///< For every group the base of the other groups and the revealed tiles.
+        std::array<std::array<Shanten_values, N_SHANTEN_GROUPS>, N_SHANTEN_GROUPS> pair_others; ///< The revealed tiles and all groups but the two indexed ones.
+
+    public:
+        /**
+         * @brief Constructor preparing the evaluation of the discards of a hand.
+         *
+         * @param hidden_counts_in Number of hidden tiles per tile kind, usually of a hand of 14 tiles.
+         * @param revealed_counts_in Number of revealed tiles per tile kind.
+         */
+        Shanten_discard_evaluator(const Tile_counts &hidden_counts_in, const Tile_counts &revealed_counts_in)
+            : hidden_counts(hidden_counts_in), revealed_counts(revealed_counts_in), keys(get_shanten_keys(hidden_counts_in)),
+              mixed_kong_kinds(get_mixed_kong_kinds(hidden_counts_in, revealed_counts_in))
+        {
+            std::array<Shanten_values, N_SHANTEN_GROUPS> groups;
+            for (unsigned int group = 0; group < N_SHANTEN_GROUPS; group++)
+                groups[group] = get_key_values(group, keys[group]);
+            Shanten_values revealed_values = get_revealed_values(revealed_counts);
+            for (unsigned int first = 0; first < N_SHANTEN_GROUPS; first++)
+            {
+                for (unsigned int second = first + 1; second < N_SHANTEN_GROUPS; second++)
+                {
+                    Shanten_values others = revealed_values;
+                    for (unsigned int other = 0; other < N_SHANTEN_GROUPS; other++)
+                    {
+                        if (other != first && other != second)
+                            others = others.combine(groups[other]);
+                    }
+                    pair_others[first][second] = others;
+                    pair_others[second][first] = others;
+                }
+            }
+            for (unsigned int group = 0; group < N_SHANTEN_GROUPS; group++)
+            {
+                unsigned int other = (group == 0) ? 1 : 0;
+                bases[group] = Shanten_base(pair_others[group][other].combine(groups[other]));
+            }
+        }
+
+        /**
+         * @brief Computes the shanten number after discarding a tile.
+         *
+         * @param kind The kind of the discarded tile, of which the hand has to hold a hidden tile.
+         * @return The shanten number of the hand without the tile.
+         */
+        int get_shanten(unsigned int kind) const
+        {
+            if ((mixed_kong_kinds & ~(std::uint64_t(1) << kind)) != 0)
+            {
+                Tile_counts counts = hidden_counts;
+                counts[kind] -= 1;
+                return Mahjong::get_shanten(counts, revealed_counts);
+            }
+            unsigned int group = get_shanten_group(kind);
+            return bases[group].get_shanten(get_key_values(group, get_changed_key(keys[group], kind, hidden_counts[kind], hidden_counts[kind] - 1)));
+        }
+
+        /**
+         * @brief Computes the ukeire after discarding a tile.
+         *
+         * @param kind The kind of the discarded tile, of which the hand has to hold a hidden tile.
+         * @param live_counts Number of tiles per tile kind that may still be drawn (see State_view::get_live_counts).
+         * @return The number of live tiles reducing the shanten number of the hand without the tile.
+         */
+        unsigned int get_ukeire(unsigned int kind, const Tile_counts &live_counts) const
+        {
+            Tile_counts counts = hidden_counts;
+            counts[kind] -= 1;
+            if ((mixed_kong_kinds & ~(std::uint64_t(1) << kind)) != 0)
+                return Mahjong::get_ukeire(counts, revealed_counts, live_counts);
+
+            unsigned int group = get_shanten_group(kind);
+            Shanten_keys discard_keys = keys;
+            discard_keys[group] = get_changed_key(keys[group], kind, hidden_counts[kind], hidden_counts[kind] - 1);
+            Shanten_values discarded = get_key_values(group, discard_keys[group]);
+            std::array<Shanten_base, N_SHANTEN_GROUPS> discard_bases;
+            for (unsigned int other = 0; other < N_SHANTEN_GROUPS; other++)
+                discard_bases[other] = (other == group) ? bases[group] : Shanten_base(pair_others[group][other].combine(discarded));
+            return count_improving_tiles(counts, revealed_counts, live_counts, discard_keys, discard_bases, bases[group].get_shanten(discarded), false, nullptr);
+        }
+    };
+} // namespace Mahjong
@@ -0,0 +1,536 @@
+/**
+ * @file Simulation_runner.hpp
+ * @brief Defines the Simulation_runner class playing batches of headless Mahjong games on multiple threads.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Game.hpp"
+#include "Game_record.hpp"
+#include "Instrumentation.hpp"
+#include "Statistics.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Aggregated results of a batch of simulated games.
+     */
+    struct Simulation_results
+    {
+        unsigned int n_games = 0;                          ///< Number of games played.
+        std::array<unsigned int, 4> player_wins = {};      ///< Number of wins per player.
+        std::array<long long, 4> player_scores = {};       ///< Sum of final scores per player.
+        std::array<Mahjong::Running_stats, 4> score_stats; ///< Final score per game per player.
+        std::array<Mahjong::Running_stats, 4> duplicate_differences; ///< Per deal of a duplicate simulation, the score of a player minus the average of all players.
+        Mahjong::Running_stats comparison;                 ///< Score difference per game of the compared policies (see Policy_comparison).
+        bool significant_difference = false;               ///< Whether the compared policies were found to differ significantly.
+        Mahjong::Instrumentation_counters instrumentation; ///< Hot path counters of the games, zero unless MAHJONG_INSTRUMENT is defined.
+
+        /**
+         * @brief Adds the results of another batch to these results.
+         *
+         * @param other The results to be merged.
+         */
+        void merge(const Simulation_results &other)
+        {
+            n_games += other.n_games;
+            for (size_t i = 0; i < player_wins.size(); i++)
+            {
+                player_wins[i] += other.player_wins[i];
+                player_scores[i] += other.player_scores[i];
+                score_stats[i].merge(other.score_stats[i]);
+                duplicate_differences[i].merge(other.duplicate_differences[i]);
+            }
+            comparison.merge(other.comparison);
+            significant_difference = significant_difference || other.significant_difference;
+            instrumentation.merge(other.instrumentation);
+        }
+    };
+
+    /**
+     * @brief Settings of a comparison of two policies, stopping the games once their scores differ significantly.
+     *
+     * The difference of a game is the average final score of the seats playing policy_a minus the one of the seats
+     * playing policy_b, or of the players in players_a resp. players_b if given, e.g. to compare two parameter
+     * settings of the same policy. In duplicate simulations, it is the average difference of the games of a deal.
+     * When stopping early, it is tested every
+     * check_interval games resp. deals, each test at the level significance divided by the
+     * number of tests possible within the maximal number of games (Bonferroni), so the chance of stopping without
+     * a true difference stays below significance despite the repeated tests.
+     */
+    struct Policy_comparison
+    {
+        Mahjong::Policy_type policy_a = Mahjong::Policy_type::tile_count; ///< First compared policy.
+        Mahjong::Policy_type policy_b = Mahjong::Policy_type::random;     ///< Second compared policy.
+        double significance = 0.05;                                       ///< Significance level of the whole sequence of tests.
+        unsigned int check_interval = 1000;                               ///< Number of games between two tests.
+        unsigned int players_a = 0;                                       ///< Bit mask of the first compared players, 0 to select them by policy_a.
+        unsigned int players_b = 0;                                       ///< Bit mask of the second compared players, 0 to select them by policy_b.
+
+        /**
+         * @brief Checks whether a player belongs to the first resp. second compared group.
+         *
+         * @param policies Policy per player.
+         * @param player The player.
+         * @param second Whether to check the second group.
+         * @return True if the player belongs to the group.
+         */
+        bool is_compared(const std::array<Mahjong::Policy_type, 4> &policies, size_t player, bool second) const
+        {
+            unsigned int players = second ? players_b : players_a;
+            if (players != 0)
+                return (players >> player) & 1;
+            return policies[player] == (second ? policy_b : policy_a);
+        }
+
+        /**
+         * @brief Gets the score difference of a game.
+         *
+         * @param policies Policy per player.
+         * @param scores Final score per player.
+         * @return The average score of the first compared players minus the one of the second compared players.
+         */
+        double get_difference(const std::array<Mahjong::Policy_type, 4> &policies, const std::array<long long, 4> &scores) const
+        {
+            double sum_a = 0, sum_b = 0;
+            unsigned int n_a = 0, n_b = 0;
+            for (size_t player = 0; player < policies.size(); player++)
+            {
+                if (is_compared(policies, player, false))
+                {
+                    sum_a += scores[player];
+                    n_a += 1;
+                }
+                else if (is_compared(policies, player, true))
+                {
+                    sum_b += scores[player];
+                    n_b += 1;
+                }
+            }
+            return sum_a / n_a - sum_b / n_b;
+        }
+    };
+
+    /**
+     * @class Work_stealing_queue
+     * @brief Distributes game indices over workers, letting idle workers steal from the others.
+     *
+     * Every worker owns a deque initially filled with a contiguous block of indices. Workers take indices from the
+     * back of their own deque and steal from the front of other deques once their own is empty.
+     */
+    class Work_stealing_queue
+    {
+    private:
+        /**
+         * @brief Queue of indices owned by a single worker.
+         */
+        struct Worker_queue
+        {
+            std::mutex mutex;                 ///< Mutex protecting the indices.
+            std::deque<unsigned int> indices; ///< Indices not yet taken.
+        };
+
+        std::vector<Worker_queue> queues; ///< One queue per worker.
+
+    public:
+        /**
+         * @brief Constructor distributing the indices [first_item, first_item + n_items) over the workers.
+         *
+         * @param n_items Number of indices to distribute.
+         * @param n_workers Number of workers.
+         * @param first_item The first index.
+         */
+        Work_stealing_queue(unsigned int n_items, unsigned int n_workers, unsigned int first_item = 0) : queues(n_workers)
+        {
+            for (unsigned int worker = 0; worker < n_workers; worker++)
+            {
+                unsigned int begin = first_item + static_cast<unsigned long long>(n_items) * worker / n_workers;
+                unsigned int end = first_item + static_cast<unsigned long long>(n_items) * (worker + 1) / n_workers;
+                for (unsigned int index = end; index > begin; index--)
+                    queues[worker].indices.push_back(index - 1);
+            }
+        }
+
+        /**
+         * @brief Takes the next index for the given worker.
+         *
+         * @param worker The index of the worker asking for work.
+         * @param index Receives the taken index.
+         * @return True if an index was taken, false if all indices are used up.
+         */
+        bool pop(unsigned int worker, unsigned int &index)
+        {
+            {
+                Worker_queue &own = queues[worker];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.indices.empty())
+                {
+                    index = own.indices.back();
+                    own.indices.pop_back();
+                    return true;
+                }
+            }
+
+            for (size_t offset = 1; offset < queues.size(); offset++)
+            {
+                Worker_queue &victim = queues[(worker + offset) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.indices.empty())
+                {
+                    index = victim.indices.front();
+                    victim.indices.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    /**
+     * @class Simulation_runner
+     * @brief Plays a batch of headless games on multiple threads, each worker owning its own Game.
+     */
+    class Simulation_runner
+    {
+    private:
+        unsigned int n_games;                 ///< Number of games to be played.
+        unsigned int n_threads;               ///< Number of worker threads.
+        std::array<Mahjong::Policy_type, 4> policies; ///< Policy per seat.
+        std::array<Mahjong::Policy_parameters, 4> parameters; ///< Policy parameters per seat.
+        std::uint64_t seed;                   ///< Base seed, the seed of each game is derived from it and the game index.
+        unsigned int first_game = 0;          ///< Index of the first game resp. deal.
+        Mahjong::Game_record_file *record_file = nullptr; ///< File receiving the records of all games, nullptr if not recorded.
+        bool compare = false;                 ///< Whether the score differences of the compared policies are accumulated.
+        bool stop_early = false;              ///< Whether the games stop once the compared policies differ significantly.
+        bool duplicate = false;               ///< Whether every deal is played once per rotation of the policies.
+        bool discard_wins_only = false;       ///< Whether only wins with a claimed discard are counted (see add_game_results).
+        Mahjong::Policy_comparison comparison; ///< The compared policies if compare is set.
+
+        /**
+         * @brief Plays a deal once per rotation of the policies over the seats.
+         *
+         * @param game The game of the worker.
+         * @param wall The set of the worker, receiving the wall of the deal.
+         * @param deal_index The index of the deal.
+         * @param writer The writer recording the games, nullptr if not recorded.
+         * @param results The results to add the outcome of the games to.
+         */
+        void play_deal(Mahjong::Game &game, Mahjong::Set &wall, unsigned int deal_index, Mahjong::Game_record_writer *writer, Simulation_results &results)
+        {
+            const std::uint64_t deal_seed = Mahjong::derive_seed(seed, deal_index);
+            Mahjong::Rng wall_rng(deal_seed);
+            wall.refill();
+            wall.shuffle(wall_rng);
+            const std::vector<Mahjong::Tile> &tiles = wall.get_tiles();
+
+            std::array<long long, 4> deal_scores = {};
+            for (unsigned int rotation = 0; rotation < N_PLAYERS; rotation++)
+            {
+                for (unsigned int seat = 0; seat < N_PLAYERS; seat++)
+                {
+                    game.set_player_policy(seat, policies[(seat + N_PLAYERS - rotation) % N_PLAYERS]);
+                    game.set_player_policy_parameters(seat, parameters[(seat + N_PLAYERS - rotation) % N_PLAYERS]);
+                }
+                if (writer != nullptr)
+                    writer->set_tag(deal_index * N_PLAYERS + rotation);
+                game.reset_with_wall(tiles.data(), tiles.data() + tiles.size(), Mahjong::derive_seed(deal_seed, 1));
+
+                std::array<long long, 4> scores = play_game(game, results, rotation, discard_wins_only);
+                for (unsigned int player = 0; player < N_PLAYERS; player++)
+                    deal_scores[player] += scores[player];
+            }
+
+            double average = 0;
+            for (unsigned int player = 0; player < N_PLAYERS; player++)
+                average += deal_scores[player] / double(N_PLAYERS * N_PLAYERS);
+            for (unsigned int player = 0; player < N_PLAYERS; player++)
+                results.duplicate_differences[player].add(deal_scores[player] / double(N_PLAYERS) - average);
+            if (compare)
+                results.comparison.add(comparison.get_difference(policies, deal_scores) / N_PLAYERS);
+        }
+
+        /**
+         * @brief Plays the games resp. deals [first_round_game, first_round_game + n_round_games) on all worker threads.
+         *
+         * @param first_round_game The index of the first game resp. deal.
+         * @param n_round_games The number of games resp. deals.
+         * @param progress_interval Print a progress message to std::cerr every this many games (0 disables it).
+         * @param n_started The number of games started before, updated by the started games.
+         * @return The merged results of the games, not including the instrumentation.
+         */
+        Simulation_results play_games(unsigned int first_round_game, unsigned int n_round_games, unsigned int progress_interval, unsigned int &n_started)
+        {
+            Work_stealing_queue queue(n_round_games, n_threads, first_round_game);
+            std::vector<Simulation_results> worker_results(n_threads);
+            std::mutex progress_mutex;
+
+            auto worker = [&](unsigned int worker_index)
+            {
+                Mahjong::Game game = Mahjong::Game(worker_index);
+                for (unsigned int seat = 0; seat < policies.size(); seat++)
+                {
+                    game.set_player_policy(seat, policies[seat]);
+                    game.set_player_policy_parameters(seat, parameters[seat]);
+                }
+                Mahjong::Set wall;
+                std::unique_ptr<Mahjong::Game_record_writer> writer;
+                if (record_file != nullptr)
+                {
+                    writer = std::make_unique<Mahjong::Game_record_writer>(*record_file);
+                    game.set_recorder(writer.get());
+                }
+                Simulation_results &results = worker_results[worker_index];
+
+                unsigned int game_index;
+                while (queue.pop(worker_index, game_index))
+                {
+                    if (progress_interval > 0)
+                    {
+                        std::lock_guard<std::mutex> lock(progress_mutex);
+                        if (n_started % progress_interval == 0)
+                            std::cerr << "Starting game number " << n_started << std::endl;
+                        n_started += 1;
+                    }
+
+                    if (duplicate)
+                    {
+                        play_deal(game, wall, game_index, writer.get(), results);
+                        continue;
+                    }
+                    if (writer)
+                        writer->set_tag(game_index);
+                    game.reset(Mahjong::derive_seed(seed, game_index));
+
+                    std::array<long long, 4> scores = play_game(game, results, 0, discard_wins_only);
+                    if (compare)
+                        results.comparison.add(comparison.get_difference(policies, scores));
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int worker_index = 0; worker_index < n_threads; worker_index++)
+                threads.emplace_back(worker, worker_index);
+            for (std::thread &thread : threads)
+                thread.join();
+
+            Simulation_results results;
+            for (const Simulation_results &partial : worker_results)
+                results.merge(partial);
+            return results;
+        }
+
+    public:
+        /**
+         * @brief Constructor for the Simulation_runner class.
+         *
+         * @param n_games_in Number of games to be played.
+         * @param n_threads_in Number of worker threads (at least one is used).
+         * @param policies_in Policy per seat.
+         * @param seed_in Base seed of the simulation.
+         */
+        Simulation_runner(unsigned int n_games_in, unsigned int n_threads_in, std::array<Mahjong::Policy_type, 4> policies_in, std::uint64_t seed_in = 0)
+            : n_games(n_games_in), n_threads(std::max(1u, n_threads_in)), policies(policies_in), seed(seed_in) {}
+
+        /**
+         * @brief Records all games to a file, each tagged with its game index.
+         *
+         * @param record_file_in The open record file, which must outlive the run, or nullptr to stop recording.
+         */
+        void set_record_file(Mahjong::Game_record_file *record_file_in)
+        {
+            record_file = record_file_in;
+        }
+
+        /**
+         * @brief Sets the randomness and chow rate of the policy of a seat.
+         *
+         * @param seat The seat, resp. the player in duplicate simulations.
+         * @param parameters_in The policy parameters.
+         */
+        void set_policy_parameters(unsigned int seat, const Mahjong::Policy_parameters &parameters_in)
+        {
+            parameters[seat] = parameters_in;
+        }
+
+        /**
+         * @brief Plays the games resp. deals [first_game_in, first_game_in + n_games) instead of starting at 0.
+         *
+         * As every game is seeded from its index, consecutive ranges played by different runs, e.g. the shards of
+         * a tournament, give the same games as a single run over all of them.
+         *
+         * @param first_game_in The index of the first game resp. deal.
+         */
+        void set_first_game(unsigned int first_game_in)
+        {
+            first_game = first_game_in;
+        }
+
+        /**
+         * @brief Plays every deal once per rotation of the policies over the seats (duplicate simulation).
+         *
+         * The i-th deal is a wall shuffled with a seed derived from the base seed and i. It is played N_PLAYERS
+         * times with the same wall and seed, the policy of player i sitting at seat (i + rotation) % N_PLAYERS,
+         * so every policy plays every hand and position of the deal once and the luck of the deal cancels out of
+         * the differences between the players. The number of games given to the constructor becomes the number
+         * of deals, the wins and scores of the results are accumulated per player rather than per seat, and the
+         * records of the games are tagged with deal * N_PLAYERS + rotation.
+         *
+         * @param duplicate_in Whether to play duplicate deals.
+         */
+        void set_duplicate(bool duplicate_in)
+        {
+            duplicate = duplicate_in;
+        }
+
+        /**
+         * @brief Sets whether only wins with a claimed discard are counted, as by the original simulation loop.
+         *
+         * By default every win is counted and scored, self-drawn ones included (see add_game_results).
+         *
+         * @param discard_wins_only_in Whether to count only wins with a claimed discard.
+         */
+        void set_discard_wins_only(bool discard_wins_only_in)
+        {
+            discard_wins_only = discard_wins_only_in;
+        }
+
+        /**
+         * @brief Accumulates the score differences of two policies or groups of players, see Policy_comparison.
+         *
+         * @param comparison_in The comparison, whose groups must both be non-empty and disjoint.
+         * @return True if the comparison was set, false if it is invalid.
+         */
+        bool set_comparison(const Mahjong::Policy_comparison &comparison_in)
+        {
+            unsigned int players_a = 0, players_b = 0;
+            for (size_t player = 0; player < policies.size(); player++)
+            {
+                players_a |= (unsigned int)comparison_in.is_compared(policies, player, false) << player;
+                players_b |= (unsigned int)comparison_in.is_compared(policies, player, true) << player;
+            }
+            if (players_a == 0 || players_b == 0 || (players_a & players_b) != 0)
+                return false;
+            comparison = comparison_in;
+            compare = true;
+            return true;
+        }
+
+        /**
+         * @brief Stops the games as soon as two policies differ significantly, see Policy_comparison.
+         *
+         * The number of games given to the constructor becomes the maximal number of games.
+         *
+         * @param comparison_in The comparison, see set_comparison.
+         * @return True if the comparison was set, false if it is invalid.
+         */
+        bool set_early_stopping(const Mahjong::Policy_comparison &comparison_in)
+        {
+            if (comparison_in.check_interval == 0 || !(comparison_in.significance > 0 && comparison_in.significance < 1) || !set_comparison(comparison_in))
+                return false;
+            stop_early = true;
+            return true;
+        }
+
+        /**
+         * @brief Adds the outcome of a finished game to the results.
+         *
+         * A won game adds the win and the scores of all players, the winner with mahjong, and a game ending with an
+         * empty set adds the scores of all players without mahjong. With discard_wins_only, the counting of the
+         * original simulation loop is reproduced: self-drawn wins are neither counted nor scored, and a game won
+         * with the last discard is also scored as a drawn game.
+         *
+         * @param game The finished game.
+         * @param results The results to add the outcome of the game to.
+         * @param rotation The rotation of the players over the seats, player i sitting at seat (i + rotation) % N_PLAYERS.
+         * @param discard_wins_only Whether only wins with a claimed discard are counted.
+         * @return The added score per player.
+         */
+        static std::array<long long, 4> add_game_results(Mahjong::Game &game, Simulation_results &results, unsigned int rotation = 0, bool discard_wins_only = false)
+        {
+            std::array<long long, 4> scores = {};
+            int winner = game.get_winner();
+            bool counted_win = winner >= 0 && (!discard_wins_only || game.is_win_by_discard());
+            if (counted_win)
+            {
+                results.player_wins[(winner + N_PLAYERS - rotation) % N_PLAYERS] += 1;
+                for (int i = 0; i < N_PLAYERS; i++)
+                    scores[(i + N_PLAYERS - rotation) % N_PLAYERS] += game.get_player_score(i, true, (i == winner));
+            }
+            if (game.get_set_size() == 0 && (discard_wins_only || !counted_win))
+            {
+                for (int i = 0; i < N_PLAYERS; i++)
+                    scores[(i + N_PLAYERS - rotation) % N_PLAYERS] += game.get_player_score(i, true, false);
+            }
+            for (int i = 0; i < N_PLAYERS; i++)
+            {
+                results.player_scores[i] += scores[i];
+                results.score_stats[i].add(scores[i]);
+            }
+            results.n_games += 1;
+            return scores;
+        }
+
+        /**
+         * @brief Plays a single game from the current state of the given game until it is finished.
+         *
+         * @param game The game to be played, freshly reset and without external players.
+         * @param results The results to add the outcome of the game to (see add_game_results).
+         * @param rotation The rotation of the players over the seats (see add_game_results).
+         * @param discard_wins_only Whether only wins with a claimed discard are counted (see add_game_results).
+         * @return The added score per player.
+         */
+        static std::array<long long, 4> play_game(Mahjong::Game &game, Simulation_results &results, unsigned int rotation = 0, bool discard_wins_only = false)
+        {
+            MAHJONG_TIME_SCOPE(game);
+            game.set_current_player(game.get_rng().bounded(N_PLAYERS));
+            game.advance();
+            return add_game_results(game, results, rotation, discard_wins_only);
+        }
+
+        /**
+         * @brief Plays all games and returns the merged results.
+         *
+         * Each worker accumulates its results locally, the results are merged after all workers finished.
+         * Every game is seeded from the base seed and its index, so the results do not depend on the number
+         * of threads or the order in which the games are played. If MAHJONG_INSTRUMENT is defined, the
+         * instrumentation of all threads is reset before the games and its report is added to the results, so
+         * no other thread may be instrumented concurrently. With early stopping (see set_early_stopping), the games
+         * are played in rounds of check_interval games, the comparison being tested after each round.
+         *
+         * @param progress_interval Print a progress message to std::cerr every this many games (0 disables it).
+         * @return The merged results of all games.
+         */
+        Simulation_results run(unsigned int progress_interval = 0)
+        {
+            if (INSTRUMENTATION_ENABLED)
+                Mahjong::reset_instrumentation();
+            unsigned int n_started = 0;
+            Simulation_results results;
+            if (!stop_early)
+                results = play_games(first_game, n_games, progress_interval, n_started);
+            else
+            {
+                const unsigned int n_tests = (n_games + comparison.check_interval - 1) / comparison.check_interval;
+                for (unsigned int offset = 0; offset < n_games && !results.significant_difference; offset += comparison.check_interval)
+                {
+                    results.merge(play_games(first_game + offset, std::min(comparison.check_interval, n_games - offset), progress_interval, n_started));
+                    results.significant_difference = results.comparison.is_nonzero(comparison.significance / n_tests);
+                }
+            }
+            if (INSTRUMENTATION_ENABLED)
+                results.instrumentation = Mahjong::get_instrumentation_report();
+            return results;
+        }
+    };
+} // namespace Mahjong
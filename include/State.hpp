@@ -5,6 +5,7 @@
 
 #include "Discard_pile.hpp"
 #include "Hand.hpp"
+#include "State_view.hpp"
 #include "Tile.hpp"
 #include "Wind.hpp"
 
@@ -81,10 +82,10 @@ namespace Mahjong
          * @param tile The tile whose occurrences are to be counted.
          * @return The number of occurrences of the specified tile in the game state.
          */
-        unsigned int get_n_tile_occurence(Mahjong::Tile tile)
+        unsigned int get_n_tile_occurence(Mahjong::Tile tile) const
         {
             unsigned int n_occurence = discard_pile.get_n_tile_occurence(tile);
-            for (Mahjong::Hand hand : hands)
+            for (const Mahjong::Hand &hand : hands)
                 n_occurence += hand.get_n_tile_occurence(tile);
             return n_occurence;
         }
@@ -97,7 +98,7 @@ namespace Mahjong
         unsigned int get_n_used_tiles() const
         {
             unsigned int n_used_tiles = discard_pile.get_size();
-            for (Mahjong::Hand hand : hands)
+            for (const Mahjong::Hand &hand : hands)
                 n_used_tiles += hand.get_hand_size();
             return n_used_tiles;
         }
@@ -133,5 +134,20 @@ namespace Mahjong
             }
             return score;
         }
+
+        /**
+         * @brief Creates a read-only view of this state.
+         *
+         * The view refers to the hands and the discard pile of this state, so it must not outlive it.
+         *
+         * @return The view of the state.
+         */
+        Mahjong::State_view get_view() const
+        {
+            std::array<const Mahjong::Hand *, 4> hand_pointers = {};
+            for (size_t index = 0; index < hands.size() && index < hand_pointers.size(); index++)
+                hand_pointers[index] = &hands[index];
+            return Mahjong::State_view(player_number, seat_wind, round_wind, hand_pointers, discard_pile);
+        }
     };
 } // namespace Mahjong
@@ -0,0 +1,301 @@
+/**
+ * @file State_view.hpp
+ * @brief Defines the State_view class, a read-only view of a Mahjong game from the perspective of a single player.
+ */
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <tuple>
+
+#include "Discard_pile.hpp"
+#include "Hand.hpp"
+#include "Tile.hpp"
+#include "Wind.hpp"
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief Read-only view of the game state from the perspective of a single player.
+     *
+     * The view references the live hands and the discard pile instead of copying them. The full hand is only
+     * accessible for the viewing player, the hands of the opponents are restricted to their revealed tiles by
+     * the accessors. A view must not outlive the data it refers to.
+     */
+    class State_view
+    {
+    private:
+        unsigned int player_number;                   ///< The index of the viewing player.
+        Mahjong::Wind seat_wind;                      ///< The seat wind of the viewing player.
+        Mahjong::Wind round_wind;                     ///< The round wind of the current game round.
+        std::array<const Mahjong::Hand *, 4> hands;   ///< The hands of all players.
+        const Mahjong::Discard_pile *discard_pile;    ///< The discard pile.
+        Mahjong::Tile_counts seen_counts;             ///< Number of discarded or revealed tiles per tile kind.
+        unsigned int current_player;                  ///< The index of the player whose turn it is.
+
+        /**
+         * @brief Checks whether the hand of the given player is fully visible to the viewing player.
+         */
+        bool is_own_hand(unsigned int input_player_number) const
+        {
+            return input_player_number == player_number;
+        }
+
+    public:
+        /**
+         * @brief Parameterized constructor for State_view class.
+         *
+         * @param input_player_number The index of the viewing player.
+         * @param input_seat_wind The viewing player's seat wind.
+         * @param input_round_wind The current round wind.
+         * @param input_hands The hands of all players.
+         * @param input_discard_pile The discard pile.
+         * @param input_seen_counts The number of discarded or revealed tiles per tile kind.
+         * @param input_current_player The index of the player whose turn it is, i.e. the discarding player of a pickup.
+         */
+        State_view(unsigned int input_player_number, Mahjong::Wind input_seat_wind, Mahjong::Wind input_round_wind, std::array<const Mahjong::Hand *, 4> input_hands, const Mahjong::Discard_pile &input_discard_pile, const Mahjong::Tile_counts &input_seen_counts, unsigned int input_current_player)
+            : player_number(input_player_number), seat_wind(input_seat_wind), round_wind(input_round_wind), hands(input_hands), discard_pile(&input_discard_pile), seen_counts(input_seen_counts), current_player(input_current_player) {}
+
+        /**
+         * @brief Parameterized constructor for State_view class, counting the discarded and revealed tiles.
+         *
+         * @param input_player_number The index of the viewing player.
+         * @param input_seat_wind The viewing player's seat wind.
+         * @param input_round_wind The current round wind.
+         * @param input_hands The hands of all players.
+         * @param input_discard_pile The discard pile.
+         */
+        State_view(unsigned int input_player_number, Mahjong::Wind input_seat_wind, Mahjong::Wind input_round_wind, std::array<const Mahjong::Hand *, 4> input_hands, const Mahjong::Discard_pile &input_discard_pile)
+            : player_number(input_player_number), seat_wind(input_seat_wind), round_wind(input_round_wind), hands(input_hands), discard_pile(&input_discard_pile), seen_counts(input_discard_pile.get_tile_counts()), current_player(input_player_number)
+        {
+            for (const Mahjong::Hand *hand : hands)
+            {
+                if (hand == nullptr)
+                    continue;
+                for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+                    seen_counts[kind] += hand->get_revealed_counts()[kind];
+            }
+        }
+
+        /**
+         * @brief Retrieves the index of the viewing player.
+         *
+         * @return The index of the viewing player.
+         */
+        unsigned int get_player_number() const
+        {
+            return player_number;
+        }
+
+        /**
+         * @brief Retrieves the index of the player whose turn it is.
+         *
+         * @return The index of the current player, the discarding player while pickups are decided.
+         */
+        unsigned int get_current_player() const
+        {
+            return current_player;
+        }
+
+        /**
+         * @brief Retrieves the seat wind of the viewing player.
+         *
+         * @return The seat wind.
+         */
+        Mahjong::Wind get_seat_wind() const
+        {
+            return seat_wind;
+        }
+
+        /**
+         * @brief Retrieves the round wind.
+         *
+         * @return The round wind.
+         */
+        Mahjong::Wind get_round_wind() const
+        {
+            return round_wind;
+        }
+
+        /**
+         * @brief Retrieves the full hand of the viewing player.
+         *
+         * @return Reference to the hand of the viewing player.
+         */
+        const Mahjong::Hand &get_own_hand() const
+        {
+            return *hands[player_number];
+        }
+
+        /**
+         * @brief Retrieves the discard pile.
+         *
+         * @return Reference to the discard pile.
+         */
+        const Mahjong::Discard_pile &get_discard_pile() const
+        {
+            return *discard_pile;
+        }
+
+        /**
+         * @brief Retrieves the number of tiles in the hand of a player, including the tiles hidden from the viewer.
+         *
+         * @param input_player_number The index of the player.
+         * @return The number of tiles in the player's hand.
+         */
+        unsigned int get_hand_size(unsigned int input_player_number) const
+        {
+            return hands[input_player_number]->get_hand_size();
+        }
+
+        /**
+         * @brief Retrieves the number of tiles of a player's hand visible to the viewing player.
+         *
+         * @param input_player_number The index of the player.
+         * @return The number of visible tiles, all tiles for the viewing player's own hand.
+         */
+        unsigned int get_n_visible_tiles(unsigned int input_player_number) const
+        {
+            const Mahjong::Hand &hand = *hands[input_player_number];
+            if (is_own_hand(input_player_number))
+                return hand.get_hand_size();
+            return hand.get_hand_size() - hand.get_n_hidden_tiles();
+        }
+
+        /**
+         * @brief Counts the occurrences of a tile in a player's hand that are visible to the viewing player.
+         *
+         * @param input_player_number The index of the player.
+         * @param tile The tile whose occurrences are to be counted.
+         * @return The number of visible occurrences, all occurrences for the viewing player's own hand.
+         */
+        unsigned int get_n_visible_tile_occurence(unsigned int input_player_number, Mahjong::Tile tile) const
+        {
+            const Mahjong::Hand &hand = *hands[input_player_number];
+            if (is_own_hand(input_player_number))
+                return hand.get_n_tile_occurence(tile);
+            return hand.get_n_revealed_tile_occurence(tile);
+        }
+
+        /**
+         * @brief Retrieves the revealed tiles of a player's hand per tile kind.
+         *
+         * @param input_player_number The index of the player.
+         * @return The number of revealed tiles per tile kind.
+         */
+        const Mahjong::Tile_counts &get_revealed_counts(unsigned int input_player_number) const
+        {
+            return hands[input_player_number]->get_revealed_counts();
+        }
+
+        /**
+         * @brief Retrieves the number of discarded or revealed tiles per tile kind.
+         *
+         * @return The visible tile counts, not including the hidden tiles of the viewing player.
+         */
+        const Mahjong::Tile_counts &get_seen_counts() const
+        {
+            return seen_counts;
+        }
+
+        /**
+         * @brief Counts the number of occurrences of a tile visible to the viewing player.
+         *
+         * @param tile The tile whose occurrences are to be counted.
+         * @return The number of occurrences of the specified tile in the discard pile and the visible hands.
+         */
+        unsigned int get_n_tile_occurence(Mahjong::Tile tile) const
+        {
+            return seen_counts[tile.get_kind()] + get_own_hand().get_n_hidden_tile_occurence(tile);
+        }
+
+        /**
+         * @brief Counts the tiles of a kind that may still be drawn or claimed from the perspective of the viewing player.
+         *
+         * @param tile The tile whose remaining occurrences are to be counted.
+         * @return The number of occurrences of the specified tile not visible to the viewing player.
+         */
+        unsigned int get_n_live_tiles(Mahjong::Tile tile) const
+        {
+            return 4 - get_n_tile_occurence(tile);
+        }
+
+        /**
+         * @brief Computes the number of live tiles (see get_n_live_tiles) of all tile kinds.
+         *
+         * @return The number of live tiles per tile kind.
+         */
+        Mahjong::Tile_counts get_live_counts() const
+        {
+            Mahjong::Tile_counts live_counts;
+            const Mahjong::Tile_counts &own_hidden_counts = get_own_hand().get_hidden_counts();
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+                live_counts[kind] = 4 - seen_counts[kind] - own_hidden_counts[kind];
+            return live_counts;
+        }
+
+        /**
+         * @brief Calculates the total number of tiles visible to the viewing player.
+         *
+         * @return The number of tiles in the discard pile and the visible hands.
+         */
+        unsigned int get_n_used_tiles() const
+        {
+            unsigned int n_used_tiles = discard_pile->get_size();
+            for (unsigned int index = 0; index < hands.size(); index++)
+                n_used_tiles += get_n_visible_tiles(index);
+            return n_used_tiles;
+        }
+
+        /**
+         * @brief Calculates the total number of tiles not visible to the viewing player.
+         *
+         * @return The number of tiles neither in the discard pile nor in the visible hands.
+         */
+        unsigned int get_n_unused_tiles() const
+        {
+            return 136 - get_n_used_tiles();
+        }
+
+        /**
+         * @brief Calculates the number of undrawn tiles.
+         *
+         * Every tile is either undrawn, in the discard pile or in a hand.
+         *
+         * @return The number of tiles left in the set.
+         */
+        unsigned int get_wall_size() const
+        {
+            unsigned int n_tiles = discard_pile->get_size();
+            for (const Mahjong::Hand *hand : hands)
+                n_tiles += hand->get_hand_size();
+            return 136 - n_tiles;
+        }
+
+        /**
+         * @brief Scores the game state from the perspective of the viewing player.
+         *
+         * The own hand is scored in full, the hands of the opponents by their visible tiles only.
+         *
+         * @return The score of the game state.
+         */
+        int score_state() const
+        {
+            int score = 0;
+            for (unsigned int index = 0; index < hands.size(); index++)
+            {
+                auto scores = is_own_hand(index) ? hands[index]->get_max_score(round_wind, seat_wind) : hands[index]->get_visible_score(round_wind, seat_wind);
+                int player_score = std::get<0>(scores) * pow(2, std::get<1>(scores));
+                if (is_own_hand(index))
+                    score += player_score;
+                else
+                    score -= player_score;
+            }
+            return score;
+        }
+    };
+} // namespace Mahjong
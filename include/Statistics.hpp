@@ -0,0 +1,210 @@
+/**
+ * @file Statistics.hpp
+ * @brief Defines streaming statistics of simulation results: means, variances and confidence intervals.
+ *
+ * Running_stats accumulates the mean and variance of a stream of values with Welford's algorithm, which stays
+ * accurate for long streams, and merges with other accumulators, e.g. of other threads, without keeping the
+ * values. Confidence intervals use the normal approximation, win rates the Wilson score interval, which stays
+ * within [0, 1] and behaves well for rates close to 0 or 1.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief A closed interval of values.
+     */
+    struct Interval
+    {
+        double lower = 0; ///< Lower bound.
+        double upper = 0; ///< Upper bound.
+    };
+
+    /**
+     * @brief Gets the quantile function of the standard normal distribution.
+     *
+     * Uses the rational approximation of Acklam with a relative error below 1.2e-9.
+     *
+     * @param p The probability, in (0, 1).
+     * @return The value z with P(Z <= z) = p for a standard normal Z.
+     */
+    inline double get_normal_quantile(double p)
+    {
+        const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+        const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+        const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+        const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+        const double p_low = 0.02425;
+
+        if (p < p_low)
+        {
+            double q = std::sqrt(-2 * std::log(p));
+            return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        }
+        if (p > 1 - p_low)
+            return -get_normal_quantile(1 - p);
+        double q = p - 0.5;
+        double r = q * q;
+        return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    }
+
+    /**
+     * @brief Gets the critical value of a two-sided interval or test.
+     *
+     * @param confidence The confidence level, e.g. 0.95, i.e. one minus the significance level.
+     * @return The value z with P(|Z| <= z) = confidence for a standard normal Z.
+     */
+    inline double get_critical_value(double confidence)
+    {
+        return get_normal_quantile(0.5 + confidence / 2);
+    }
+
+    /**
+     * @brief Gets the Wilson score interval of a rate, e.g. a win rate.
+     *
+     * @param n_successes Number of successes.
+     * @param n_trials Number of trials.
+     * @param confidence The confidence level, e.g. 0.95.
+     * @return The interval, [0, 1] if there are no trials.
+     */
+    inline Interval get_wilson_interval(std::uint64_t n_successes, std::uint64_t n_trials, double confidence)
+    {
+        if (n_trials == 0)
+            return {0, 1};
+        const double z = get_critical_value(confidence);
+        const double n = static_cast<double>(n_trials);
+        const double rate = n_successes / n;
+        const double center = (rate + z * z / (2 * n)) / (1 + z * z / n);
+        const double half_width = z / (1 + z * z / n) * std::sqrt(rate * (1 - rate) / n + z * z / (4 * n * n));
+        return {(n_successes == 0) ? 0.0 : std::max(0.0, center - half_width), (n_successes == n_trials) ? 1.0 : std::min(1.0, center + half_width)};
+    }
+
+    /**
+     * @class Running_stats
+     * @brief Streaming mean and variance of a sequence of values (Welford's algorithm).
+     */
+    class Running_stats
+    {
+    private:
+        std::uint64_t n = 0; ///< Number of values.
+        double mean = 0;     ///< Mean of the values.
+        double m2 = 0;       ///< Sum of the squared deviations from the mean.
+
+    public:
+        /**
+         * @brief Default constructor for an empty accumulator.
+         */
+        Running_stats() = default;
+
+        /**
+         * @brief Constructor restoring an accumulator from its moments, e.g. read from a file.
+         *
+         * @param n_in Number of values.
+         * @param mean_in Mean of the values.
+         * @param m2_in Sum of the squared deviations from the mean (see get_m2).
+         */
+        Running_stats(std::uint64_t n_in, double mean_in, double m2_in) : n(n_in), mean(mean_in), m2(m2_in) {}
+
+        /**
+         * @brief Adds a value.
+         *
+         * @param value The value.
+         */
+        void add(double value)
+        {
+            n += 1;
+            double delta = value - mean;
+            mean += delta / n;
+            m2 += delta * (value - mean);
+        }
+
+        /**
+         * @brief Adds the values of another accumulator to this one.
+         *
+         * @param other The accumulator to be merged.
+         */
+        void merge(const Running_stats &other)
+        {
+            if (other.n == 0)
+                return;
+            std::uint64_t n_total = n + other.n;
+            double delta = other.mean - mean;
+            mean += delta * other.n / n_total;
+            m2 += other.m2 + delta * delta * (static_cast<double>(n) * other.n / n_total);
+            n = n_total;
+        }
+
+        /**
+         * @brief Gets the number of values.
+         */
+        std::uint64_t get_n() const
+        {
+            return n;
+        }
+
+        /**
+         * @brief Gets the mean of the values, 0 if there are none.
+         */
+        double get_mean() const
+        {
+            return mean;
+        }
+
+        /**
+         * @brief Gets the sum of the squared deviations of the values from their mean.
+         */
+        double get_m2() const
+        {
+            return m2;
+        }
+
+        /**
+         * @brief Gets the sample variance of the values, 0 if there are fewer than two.
+         */
+        double get_variance() const
+        {
+            return (n > 1) ? m2 / (n - 1) : 0.0;
+        }
+
+        /**
+         * @brief Gets the standard error of the mean, 0 if there are fewer than two values.
+         */
+        double get_standard_error() const
+        {
+            return (n > 1) ? std::sqrt(get_variance() / n) : 0.0;
+        }
+
+        /**
+         * @brief Gets the confidence interval of the mean (normal approximation).
+         *
+         * @param confidence The confidence level, e.g. 0.95.
+         * @return The interval.
+         */
+        Interval get_confidence_interval(double confidence) const
+        {
+            double half_width = get_critical_value(confidence) * get_standard_error();
+            return {mean - half_width, mean + half_width};
+        }
+
+        /**
+         * @brief Checks whether the mean differs from zero at the given significance level (two-sided z-test).
+         *
+         * @param significance The significance level, e.g. 0.05.
+         * @return True if there are at least two values, not all equal, and zero is outside the confidence
+         * interval of level 1 - significance.
+         */
+        bool is_nonzero(double significance) const
+        {
+            double standard_error = get_standard_error();
+            return standard_error > 0 && std::abs(mean) > get_critical_value(1 - significance) * standard_error;
+        }
+    };
+} // namespace Mahjong
@@ -4,13 +4,23 @@
  */
 
 #pragma once
+#include <array>
 #include <string>
+#include <string_view>
+
+#include "Random.hpp"
 
 /** @brief String names for the ranks of the tiles with Dragon suit. */
-std::string DRAGONS[3] = {"Red", "Green", "White"};
+inline constexpr std::array<std::string_view, 3> DRAGONS = {"Red", "Green", "White"};
 
 /** @brief String names for the ranks of the tiles with Wind suit. */
-std::string WINDS[4] = {"East", "South", "West", "North"};
+inline constexpr std::array<std::string_view, 4> WINDS = {"East", "South", "West", "North"};
+
+/** @brief String names for the suits of the tiles. */
+inline constexpr std::array<std::string_view, 5> SUITS = {"Circles", "Bamboos", "Characters", "Winds", "Dragons"};
+
+/** @brief Number of distinct tile kinds (nine ranks for each of the three ground suits, four winds and three dragons). */
+const unsigned int N_TILE_KINDS = 34;
 
 /**
  * @namespace Mahjong
@@ -18,37 +28,116 @@ std::string WINDS[4] = {"East", "South", "West", "North"};
  */
 namespace Mahjong
 {
+    /** @brief Number of tiles per tile kind (see Tile::get_kind). */
+    using Tile_counts = std::array<unsigned char, N_TILE_KINDS>;
 
-    /*
-    Class for tiles. Each tile consits of a suit and a rank. The number of available ranks depends on the given suit.
-    */
+
+    /**
+     * @brief Get the kind of a tile (see Tile::get_kind) from its suit and rank.
+     *
+     * @param suit The suit of the tile.
+     * @param rank The rank of the tile.
+     * @return The index of the tile kind.
+     */
+    constexpr unsigned int get_kind(int suit, int rank)
+    {
+        return (suit < 4) ? suit * 9 + rank : 31 + rank;
+    }
+
+    /** @brief Suit and rank of each tile kind, looked up by get_kind_suit and get_kind_rank. */
+    inline constexpr std::array<std::array<signed char, 2>, N_TILE_KINDS> KIND_SUITS_AND_RANKS = []()
+    {
+        std::array<std::array<signed char, 2>, N_TILE_KINDS> suits_and_ranks{};
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            int suit = (kind < 31) ? kind / 9 : 4;
+            suits_and_ranks[kind] = {static_cast<signed char>(suit), static_cast<signed char>((suit < 4) ? kind - 9 * suit : kind - 31)};
+        }
+        return suits_and_ranks;
+    }();
+
+    /**
+     * @brief Get the suit of a tile kind.
+     *
+     * @param kind The index of the tile kind.
+     * @return The suit of the kind.
+     */
+    constexpr int get_kind_suit(unsigned int kind)
+    {
+        return KIND_SUITS_AND_RANKS[kind][0];
+    }
+
+    /**
+     * @brief Get the rank of a tile kind.
+     *
+     * @param kind The index of the tile kind.
+     * @return The rank of the kind within its suit.
+     */
+    constexpr int get_kind_rank(unsigned int kind)
+    {
+        return KIND_SUITS_AND_RANKS[kind][1];
+    }
+
+    /**
+     * @class Tile
+     * @brief A single tile, stored as one byte holding its kind and whether it is hidden.
+     *
+     * The suit and rank of the original interface are derived from the kind. Hands, walls and discard piles thus
+     * store one byte per tile.
+     */
     class Tile
     {
     private:
-        int suit;           /**< The suit of the tile. */
-        int rank;           /**< The rank of the tile. */
-        bool hidden = true; /**< Flag indicating whether the tile is hidden or visible. */
+        static constexpr unsigned char HIDDEN_BIT = 0x80; /**< The bit of the id flagging a hidden tile. */
+        static constexpr unsigned char KIND_MASK = 0x3f;  /**< The bits of the id holding the tile kind. */
+
+        unsigned char id = HIDDEN_BIT; /**< The tile kind and the hidden bit. */
+
+        /** @brief Tag selecting the constructor from a packed id. */
+        struct Packed_id
+        {
+            unsigned char id; /**< The tile kind, possibly combined with HIDDEN_BIT. */
+        };
+
+        /**
+         * @brief Constructor from a packed id.
+         *
+         * @param packed_id The packed id.
+         */
+        explicit constexpr Tile(Packed_id packed_id) : id(packed_id.id) {}
 
     public:
         /**
          * @brief Default constructor for Tile.
          *
+         * Initializes the tile with the lowest suit and rank.
+         */
+        constexpr Tile() = default;
+
+        /**
+         * @brief Constructor for a random Tile.
+         *
          * Initializes the tile with a random suit and rank, ensuring proper distribution based on the suit.
+         *
+         * @param rng The random number generator to draw the suit and rank from.
          */
-        Tile() : suit(std::rand() % 5)
+        explicit Tile(Mahjong::Rng &rng)
         {
+            int suit = rng.bounded(5);
+            int rank;
             if (suit == 3)
             {
-                rank = std::rand() % 4;
+                rank = rng.bounded(4);
             }
             else if (suit == 4)
             {
-                rank = std::rand() % 3;
+                rank = rng.bounded(3);
             }
             else
             {
-                rank = std::rand() % 9 + 1;
+                rank = rng.bounded(9);
             }
+            id = HIDDEN_BIT | Mahjong::get_kind(suit, rank);
         }
 
         /**
@@ -58,33 +147,86 @@ namespace Mahjong
          * @param rank_in Int of the desired rank
          * @return Tile with the provided suit and rank
          */
-        Tile(int suit_in, int rank_in) : suit(suit_in), rank(rank_in) {}
+        constexpr Tile(int suit_in, int rank_in) : id(HIDDEN_BIT | Mahjong::get_kind(suit_in, rank_in)) {}
+
+        /**
+         * @brief Creates a hidden tile of the given kind (see get_kind).
+         *
+         * @param kind The index of the tile kind.
+         * @return The tile with the suit and rank of the kind.
+         */
+        static constexpr Tile from_kind(unsigned int kind)
+        {
+            return Tile(Packed_id{static_cast<unsigned char>(HIDDEN_BIT | kind)});
+        }
+
+        /**
+         * @brief Creates a tile from its packed id (see get_id).
+         *
+         * @param id_in The packed id.
+         * @return The tile with the kind and visibility of the id.
+         */
+        static constexpr Tile from_id(unsigned char id_in)
+        {
+            return Tile(Packed_id{id_in});
+        }
+
+        /**
+         * @brief Get the packed id of the tile, its kind combined with a bit flagging hidden tiles.
+         * @return The packed id.
+         */
+        constexpr unsigned char get_id() const
+        {
+            return id;
+        }
 
         /**
          * @brief Get the rank of the tile.
          * @return The rank of the tile.
          */
-        int get_rank() const
+        constexpr int get_rank() const
         {
-            return rank;
+            return Mahjong::get_kind_rank(get_kind());
         }
 
         /**
          * @brief Get the suit of the tile.
          * @return The suit of the tile.
          */
-        int get_suit() const
+        constexpr int get_suit() const
         {
-            return suit;
+            return Mahjong::get_kind_suit(get_kind());
+        }
+
+        /**
+         * @brief Get the kind of the tile, i.e. a unique index in [0, N_TILE_KINDS) for each suit and rank.
+         *
+         * Ground suits occupy the indices 0 to 26 (suit * 9 + rank), winds 27 to 30 and dragons 31 to 33.
+         * The visibility of the tile is ignored.
+         *
+         * @return The index of the tile kind.
+         */
+        constexpr unsigned int get_kind() const
+        {
+            return id & KIND_MASK;
         }
 
         /**
          * @brief Check if the tile is hidden.
          * @return True if the tile is hidden, false if it's visible.
          */
-        bool is_hidden() const
+        constexpr bool is_hidden() const
         {
-            return hidden;
+            return (id & HIDDEN_BIT) != 0;
+        }
+
+        /**
+         * @brief Get the name of the tile's suit.
+         * @return The name of the suit.
+         */
+        constexpr std::string_view get_suit_name() const
+        {
+            return SUITS[get_suit()];
         }
 
         /**
@@ -93,32 +235,17 @@ namespace Mahjong
          */
         std::string get_tile_as_string() const
         {
-            std::string suit_string, rank_string;
-
-            switch (suit)
-            {
-            case 0:
-                suit_string = "Circles";
-                rank_string = std::to_string(rank);
-                break;
-            case 1:
-                suit_string = "Bamboos";
-                rank_string = std::to_string(rank);
-                break;
-            case 2:
-                suit_string = "Characters";
-                rank_string = std::to_string(rank);
-                break;
-            case 3:
-                suit_string = "Winds";
-                rank_string = WINDS[rank];
-                break;
-            case 4:
-                suit_string = "Dragons";
-                rank_string = DRAGONS[rank];
-                break;
-            }
-            return suit_string + " " + rank_string;
+            std::string tile_string(get_suit_name());
+            tile_string += ' ';
+            const int suit = get_suit();
+            const int rank = get_rank();
+            if (suit == 3)
+                tile_string += WINDS[rank];
+            else if (suit == 4)
+                tile_string += DRAGONS[rank];
+            else
+                tile_string += static_cast<char>('0' + rank);
+            return tile_string;
         }
 
         /**
@@ -127,51 +254,30 @@ namespace Mahjong
          */
         std::string get_tile_as_string_with_visibility() const
         {
-            std::string suit_string, rank_string;
-
-            switch (suit)
-            {
-            case 0:
-                suit_string = "Circles";
-                rank_string = std::to_string(rank);
-                break;
-            case 1:
-                suit_string = "Bamboos";
-                rank_string = std::to_string(rank);
-                break;
-            case 2:
-                suit_string = "Characters";
-                rank_string = std::to_string(rank);
-                break;
-            case 3:
-                suit_string = "Winds";
-                rank_string = WINDS[rank];
-                break;
-            case 4:
-                suit_string = "Dragons";
-                rank_string = DRAGONS[rank];
-                break;
-            }
-            std::string hidden_flag = (hidden) ? " (Hidden)" : " (Open)";
-            return suit_string + " " + rank_string + hidden_flag;
+            return get_tile_as_string() + (is_hidden() ? " (Hidden)" : " (Open)");
         }
 
         /**
          * @brief Equality operator for comparing two tiles.
+         *
+         * The visibility of the tiles is ignored.
+         *
          * @param other The other tile to compare.
          * @return True if the tiles are equal, false otherwise.
          */
-        bool operator==(const Tile &other) const
+        constexpr bool operator==(const Tile &other) const
         {
-            return (suit == other.suit) && (rank == other.rank);
+            return ((id ^ other.id) & KIND_MASK) == 0;
         }
 
         /**
          * @brief Set the visibility of the tile to open.
          */
-        void set_visible()
+        constexpr void set_visible()
         {
-            hidden = false;
+            id &= KIND_MASK;
         }
     };
+
+    static_assert(sizeof(Tile) == 1, "Tiles are stored as a single byte");
 } // namespace Mahjong
@@ -0,0 +1,557 @@
+/**
+ * @file Tournament.hpp
+ * @brief Defines round-robin tournaments between policy entries, split into independent seed-sharded work units.
+ *
+ * A tournament spec lists entries, i.e. policies with parameter settings, and expands into one matchup per pair
+ * of entries, each entry of a matchup playing two opposite seats. The games of a matchup are split into shards of
+ * consecutive game indices, every game being seeded from the matchup and its index only. A work unit plays one
+ * shard and writes its statistics to a shard file, so units can run in any order, on any node and be repeated
+ * after a failure with identical results. Merging the shard files of all units gives the standings.
+ *
+ * The spec is a text file with one setting per line, `#` starting a comment:
+ *
+ *     seed 42                 # base seed of all games
+ *     games 20000             # games per matchup, deals if duplicate
+ *     shard_games 1000        # games per work unit
+ *     duplicate true          # play every deal once per rotation (see Simulation_runner::set_duplicate)
+ *     entry tc tile_count chow_rate=0.2,0.5,0.8
+ *     entry shanten shanten randomness=1
+ *     entry random random
+ *     challenger shanten      # only matchups of shanten, all pairs without challenger lines
+ *
+ * An entry with several values of a parameter expands into one entry per combination, named e.g.
+ * `tc/chow_rate=0.2`.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Action.hpp"
+#include "Game_record.hpp"
+#include "Random.hpp"
+#include "Simulation_runner.hpp"
+#include "Statistics.hpp"
+
+/** @brief Version of the shard file format, written to its first line. */
+const unsigned int TOURNAMENT_SHARD_VERSION = 1;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @brief A participant of a tournament: a policy with parameter settings.
+     */
+    struct Tournament_entry
+    {
+        std::string name;                      ///< Unique name of the entry.
+        std::string base_name;                 ///< Name of the spec line the entry was expanded from.
+        Mahjong::Policy_type policy;           ///< The policy.
+        Mahjong::Policy_parameters parameters; ///< The parameters of the policy.
+    };
+
+    /**
+     * @brief Settings and entries of a tournament.
+     */
+    struct Tournament_spec
+    {
+        std::uint64_t seed = 0;                      ///< Base seed of all games.
+        unsigned int n_games = 10000;                ///< Games per matchup, deals if duplicate.
+        unsigned int shard_games = 1000;             ///< Games per work unit, deals if duplicate.
+        bool duplicate = false;                      ///< Whether every deal is played once per rotation of the seats.
+        std::vector<Mahjong::Tournament_entry> entries; ///< The entries.
+        std::vector<std::string> challengers;        ///< Base names of the entries all matchups must include, empty for all pairs.
+    };
+
+    /**
+     * @brief A work unit: consecutive games of one matchup.
+     */
+    struct Tournament_unit
+    {
+        unsigned int entry_a;    ///< Entry playing seats 0 and 2.
+        unsigned int entry_b;    ///< Entry playing seats 1 and 3.
+        unsigned int shard;      ///< Index of the shard within the matchup.
+        unsigned int first_game; ///< Index of the first game of the shard.
+        unsigned int n_games;    ///< Number of games of the shard.
+        std::uint64_t seed;      ///< Seed of the matchup, derived from the base seed and the names of the entries.
+    };
+
+    /**
+     * @brief Statistics of one or several shards of a matchup.
+     */
+    struct Tournament_shard
+    {
+        std::uint64_t n_games = 0;      ///< Number of games played.
+        std::uint64_t wins_a = 0;       ///< Wins of entry_a.
+        std::uint64_t wins_b = 0;       ///< Wins of entry_b.
+        Mahjong::Running_stats scores_a; ///< Final scores per game and seat of entry_a.
+        Mahjong::Running_stats scores_b; ///< Final scores per game and seat of entry_b.
+        Mahjong::Running_stats difference; ///< Average score of entry_a minus the one of entry_b, per game resp. deal.
+
+        /**
+         * @brief Adds the statistics of another shard of the same matchup.
+         *
+         * @param other The shard to be merged.
+         */
+        void merge(const Tournament_shard &other)
+        {
+            n_games += other.n_games;
+            wins_a += other.wins_a;
+            wins_b += other.wins_b;
+            scores_a.merge(other.scores_a);
+            scores_b.merge(other.scores_b);
+            difference.merge(other.difference);
+        }
+    };
+
+    /**
+     * @brief Standing of an entry over all of its matchups.
+     */
+    struct Tournament_standing
+    {
+        unsigned int entry = 0;          ///< The entry.
+        unsigned int n_matchups = 0;     ///< Number of matchups with results.
+        std::uint64_t n_games = 0;       ///< Number of games played.
+        std::uint64_t n_wins = 0;        ///< Number of wins over both seats.
+        Mahjong::Running_stats scores;   ///< Final scores per game and seat.
+        double average_difference = 0;   ///< Average over the matchups of the mean score difference to the opponent.
+    };
+
+    /**
+     * @brief Gets a hash of a name, used to derive the seeds of matchups.
+     *
+     * @param name The name.
+     * @return The hash.
+     */
+    inline std::uint64_t get_name_hash(const std::string &name)
+    {
+        std::uint64_t hash = name.size();
+        for (unsigned char character : name)
+            hash = Mahjong::derive_seed(hash, character);
+        return hash;
+    }
+
+    /**
+     * @brief Parses a comma separated list of parameter values.
+     *
+     * @param text The list.
+     * @param values Receives the values.
+     * @return True if all values are numbers, false otherwise.
+     */
+    inline bool parse_parameter_values(const std::string &text, std::vector<float> &values)
+    {
+        values.clear();
+        std::istringstream input(text);
+        std::string item;
+        while (std::getline(input, item, ','))
+        {
+            std::istringstream item_input(item);
+            float value;
+            if (!(item_input >> value) || !(item_input >> std::ws).eof())
+                return false;
+            values.push_back(value);
+        }
+        return !values.empty();
+    }
+
+    /**
+     * @brief Formats a parameter value with the fewest digits reading back as the same value.
+     *
+     * @param value The value.
+     * @return The text.
+     */
+    inline std::string format_parameter_value(float value)
+    {
+        std::string text;
+        for (int precision = 1; precision <= 9; precision++)
+        {
+            std::ostringstream output;
+            output << std::setprecision(precision) << value;
+            text = output.str();
+            if (std::stof(text) == value)
+                break;
+        }
+        return text;
+    }
+
+    /**
+     * @brief Parses a tournament spec (see the file comment of Tournament.hpp), expanding its parameter grids.
+     *
+     * @param input The spec.
+     * @param spec Receives the parsed spec.
+     * @param error Receives a description of the first error.
+     * @return True if the spec is valid, false otherwise.
+     */
+    inline bool parse_tournament_spec(std::istream &input, Tournament_spec &spec, std::string &error)
+    {
+        spec = Tournament_spec();
+        std::string line;
+        for (unsigned int line_number = 1; std::getline(input, line); line_number++)
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream words(line);
+            std::string key;
+            if (!(words >> key))
+                continue;
+            const std::string location = "line " + std::to_string(line_number) + ": ";
+
+            std::string value;
+            if (key == "seed" || key == "games" || key == "shard_games" || key == "duplicate")
+            {
+                unsigned long long number = 0;
+                bool valid = static_cast<bool>(words >> value);
+                if (valid && key == "duplicate")
+                    valid = (value == "true" || value == "false");
+                else if (valid)
+                {
+                    std::istringstream number_input(value);
+                    valid = (number_input >> number) && number_input.eof();
+                }
+                if (!valid || (words >> value))
+                {
+                    error = location + "invalid value of " + key;
+                    return false;
+                }
+                if (key == "seed")
+                    spec.seed = number;
+                else if (key == "games")
+                    spec.n_games = number;
+                else if (key == "shard_games")
+                    spec.shard_games = number;
+                else
+                    spec.duplicate = (value == "true");
+            }
+            else if (key == "challenger")
+            {
+                if (!(words >> value))
+                {
+                    error = location + "missing challenger name";
+                    return false;
+                }
+                spec.challengers.push_back(value);
+            }
+            else if (key == "entry")
+            {
+                std::string base_name, policy_name;
+                Mahjong::Policy_type policy;
+                if (!(words >> base_name >> policy_name) || !Mahjong::parse_policy_type(policy_name, policy) || policy == Mahjong::Policy_type::human)
+                {
+                    error = location + "an entry needs a name and a policy other than human";
+                    return false;
+                }
+
+                std::vector<float> randomness = {Mahjong::Policy_parameters().randomness};
+                std::vector<float> chow_rate = {Mahjong::Policy_parameters().chow_rate};
+                while (words >> value)
+                {
+                    size_t separator = value.find('=');
+                    std::string parameter = value.substr(0, separator);
+                    std::vector<float> *values = (parameter == "randomness") ? &randomness : (parameter == "chow_rate") ? &chow_rate : nullptr;
+                    if (separator == std::string::npos || values == nullptr || !parse_parameter_values(value.substr(separator + 1), *values))
+                    {
+                        error = location + "invalid parameter " + value;
+                        return false;
+                    }
+                }
+
+                for (float entry_randomness : randomness)
+                {
+                    for (float entry_chow_rate : chow_rate)
+                    {
+                        Tournament_entry entry;
+                        entry.base_name = base_name;
+                        entry.name = base_name;
+                        if (randomness.size() > 1)
+                            entry.name += "/randomness=" + format_parameter_value(entry_randomness);
+                        if (chow_rate.size() > 1)
+                            entry.name += "/chow_rate=" + format_parameter_value(entry_chow_rate);
+                        entry.policy = policy;
+                        entry.parameters.randomness = entry_randomness;
+                        entry.parameters.chow_rate = entry_chow_rate;
+                        spec.entries.push_back(entry);
+                    }
+                }
+            }
+            else
+            {
+                error = location + "unknown setting " + key;
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < spec.entries.size(); i++)
+        {
+            for (size_t j = 0; j < i; j++)
+            {
+                if (spec.entries[i].name == spec.entries[j].name)
+                {
+                    error = "duplicate entry " + spec.entries[i].name;
+                    return false;
+                }
+            }
+        }
+        for (const std::string &challenger : spec.challengers)
+        {
+            if (std::none_of(spec.entries.begin(), spec.entries.end(), [&](const Tournament_entry &entry)
+                             { return entry.base_name == challenger; }))
+            {
+                error = "unknown challenger " + challenger;
+                return false;
+            }
+        }
+        if (spec.entries.size() < 2 || spec.n_games == 0 || spec.shard_games == 0)
+        {
+            error = "a tournament needs at least two entries and a positive number of games per matchup and shard";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads and parses a tournament spec file.
+     *
+     * @param path The path of the spec.
+     * @param spec Receives the parsed spec.
+     * @param error Receives a description of the first error.
+     * @return True if the spec is valid, false otherwise.
+     */
+    inline bool read_tournament_spec(const std::string &path, Tournament_spec &spec, std::string &error)
+    {
+        std::ifstream input(path);
+        if (!input)
+        {
+            error = "could not open " + path;
+            return false;
+        }
+        return parse_tournament_spec(input, spec, error);
+    }
+
+    /**
+     * @brief Expands a spec into its work units, ordered by matchup and shard.
+     *
+     * The units only depend on the spec, so every node computes the same list.
+     *
+     * @param spec The spec.
+     * @return The work units.
+     */
+    inline std::vector<Tournament_unit> get_tournament_units(const Tournament_spec &spec)
+    {
+        auto is_challenger = [&](unsigned int entry)
+        {
+            return std::find(spec.challengers.begin(), spec.challengers.end(), spec.entries[entry].base_name) != spec.challengers.end();
+        };
+
+        std::vector<Tournament_unit> units;
+        for (unsigned int a = 0; a < spec.entries.size(); a++)
+        {
+            for (unsigned int b = a + 1; b < spec.entries.size(); b++)
+            {
+                if (!spec.challengers.empty() && !is_challenger(a) && !is_challenger(b))
+                    continue;
+                std::uint64_t seed = Mahjong::derive_seed(spec.seed, get_name_hash(spec.entries[a].name + "\n" + spec.entries[b].name));
+                for (unsigned int first_game = 0, shard = 0; first_game < spec.n_games; first_game += spec.shard_games, shard++)
+                    units.push_back({a, b, shard, first_game, std::min(spec.shard_games, spec.n_games - first_game), seed});
+            }
+        }
+        return units;
+    }
+
+    /**
+     * @brief Gets the description of everything determining the games of a unit, which identifies its shard file.
+     *
+     * @param spec The spec.
+     * @param unit The unit.
+     * @return The description as a single line.
+     */
+    inline std::string get_tournament_unit_key(const Tournament_spec &spec, const Tournament_unit &unit)
+    {
+        std::ostringstream key;
+        key << "seed " << unit.seed << " duplicate " << spec.duplicate << " first_game " << unit.first_game << " games " << unit.n_games;
+        for (unsigned int entry : {unit.entry_a, unit.entry_b})
+        {
+            const Tournament_entry &participant = spec.entries[entry];
+            key << " entry " << participant.name << " " << Mahjong::to_string(participant.policy) << " " << format_parameter_value(participant.parameters.randomness)
+                << " " << format_parameter_value(participant.parameters.chow_rate);
+        }
+        return key.str();
+    }
+
+    /**
+     * @brief Gets the path of a file of a unit, named by a hash of its key so that it stays valid if other
+     * entries are added to the spec.
+     *
+     * @param spec The spec.
+     * @param unit The unit.
+     * @param directory The directory of the shard files.
+     * @param extension The extension of the file, e.g. ".shard" or ".rec".
+     * @return The path.
+     */
+    inline std::string get_tournament_unit_path(const Tournament_spec &spec, const Tournament_unit &unit, const std::string &directory, const std::string &extension)
+    {
+        std::ostringstream path;
+        path << directory << "/unit-" << std::hex << std::setw(16) << std::setfill('0') << get_name_hash(get_tournament_unit_key(spec, unit)) << extension;
+        return path.str();
+    }
+
+    /**
+     * @brief Plays the games of a unit.
+     *
+     * With a single thread, the games are accumulated in the order of their indices, so the statistics are
+     * identical on every run. With several threads, the order of merging the statistics of the threads and with
+     * it the last digits of the means and variances depend on the scheduling.
+     *
+     * @param spec The spec.
+     * @param unit The unit.
+     * @param n_threads Number of worker threads.
+     * @param record_file File receiving the records of the games, nullptr if not recorded.
+     * @return The statistics of the games.
+     */
+    inline Tournament_shard play_tournament_unit(const Tournament_spec &spec, const Tournament_unit &unit, unsigned int n_threads, Mahjong::Game_record_file *record_file = nullptr)
+    {
+        const Tournament_entry &entry_a = spec.entries[unit.entry_a];
+        const Tournament_entry &entry_b = spec.entries[unit.entry_b];
+        Mahjong::Simulation_runner runner(unit.n_games, n_threads, {entry_a.policy, entry_b.policy, entry_a.policy, entry_b.policy}, unit.seed);
+        for (unsigned int player = 0; player < N_PLAYERS; player++)
+            runner.set_policy_parameters(player, (player % 2 == 0) ? entry_a.parameters : entry_b.parameters);
+        runner.set_first_game(unit.first_game);
+        runner.set_duplicate(spec.duplicate);
+        runner.set_record_file(record_file);
+        Mahjong::Policy_comparison comparison;
+        comparison.players_a = 0b0101;
+        comparison.players_b = 0b1010;
+        runner.set_comparison(comparison);
+        Mahjong::Simulation_results results = runner.run();
+
+        Tournament_shard shard;
+        shard.n_games = results.n_games;
+        shard.wins_a = results.player_wins[0] + results.player_wins[2];
+        shard.wins_b = results.player_wins[1] + results.player_wins[3];
+        shard.scores_a = results.score_stats[0];
+        shard.scores_a.merge(results.score_stats[2]);
+        shard.scores_b = results.score_stats[1];
+        shard.scores_b.merge(results.score_stats[3]);
+        shard.difference = results.comparison;
+        return shard;
+    }
+
+    /**
+     * @brief Writes the statistics of a unit as a shard file, via a temporary file renamed once it is complete.
+     *
+     * @param path The path of the shard file.
+     * @param key The key of the unit (see get_tournament_unit_key).
+     * @param shard The statistics.
+     * @return True if the file was written, false otherwise.
+     */
+    inline bool write_tournament_shard(const std::string &path, const std::string &key, const Tournament_shard &shard)
+    {
+        const std::string temporary_path = path + ".tmp";
+        {
+            std::ofstream output(temporary_path, std::ios::trunc);
+            output << std::setprecision(17) << "mahjong-tournament-shard " << TOURNAMENT_SHARD_VERSION << "\n"
+                   << key << "\n"
+                   << shard.n_games << " " << shard.wins_a << " " << shard.wins_b << "\n";
+            for (const Running_stats *stats : {&shard.scores_a, &shard.scores_b, &shard.difference})
+                output << stats->get_n() << " " << stats->get_mean() << " " << stats->get_m2() << "\n";
+            output << "end\n";
+            output.close();
+            if (output.fail())
+                return false;
+        }
+        return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+    }
+
+    /**
+     * @brief Reads a shard file written by write_tournament_shard.
+     *
+     * @param path The path of the shard file.
+     * @param key The key of the expected unit (see get_tournament_unit_key).
+     * @param shard Receives the statistics.
+     * @return True if the file exists, is complete and belongs to the unit, false otherwise.
+     */
+    inline bool read_tournament_shard(const std::string &path, const std::string &key, Tournament_shard &shard)
+    {
+        std::ifstream input(path);
+        std::string magic, file_key, end;
+        unsigned int version = 0;
+        if (!(input >> magic >> version) || magic != "mahjong-tournament-shard" || version != TOURNAMENT_SHARD_VERSION)
+            return false;
+        input >> std::ws;
+        if (!std::getline(input, file_key) || file_key != key)
+            return false;
+        if (!(input >> shard.n_games >> shard.wins_a >> shard.wins_b))
+            return false;
+        for (Running_stats *stats : {&shard.scores_a, &shard.scores_b, &shard.difference})
+        {
+            std::uint64_t n;
+            double mean, m2;
+            if (!(input >> n >> mean >> m2))
+                return false;
+            *stats = Running_stats(n, mean, m2);
+        }
+        return (input >> end) && end == "end";
+    }
+
+    /**
+     * @brief Gets the standings of the entries from the merged shards of their matchups.
+     *
+     * @param spec The spec.
+     * @param units The units of the matchups.
+     * @param shards The statistics per unit; only units with has_shard set are counted.
+     * @param has_shard Whether the statistics of a unit are available.
+     * @return The standings, ordered by decreasing average score difference.
+     */
+    inline std::vector<Tournament_standing> get_tournament_standings(const Tournament_spec &spec, const std::vector<Tournament_unit> &units,
+                                                                     const std::vector<Tournament_shard> &shards, const std::vector<bool> &has_shard)
+    {
+        std::vector<Tournament_standing> standings(spec.entries.size());
+        for (unsigned int entry = 0; entry < standings.size(); entry++)
+            standings[entry].entry = entry;
+
+        for (size_t begin = 0; begin < units.size();)
+        {
+            size_t end = begin;
+            Tournament_shard matchup;
+            for (; end < units.size() && units[end].entry_a == units[begin].entry_a && units[end].entry_b == units[begin].entry_b; end++)
+            {
+                if (has_shard[end])
+                    matchup.merge(shards[end]);
+            }
+            if (matchup.n_games > 0)
+            {
+                Tournament_standing &a = standings[units[begin].entry_a];
+                Tournament_standing &b = standings[units[begin].entry_b];
+                a.n_matchups += 1;
+                b.n_matchups += 1;
+                a.n_games += matchup.n_games;
+                b.n_games += matchup.n_games;
+                a.n_wins += matchup.wins_a;
+                b.n_wins += matchup.wins_b;
+                a.scores.merge(matchup.scores_a);
+                b.scores.merge(matchup.scores_b);
+                a.average_difference += matchup.difference.get_mean();
+                b.average_difference -= matchup.difference.get_mean();
+            }
+            begin = end;
+        }
+
+        for (Tournament_standing &standing : standings)
+        {
+            if (standing.n_matchups > 0)
+                standing.average_difference /= standing.n_matchups;
+        }
+        std::stable_sort(standings.begin(), standings.end(), [](const Tournament_standing &a, const Tournament_standing &b)
+                         { return a.average_difference > b.average_difference; });
+        return standings;
+    }
+} // namespace Mahjong
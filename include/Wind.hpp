@@ -4,10 +4,12 @@
  */
 
 #pragma once
+#include <array>
 #include <string>
+#include <string_view>
 
-/** @brief String names for the ranks of the tiles with Wind suit. */
-std::string WIND_STRING[4] = {"East", "South", "West", "North"};
+/** @brief String names of the winds. */
+inline constexpr std::array<std::string_view, 4> WIND_STRING = {"East", "South", "West", "North"};
 
 /**
  * @namespace Mahjong
@@ -52,7 +54,7 @@ namespace Mahjong
          */
         std::string get_wind_as_string() const
         {
-            return WIND_STRING[wind];
+            return std::string(WIND_STRING[wind]);
         }
 
         /**
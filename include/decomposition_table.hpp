@@ -0,0 +1,295 @@
+/**
+ * @file decomposition_table.hpp
+ * @brief Lookup tables deciding whether tile count patterns decompose into complete Mahjong combinations.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Instrumentation.hpp"
+#include "Tile.hpp"
+
+/** @brief Number of ranks in a ground suit (circles, bamboos or characters). */
+const unsigned int N_SUIT_RANKS = 9;
+
+/** @brief Number of distinct count patterns of a ground suit, i.e. five possible counts (0 to 4) for each rank. */
+const unsigned int N_SUIT_PATTERNS = 1953125;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /**
+     * @class Decomposition_table
+     * @brief Precomputed decompositions of all count patterns of a single ground suit.
+     *
+     * A suit pattern is encoded as the base-5 number formed by the counts of its nine ranks. For every pattern
+     * with at most 14 tiles the table stores which decompositions into combinations are possible:
+     *
+     * - Bits 0 to 10 mark the achievable values of (number of pairs - number of kongs) + 3, if the tiles are split
+     *   into pairs, chows, pongs and kongs. This is used for hidden tiles.
+     * - Bits 11 to 14 mark the achievable numbers of kongs (0 to 3), if the tiles are split into chows, pongs and
+     *   kongs only. This is used for revealed tiles, as pairs must consist of hidden tiles.
+     *
+     * A hand of 14 tiles covered by exactly five combinations always satisfies (pairs - kongs) == 1, which is why
+     * this difference is sufficient to decide whether a hand is complete.
+     */
+    class Decomposition_table
+    {
+    private:
+        std::vector<std::uint16_t> masks; /**< Decomposition masks indexed by suit pattern. */
+
+    public:
+        /** @brief Offset of the (pairs - kongs) value in the hidden part of the mask. */
+        static const int DELTA_OFFSET = 3;
+
+        /** @brief Bit mask selecting the hidden part of a mask. */
+        static const std::uint16_t HIDDEN_BITS = 0x07ff;
+
+        /** @brief First bit of the revealed part of a mask. */
+        static const int REVEALED_SHIFT = 11;
+
+        /** @brief Powers of five used to encode suit patterns. */
+        static constexpr std::array<std::uint32_t, N_SUIT_RANKS> POWERS = {1, 5, 25, 125, 625, 3125, 15625, 78125, 390625};
+
+        /**
+         * @brief Constructor: Computes the masks of all suit patterns with at most 14 tiles.
+         *
+         * Patterns are processed in increasing order, such that each pattern can be derived from the patterns
+         * obtained by removing a combination containing its lowest rank.
+         */
+        Decomposition_table() : masks(N_SUIT_PATTERNS, 0)
+        {
+            masks[0] = (1 << DELTA_OFFSET) | (1 << REVEALED_SHIFT);
+
+            for (std::uint32_t key = 1; key < N_SUIT_PATTERNS; key++)
+            {
+                std::array<unsigned int, N_SUIT_RANKS> counts;
+                unsigned int n_tiles = 0;
+                std::uint32_t remainder = key;
+                for (unsigned int rank = 0; rank < N_SUIT_RANKS; rank++)
+                {
+                    counts[rank] = remainder % 5;
+                    remainder /= 5;
+                    n_tiles += counts[rank];
+                }
+                if (n_tiles > 14)
+                    continue;
+
+                unsigned int lowest = 0;
+                while (counts[lowest] == 0)
+                    lowest++;
+
+                unsigned int hidden = 0;
+                unsigned int revealed = 0;
+
+                // Pair
+                if (counts[lowest] >= 2)
+                {
+                    std::uint16_t sub = masks[key - 2 * POWERS[lowest]];
+                    hidden |= (sub & HIDDEN_BITS) << 1;
+                }
+
+                // Pong
+                if (counts[lowest] >= 3)
+                {
+                    std::uint16_t sub = masks[key - 3 * POWERS[lowest]];
+                    hidden |= sub & HIDDEN_BITS;
+                    revealed |= sub >> REVEALED_SHIFT;
+                }
+
+                // Kong
+                if (counts[lowest] == 4)
+                {
+                    std::uint16_t sub = masks[key - 4 * POWERS[lowest]];
+                    hidden |= (sub & HIDDEN_BITS) >> 1;
+                    revealed |= (sub >> REVEALED_SHIFT) << 1;
+                }
+
+                // Chow
+                if (lowest + 2 < N_SUIT_RANKS && counts[lowest + 1] > 0 && counts[lowest + 2] > 0)
+                {
+                    std::uint16_t sub = masks[key - POWERS[lowest] - POWERS[lowest + 1] - POWERS[lowest + 2]];
+                    hidden |= sub & HIDDEN_BITS;
+                    revealed |= sub >> REVEALED_SHIFT;
+                }
+
+                masks[key] = static_cast<std::uint16_t>((hidden & HIDDEN_BITS) | ((revealed & 0xf) << REVEALED_SHIFT));
+            }
+        }
+
+        /**
+         * @brief Gets the decomposition mask of the given suit pattern.
+         * @param key Base-5 encoded suit pattern.
+         * @return The decomposition mask of the pattern.
+         */
+        std::uint16_t get_mask(std::uint32_t key) const
+        {
+            return masks[key];
+        }
+
+        /**
+         * @brief Gets the shared table instance, computing it on first use.
+         * @return Reference to the table.
+         */
+        static const Decomposition_table &get_instance()
+        {
+            static const Decomposition_table table;
+            return table;
+        }
+    };
+
+    /**
+     * @brief Encodes the counts of a ground suit as base-5 key for the decomposition table.
+     *
+     * @param counts Tile counts per tile kind (see Tile::get_kind).
+     * @param suit The ground suit (0 to 2).
+     * @return The base-5 encoded suit pattern.
+     */
+    inline std::uint32_t get_suit_key(const std::array<unsigned char, N_TILE_KINDS> &counts, unsigned int suit)
+    {
+        std::uint32_t key = 0;
+        for (unsigned int rank = 0; rank < N_SUIT_RANKS; rank++)
+            key += counts[suit * N_SUIT_RANKS + rank] * Decomposition_table::POWERS[rank];
+        return key;
+    }
+
+    /**
+     * @brief Gets the decomposition mask (see Decomposition_table) of a single wind or dragon kind.
+     *
+     * Honours can't form chows, so only pairs, pongs and kongs have to be considered.
+     *
+     * @param count Number of tiles of the kind.
+     * @return The decomposition mask.
+     */
+    inline std::uint16_t get_honour_mask(unsigned int count)
+    {
+        static const std::uint16_t HONOUR_MASKS[5] = {
+            (1 << 3) | (1 << 11),            // Nothing to cover
+            0,                               // Single tiles can't be covered
+            (1 << 4),                        // Pair
+            (1 << 3) | (1 << 11),            // Pong
+            (1 << 2) | (1 << 5) | (1 << 12), // Kong or two pairs
+        };
+        return HONOUR_MASKS[count];
+    }
+
+    /**
+     * @brief Computes the achievable values of (pairs - kongs) resp. numbers of kongs for a whole count histogram.
+     *
+     * The results are returned as bit masks, where bit 16 + n of the hidden mask marks that (pairs - kongs) == n is
+     * achievable and bit n of the revealed mask marks that n kongs are achievable.
+     *
+     * @param counts Tile counts per tile kind.
+     * @param revealed If true, decompositions without pairs are considered (revealed tiles).
+     * @return Bit mask of achievable values, 0 if the tiles can't be covered.
+     */
+    inline std::uint64_t get_decomposition_values(const std::array<unsigned char, N_TILE_KINDS> &counts, bool revealed)
+    {
+        const Decomposition_table &table = Decomposition_table::get_instance();
+        std::uint64_t values = revealed ? 1 : (std::uint64_t(1) << 16);
+
+        for (unsigned int group = 0; group < 3 + 7 && values != 0; group++)
+        {
+            MAHJONG_COUNT(decomposition_lookups);
+            std::uint16_t mask = (group < 3) ? table.get_mask(get_suit_key(counts, group)) : get_honour_mask(counts[27 + group - 3]);
+            std::uint64_t group_values = revealed ? (mask >> Decomposition_table::REVEALED_SHIFT) : (mask & Decomposition_table::HIDDEN_BITS);
+
+            std::uint64_t combined = 0;
+            for (int bit = 0; group_values != 0; bit++, group_values >>= 1)
+            {
+                if ((group_values & 1) == 0)
+                    continue;
+                if (revealed)
+                    combined |= values << bit;
+                else
+                    combined |= (values << bit) >> Decomposition_table::DELTA_OFFSET;
+            }
+            values = combined;
+        }
+        return values;
+    }
+
+    /**
+     * @brief Checks whether a hand of 14 tiles given by its counts is a winning hand.
+     *
+     * A hand is winning if it can be covered by exactly five combinations, where pairs consist of hidden tiles,
+     * chows and pongs consist of tiles with the same visibility and kongs may mix hidden and revealed tiles.
+     * The check only uses table lookups and does not allocate memory.
+     *
+     * @param hidden_counts Number of hidden tiles per tile kind.
+     * @param revealed_counts Number of revealed tiles per tile kind.
+     * @return True if the hand is a winning hand, false otherwise.
+     */
+    inline bool is_complete_hand(std::array<unsigned char, N_TILE_KINDS> hidden_counts, std::array<unsigned char, N_TILE_KINDS> revealed_counts)
+    {
+        MAHJONG_COUNT(winning_hand_checks);
+        unsigned int n_tiles = 0;
+        unsigned int mixed_kinds[N_TILE_KINDS];
+        unsigned int n_mixed = 0;
+        for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+        {
+            n_tiles += hidden_counts[kind] + revealed_counts[kind];
+            if (hidden_counts[kind] > 0 && revealed_counts[kind] > 0 && hidden_counts[kind] + revealed_counts[kind] == 4)
+                mixed_kinds[n_mixed++] = kind;
+        }
+        if (n_tiles != 14)
+        {
+            MAHJONG_COUNT(winning_hand_wrong_tile_count);
+            return false;
+        }
+
+        // The rejection reason of the last tried selection is counted.
+        Mahjong::Counter rejection = Mahjong::Counter::winning_hand_no_pair;
+
+        // Kinds with hidden and revealed tiles may form a kong spanning both visibilities, try all options.
+        for (unsigned int selection = 0; selection < (1u << n_mixed); selection++)
+        {
+            std::array<unsigned char, N_TILE_KINDS> hidden = hidden_counts;
+            std::array<unsigned char, N_TILE_KINDS> revealed = revealed_counts;
+            unsigned int n_mixed_kongs = 0;
+            for (unsigned int i = 0; i < n_mixed; i++)
+            {
+                if (selection & (1u << i))
+                {
+                    hidden[mixed_kinds[i]] = 0;
+                    revealed[mixed_kinds[i]] = 0;
+                    n_mixed_kongs++;
+                }
+            }
+
+            std::uint64_t revealed_values = get_decomposition_values(revealed, true);
+            if (revealed_values == 0)
+            {
+                rejection = Mahjong::Counter::winning_hand_no_revealed_decomposition;
+                continue;
+            }
+            std::uint64_t hidden_values = get_decomposition_values(hidden, false);
+            if (hidden_values == 0)
+            {
+                rejection = Mahjong::Counter::winning_hand_no_hidden_decomposition;
+                continue;
+            }
+            rejection = Mahjong::Counter::winning_hand_no_pair;
+
+            // Require (pairs - kongs) == 1 over all combinations.
+            for (unsigned int n_kongs = 0; n_kongs < 8; n_kongs++)
+            {
+                if ((revealed_values & (std::uint64_t(1) << n_kongs)) && (hidden_values & (std::uint64_t(1) << (16 + 1 + n_kongs + n_mixed_kongs))))
+                {
+                    MAHJONG_COUNT(winning_hands);
+                    return true;
+                }
+            }
+        }
+#ifdef MAHJONG_INSTRUMENT
+        ++Mahjong::get_thread_instrumentation().get_count(rejection);
+#else
+        (void)rejection;
+#endif
+        return false;
+    }
+} // namespace Mahjong
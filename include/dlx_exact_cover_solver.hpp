@@ -7,6 +7,8 @@
 #include <set>
 #include <vector>
 
+#include "Instrumentation.hpp"
+
 // Define maximum number of rows and columns in the problem matrix
 #define MAX_ROW 100
 #define MAX_COL 100
@@ -253,17 +255,14 @@ namespace DLX
          */
         Node *get_min_column()
         {
-            struct Node *h = header;
-            struct Node *min_col = h->right;
-            h = h->right->right;
-            do
+            struct Node *min_col = header->right;
+            for (struct Node *h = min_col->right; h != header; h = h->right)
             {
                 if (h->node_count < min_col->node_count)
                 {
                     min_col = h;
                 }
-                h = h->right;
-            } while (h != header);
+            }
 
             return min_col;
         }
@@ -306,10 +305,13 @@ namespace DLX
             struct Node *left_node;
             struct Node *column;
 
+            MAHJONG_COUNT(dlx_nodes_visited);
+
             // if no column left, then we must
             // have found the solution
             if (header->right == header)
             {
+                MAHJONG_COUNT(dlx_covers_found);
                 // print_solution();
                 add_solution();
                 return;
@@ -362,6 +364,12 @@ namespace DLX
             n_col = 14;
             n_row = sets.size() + 1;
 
+            // Reset the node counts of the column headers.
+            for (int j = 0; j < n_col; j++)
+            {
+                matrix[0][j].node_count = 0;
+            }
+
             // Initialize the problem matrix with headers 1.
             for (int i = 0; i <= n_row; i++)
             {
@@ -392,4 +400,249 @@ namespace DLX
             return solutions_vector;
         }
     };
+    /**
+     * @class reusable_exact_cover_solver
+     * @brief Variant of exact_cover_solver whose nodes are allocated from a reusable arena sized to the problem.
+     *
+     * Rows are added with add_row() after a reset(). The linked matrix is only built when searching, using
+     * exactly one node per element of the problem (plus one header per column). The arena keeps its capacity
+     * across reset() calls, such that a single instance (e.g. one per thread) solves many small problems without
+     * further allocations. Covers are reported to a callback, which can stop the search early.
+     */
+    class reusable_exact_cover_solver
+    {
+    private:
+        std::vector<Node> nodes;            /**< Arena holding the root, the column headers and all row nodes. */
+        std::vector<int> row_columns;       /**< Column indices of all rows, stored consecutively. */
+        std::vector<int> row_offsets;       /**< Offset of each row in row_columns, plus one past the last row. */
+        std::vector<int> solution_rows;     /**< Rows (0-indexed) of the partial solution during the search. */
+        int n_col = 0;                      /**< Number of columns in the problem. */
+        unsigned long long n_visited = 0;   /**< Number of search nodes visited during the last search. */
+
+        /**
+         * @brief Covers the given column.
+         * @param col_node Column header to be covered.
+         */
+        void cover(Node *col_node)
+        {
+            col_node->left->right = col_node->right;
+            col_node->right->left = col_node->left;
+
+            for (Node *row = col_node->down; row != col_node; row = row->down)
+            {
+                for (Node *right_node = row->right; right_node != row; right_node = right_node->right)
+                {
+                    right_node->up->down = right_node->down;
+                    right_node->down->up = right_node->up;
+                    right_node->column->node_count -= 1;
+                }
+            }
+        }
+
+        /**
+         * @brief Uncovers the given column.
+         * @param col_node Column header to be uncovered.
+         */
+        void uncover(Node *col_node)
+        {
+            for (Node *row = col_node->up; row != col_node; row = row->up)
+            {
+                for (Node *left_node = row->left; left_node != row; left_node = left_node->left)
+                {
+                    left_node->up->down = left_node;
+                    left_node->down->up = left_node;
+                    left_node->column->node_count += 1;
+                }
+            }
+
+            col_node->left->right = col_node;
+            col_node->right->left = col_node;
+        }
+
+        /**
+         * @brief Links the arena nodes according to the added rows.
+         */
+        void build()
+        {
+            nodes.resize(1 + n_col + row_columns.size());
+
+            // Link the column headers in a ring with the root
+            for (int j = 0; j <= n_col; j++)
+            {
+                Node &node = nodes[j];
+                node.left = &nodes[(j == 0) ? n_col : j - 1];
+                node.right = &nodes[(j == n_col) ? 0 : j + 1];
+                node.up = &node;
+                node.down = &node;
+                node.column = &node;
+                node.row_id = -1;
+                node.col_id = j - 1;
+                node.node_count = 0;
+            }
+
+            // Append the nodes of each row at the bottom of their columns
+            for (int row = 0; row + 1 < row_offsets.size(); row++)
+            {
+                Node *first = nullptr;
+                for (int offset = row_offsets[row]; offset < row_offsets[row + 1]; offset++)
+                {
+                    Node *node = &nodes[1 + n_col + offset];
+                    Node *column = &nodes[1 + row_columns[offset]];
+
+                    node->column = column;
+                    node->row_id = row;
+                    node->col_id = row_columns[offset];
+                    node->down = column;
+                    node->up = column->up;
+                    column->up->down = node;
+                    column->up = node;
+                    column->node_count += 1;
+
+                    if (first == nullptr)
+                    {
+                        first = node;
+                        node->left = node;
+                        node->right = node;
+                    }
+                    else
+                    {
+                        node->right = first;
+                        node->left = first->left;
+                        first->left->right = node;
+                        first->left = node;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Searches for exact covers recursively.
+         * @param on_cover Callback receiving the rows of each cover, returning true to stop the search.
+         * @return True if the search was stopped by the callback.
+         */
+        template <class Callback>
+        bool search(Callback &on_cover)
+        {
+            n_visited += 1;
+            MAHJONG_COUNT(dlx_nodes_visited);
+            Node *root = &nodes[0];
+
+            // If no column is left, a cover has been found
+            if (root->right == root)
+            {
+                MAHJONG_COUNT(dlx_covers_found);
+                return on_cover(static_cast<const std::vector<int> &>(solution_rows));
+            }
+
+            // Choose the column with the fewest nodes
+            Node *column = root->right;
+            for (Node *h = column->right; h != root; h = h->right)
+            {
+                if (h->node_count < column->node_count)
+                    column = h;
+            }
+
+            if (column->node_count == 0)
+                return false;
+
+            cover(column);
+
+            bool stop = false;
+            for (Node *row_node = column->down; row_node != column && !stop; row_node = row_node->down)
+            {
+                solution_rows.push_back(row_node->row_id);
+                for (Node *right_node = row_node->right; right_node != row_node; right_node = right_node->right)
+                    cover(right_node->column);
+
+                stop = search(on_cover);
+
+                solution_rows.pop_back();
+                for (Node *left_node = row_node->left; left_node != row_node; left_node = left_node->left)
+                    uncover(left_node->column);
+            }
+
+            uncover(column);
+            return stop;
+        }
+
+    public:
+        /**
+         * @brief Removes all rows and sets the number of columns of the next problem, keeping allocated memory.
+         * @param n_columns Number of columns of the next problem.
+         */
+        void reset(int n_columns = N_COLUMNS)
+        {
+            n_col = n_columns;
+            row_columns.clear();
+            row_offsets.clear();
+            row_offsets.push_back(0);
+            solution_rows.clear();
+        }
+
+        /**
+         * @brief Adds a row to the problem.
+         * @param columns The columns covered by the row, each in [0, n_columns).
+         */
+        template <class Container>
+        void add_row(const Container &columns)
+        {
+            if (row_offsets.empty())
+                row_offsets.push_back(0);
+            for (int column : columns)
+                row_columns.push_back(column);
+            row_offsets.push_back(row_columns.size());
+        }
+
+        /**
+         * @brief Enumerates the exact covers of the current problem.
+         *
+         * The callback is invoked with the (0-indexed) rows of each cover, in the order they were chosen,
+         * and returns true to stop the search.
+         *
+         * @param on_cover Callback invoked for each cover.
+         * @return True if the callback stopped the search, false if all covers were enumerated.
+         */
+        template <class Callback>
+        bool for_each_cover(Callback on_cover)
+        {
+            n_visited = 0;
+            solution_rows.clear();
+            if (n_col == 0)
+            {
+                MAHJONG_COUNT(dlx_covers_found);
+                return on_cover(static_cast<const std::vector<int> &>(solution_rows));
+            }
+            build();
+            return search(on_cover);
+        }
+
+        /**
+         * @brief Finds all exact covers for the given sets.
+         * @param sets Vector of sets representing the problem.
+         * @param n_columns Number of columns of the problem.
+         * @return Vector of sets representing unique solutions.
+         */
+        std::vector<std::set<int>> find_exact_covers(const std::vector<std::set<int>> &sets, int n_columns = N_COLUMNS)
+        {
+            reset(n_columns);
+            for (const std::set<int> &set : sets)
+                add_row(set);
+
+            std::vector<std::set<int>> covers;
+            for_each_cover([&covers](const std::vector<int> &rows)
+                           {
+                               covers.push_back(std::set<int>(rows.begin(), rows.end()));
+                               return false; });
+            return covers;
+        }
+
+        /**
+         * @brief Gets the number of search nodes visited during the last search.
+         * @return Number of visited search nodes.
+         */
+        unsigned long long get_n_visited() const
+        {
+            return n_visited;
+        }
+    };
 }
\ No newline at end of file
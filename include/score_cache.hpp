@@ -0,0 +1,289 @@
+/**
+ * @file score_cache.hpp
+ * @brief Defines the Score_cache class memoizing maximum hand scores by a Zobrist-style hand hash and the Score_memo
+ *        table used by the maximum score search.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Random.hpp"
+#include "Tile.hpp"
+#include "score_table.hpp"
+
+/** @brief Number of entries of the per-thread score cache, must be a power of two. */
+const unsigned int SCORE_CACHE_SIZE = 4096;
+
+/**
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
+ */
+namespace Mahjong
+{
+    /** @brief Zobrist keys indexed by visibility (0 = revealed, 1 = hidden), tile kind and count (0 to 4). */
+    using Zobrist_keys = std::array<std::array<std::array<std::uint64_t, 5>, N_TILE_KINDS>, 2>;
+
+    /**
+     * @brief Builds the Zobrist keys of all tile counts.
+     *
+     * The key of a count of zero is zero, such that the hash of an empty hand is zero as well.
+     *
+     * @return The Zobrist keys.
+     */
+    constexpr Zobrist_keys make_zobrist_keys()
+    {
+        Zobrist_keys keys{};
+        for (unsigned int hidden = 0; hidden < 2; hidden++)
+            for (unsigned int kind = 0; kind < N_TILE_KINDS; kind++)
+                for (unsigned int count = 1; count < 5; count++)
+                    keys[hidden][kind][count] = mix_seed((hidden << 16) | (kind << 8) | count);
+        return keys;
+    }
+
+    /** @brief The Zobrist keys, computed at compile time. */
+    inline constexpr Zobrist_keys ZOBRIST_KEYS = make_zobrist_keys();
+
+    /**
+     * @brief Gets the hash update for changing the count of a tile kind by one.
+     *
+     * XOR-ing the result into a hand hash replaces the key of the old count by the key of the new count.
+     *
+     * @param hidden Whether the count of hidden (true) or revealed (false) tiles changes.
+     * @param kind The tile kind (see Tile::get_kind).
+     * @param old_count The count before the change.
+     * @param new_count The count after the change.
+     * @return The hash update.
+     */
+    constexpr std::uint64_t get_count_hash_update(bool hidden, unsigned int kind, unsigned int old_count, unsigned int new_count)
+    {
+        return ZOBRIST_KEYS[hidden][kind][old_count] ^ ZOBRIST_KEYS[hidden][kind][new_count];
+    }
+
+    /**
+     * @brief Gets the Zobrist key of a combination of round and seat wind.
+     *
+     * @param round_wind The round wind (0 to 3).
+     * @param seat_wind The seat wind (0 to 3).
+     * @return The key of the winds.
+     */
+    constexpr std::uint64_t get_wind_hash(unsigned int round_wind, unsigned int seat_wind)
+    {
+        return mix_seed((std::uint64_t(1) << 32) | (round_wind << 2) | seat_wind);
+    }
+
+    /**
+     * @class Score_memo
+     * @brief Open addressing hash table memoizing the partial results of the maximum score search of a single hand.
+     *
+     * Clearing the table only increments a generation counter, so the table can be reused for every search
+     * without touching or reallocating its entries.
+     */
+    class Score_memo
+    {
+    private:
+        /**
+         * @brief A single table entry.
+         */
+        struct Entry
+        {
+            std::uint64_t key = 0;        ///< The key of the entry.
+            Combination_score score{};    ///< The memoized score.
+            std::uint32_t generation = 0; ///< The generation the entry was written in, entries of older generations are empty.
+        };
+
+        std::vector<Entry> entries;     ///< The table entries, the size is a power of two.
+        std::uint32_t generation = 1;   ///< The current generation.
+        std::size_t n_entries = 0;      ///< The number of entries of the current generation.
+
+        /**
+         * @brief Gets the slot of a key, i.e. the slot holding the key or the empty slot it would be inserted at.
+         */
+        std::size_t find_slot(std::uint64_t key) const
+        {
+            std::size_t mask = entries.size() - 1;
+            std::size_t slot = mix_seed(key) & mask;
+            while (entries[slot].generation == generation && entries[slot].key != key)
+                slot = (slot + 1) & mask;
+            return slot;
+        }
+
+        /**
+         * @brief Doubles the size of the table, keeping the entries of the current generation.
+         */
+        void grow()
+        {
+            std::vector<Entry> old_entries(entries.size() * 2);
+            old_entries.swap(entries);
+            for (const Entry &entry : old_entries)
+            {
+                if (entry.generation == generation)
+                    entries[find_slot(entry.key)] = entry;
+            }
+        }
+
+    public:
+        /**
+         * @brief Constructor for the Score_memo class.
+         */
+        Score_memo() : entries(1024) {}
+
+        /**
+         * @brief Removes all entries.
+         */
+        void clear()
+        {
+            generation += 1;
+            n_entries = 0;
+            if (generation == 0)
+            {
+                entries.assign(entries.size(), Entry());
+                generation = 1;
+            }
+        }
+
+        /**
+         * @brief Looks up a memoized score.
+         *
+         * @param key The key of the partial search.
+         * @param score Receives the memoized score if the key is found.
+         * @return True if the key was found, false otherwise.
+         */
+        bool find(std::uint64_t key, Combination_score &score) const
+        {
+            const Entry &entry = entries[find_slot(key)];
+            if (entry.generation != generation)
+                return false;
+            score = entry.score;
+            return true;
+        }
+
+        /**
+         * @brief Memoizes a score.
+         *
+         * @param key The key of the partial search, must not be memoized yet.
+         * @param score The score to be memoized.
+         */
+        void insert(std::uint64_t key, Combination_score score)
+        {
+            if (2 * (n_entries + 1) > entries.size())
+                grow();
+            entries[find_slot(key)] = Entry{key, score, generation};
+            n_entries += 1;
+        }
+
+        /**
+         * @brief Gets the memo of the calling thread.
+         * @return Reference to the thread's memo.
+         */
+        static Score_memo &get_instance()
+        {
+            thread_local Score_memo memo;
+            return memo;
+        }
+    };
+
+    /**
+     * @class Score_cache
+     * @brief Bounded, direct-mapped cache of maximum hand scores.
+     *
+     * Entries are keyed by the hash of the hidden and revealed tile counts of a hand combined with the round and
+     * seat winds. Colliding entries simply replace each other. Each thread owns its own cache (see get_instance),
+     * so no synchronization is required.
+     */
+    class Score_cache
+    {
+    private:
+        /**
+         * @brief A single cache entry.
+         */
+        struct Entry
+        {
+            std::uint64_t key = 0;     ///< The full key of the cached hand.
+            Combination_score score{}; ///< The maximum score and multiplier of the cached hand.
+            bool valid = false;        ///< Whether the entry holds a cached score.
+        };
+
+        std::vector<Entry> entries; ///< The cache entries, indexed by the low bits of the key.
+        std::uint64_t n_hits = 0;   ///< Number of successful lookups.
+        std::uint64_t n_misses = 0; ///< Number of failed lookups.
+
+    public:
+        /**
+         * @brief Constructor for the Score_cache class.
+         */
+        Score_cache() : entries(SCORE_CACHE_SIZE) {}
+
+        /**
+         * @brief Looks up the score of a hand.
+         *
+         * @param key The key of the hand.
+         * @param score Receives the cached score if the lookup succeeds.
+         * @return True if the score was found, false otherwise.
+         */
+        bool find(std::uint64_t key, Combination_score &score)
+        {
+            const Entry &entry = entries[key & (SCORE_CACHE_SIZE - 1)];
+            if (entry.valid && entry.key == key)
+            {
+                score = entry.score;
+                n_hits += 1;
+                return true;
+            }
+            n_misses += 1;
+            return false;
+        }
+
+        /**
+         * @brief Stores the score of a hand, replacing any entry with the same slot.
+         *
+         * @param key The key of the hand.
+         * @param score The score of the hand.
+         */
+        void insert(std::uint64_t key, Combination_score score)
+        {
+            Entry &entry = entries[key & (SCORE_CACHE_SIZE - 1)];
+            entry.key = key;
+            entry.score = score;
+            entry.valid = true;
+        }
+
+        /**
+         * @brief Removes all entries and resets the counters.
+         */
+        void clear()
+        {
+            entries.assign(SCORE_CACHE_SIZE, Entry());
+            n_hits = 0;
+            n_misses = 0;
+        }
+
+        /**
+         * @brief Gets the number of successful lookups.
+         * @return The number of cache hits.
+         */
+        std::uint64_t get_n_hits() const
+        {
+            return n_hits;
+        }
+
+        /**
+         * @brief Gets the number of failed lookups.
+         * @return The number of cache misses.
+         */
+        std::uint64_t get_n_misses() const
+        {
+            return n_misses;
+        }
+
+        /**
+         * @brief Gets the cache of the calling thread.
+         * @return Reference to the thread's cache.
+         */
+        static Score_cache &get_instance()
+        {
+            thread_local Score_cache cache;
+            return cache;
+        }
+    };
+} // namespace Mahjong
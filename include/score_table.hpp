@@ -1,118 +1,164 @@
+/**
+ * @file score_table.hpp
+ * @brief Compile-time lookup table of the scores of single combinations.
+ */
 #pragma once
-#include <iostream>
-#include <unordered_map>
-#include <tuple>
+#include <array>
+
+/** @brief Number of combination types (pair, chow, pong and kong). */
+const unsigned int N_COMBINATION_TYPES = 4;
+
+/** @brief Number of suits (circles, bamboos, characters, winds and dragons). */
+const unsigned int N_SUITS = 5;
+
+/** @brief Number of visibility states of a combination (see get_combination_score). */
+const unsigned int N_VISIBILITIES = 3;
+
+/** @brief Number of wind matches of a combination (matching neither, one or both of the round and seat winds). */
+const unsigned int N_WIND_MATCHES = 3;
 
 /**
- * @brief Custom hash function for tuple.
+ * @namespace Mahjong
+ * @brief Namespace for Mahjong-related classes and functions.
  */
-struct TupleHash
+namespace Mahjong
 {
     /**
-     * @brief Hashes a tuple.
-     * @tparam Tuple Type of the tuple.
-     * @param t The tuple to hash.
-     * @return Hash value.
+     * @brief Score of a single combination and its multiplier as a power of two.
      */
-    template <class Tuple>
-    std::size_t operator()(const Tuple &t) const
+    struct Combination_score
     {
-        // Using a combination of the hash values of the tuple elements
-        return std::hash<typename std::tuple_element<0, Tuple>::type>{}(std::get<0>(t)) ^
-               std::hash<typename std::tuple_element<1, Tuple>::type>{}(std::get<1>(t)) ^
-               std::hash<typename std::tuple_element<2, Tuple>::type>{}(std::get<2>(t));
+        int score;      ///< The score of the combination.
+        int multiplier; ///< The number of times the total score is doubled.
+    };
+
+    /**
+     * @brief Computes the position of a combination in the score table.
+     *
+     * @param type The combination type (0 = pair, 1 = chow, 2 = pong, 3 = kong).
+     * @param suit The suit of the corresponding tiles (0 to 4).
+     * @param visibility Whether the tiles are hidden (1) or not (0), 2 for kongs that are partially open.
+     * @param wind The number of matches of a wind type combination with the seat and round winds.
+     * @return The index of the combination in the score table.
+     */
+    constexpr unsigned int get_score_index(unsigned int type, unsigned int suit, unsigned int visibility, unsigned int wind)
+    {
+        return ((type * N_SUITS + suit) * N_VISIBILITIES + visibility) * N_WIND_MATCHES + wind;
     }
-};
 
-/**
- * @namespace Mahjong
- * @brief Namespace for Mahjong-related classes and functions.
- */
-namespace Mahjong
-{
+    /** @brief Dense score table, indexed by get_score_index. */
+    using Score_table = std::array<Combination_score, N_COMBINATION_TYPES * N_SUITS * N_VISIBILITIES * N_WIND_MATCHES>;
 
     /**
-     * @brief Declaration of the lookup table with custom hash function.
+     * @brief Sets the score of a single combination in the score table.
+     */
+    constexpr void set_table_score(Score_table &table, unsigned int type, unsigned int suit, unsigned int visibility, unsigned int wind, int score, int multiplier)
+    {
+        table[get_score_index(type, suit, visibility, wind)] = Combination_score{score, multiplier};
+    }
+
+    /**
+     * @brief Builds the score table.
      *
-     * The keys represent the combination type (0 = pair, 1 = chow, 2 = pong, 3 = kong),
-     * the suit of the corresponding tiles (0 to 4),  whether the tiles are hidden (1) or not (0), and if a
-     * wind type combination matches the seat or round winds.
      * The values represent the score of the given combination as well as it's multiplyer as a power of two.
+     * Combinations without an explicit entry score nothing.
      *
+     * @return The score table.
      */
-    std::unordered_map<std::tuple<int, int, int, int>, std::tuple<int, int>, TupleHash> score_table;
-
-    void initialize_score_table()
+    constexpr Score_table make_score_table()
     {
+        Score_table table{};
         // Set scores for pairs
-        score_table[{0, 0, 1, 0}] = {0, 0};
-        score_table[{0, 1, 1, 0}] = {0, 0};
-        score_table[{0, 2, 1, 0}] = {0, 0};
-        score_table[{0, 3, 1, 0}] = {2, 0};
-        score_table[{0, 4, 1, 0}] = {2, 0};
+        set_table_score(table, 0, 0, 1, 0, 0, 0);
+        set_table_score(table, 0, 1, 1, 0, 0, 0);
+        set_table_score(table, 0, 2, 1, 0, 0, 0);
+        set_table_score(table, 0, 3, 1, 0, 2, 0);
+        set_table_score(table, 0, 4, 1, 0, 2, 0);
 
         // Set scores for chows
-        score_table[{1, 0, 0, 0}] = {0, 0};
-        score_table[{1, 0, 1, 0}] = {0, 0};
+        set_table_score(table, 1, 0, 0, 0, 0, 0);
+        set_table_score(table, 1, 0, 1, 0, 0, 0);
 
-        score_table[{1, 1, 0, 0}] = {0, 0};
-        score_table[{1, 1, 1, 0}] = {0, 0};
+        set_table_score(table, 1, 1, 0, 0, 0, 0);
+        set_table_score(table, 1, 1, 1, 0, 0, 0);
 
-        score_table[{1, 2, 0, 0}] = {0, 0};
-        score_table[{1, 2, 1, 0}] = {0, 0};
+        set_table_score(table, 1, 2, 0, 0, 0, 0);
+        set_table_score(table, 1, 2, 1, 0, 0, 0);
 
-        score_table[{1, 3, 0, 0}] = {0, 0};
-        score_table[{1, 3, 1, 0}] = {0, 0};
+        set_table_score(table, 1, 3, 0, 0, 0, 0);
+        set_table_score(table, 1, 3, 1, 0, 0, 0);
 
-        score_table[{1, 4, 0, 0}] = {0, 0};
-        score_table[{1, 4, 1, 0}] = {0, 0};
+        set_table_score(table, 1, 4, 0, 0, 0, 0);
+        set_table_score(table, 1, 4, 1, 0, 0, 0);
 
         // Set scores for pongs
-        score_table[{2, 0, 0, 0}] = {4, 0};
-        score_table[{2, 0, 1, 0}] = {8, 0};
+        set_table_score(table, 2, 0, 0, 0, 4, 0);
+        set_table_score(table, 2, 0, 1, 0, 8, 0);
 
-        score_table[{2, 1, 0, 0}] = {4, 0};
-        score_table[{2, 1, 1, 0}] = {8, 0};
+        set_table_score(table, 2, 1, 0, 0, 4, 0);
+        set_table_score(table, 2, 1, 1, 0, 8, 0);
 
-        score_table[{2, 2, 0, 0}] = {4, 0};
-        score_table[{2, 2, 1, 0}] = {8, 0};
+        set_table_score(table, 2, 2, 0, 0, 4, 0);
+        set_table_score(table, 2, 2, 1, 0, 8, 0);
 
-        score_table[{2, 3, 0, 0}] = {8, 1};
-        score_table[{2, 3, 1, 0}] = {16, 1};
-        score_table[{2, 3, 0, 1}] = {8, 2};
-        score_table[{2, 3, 1, 1}] = {16, 2};
-        score_table[{2, 3, 0, 2}] = {8, 3};
-        score_table[{2, 3, 1, 2}] = {16, 3};
+        set_table_score(table, 2, 3, 0, 0, 8, 1);
+        set_table_score(table, 2, 3, 1, 0, 16, 1);
+        set_table_score(table, 2, 3, 0, 1, 8, 2);
+        set_table_score(table, 2, 3, 1, 1, 16, 2);
+        set_table_score(table, 2, 3, 0, 2, 8, 3);
+        set_table_score(table, 2, 3, 1, 2, 16, 3);
 
-        score_table[{2, 4, 0, 0}] = {8, 1};
-        score_table[{2, 4, 1, 0}] = {16, 1};
+        set_table_score(table, 2, 4, 0, 0, 8, 1);
+        set_table_score(table, 2, 4, 1, 0, 16, 1);
 
         // Set scores for kongs (a visibility of 2 mans that it is partially open)
-        score_table[{3, 0, 0, 0}] = {8, 1};
-        score_table[{3, 0, 1, 0}] = {16, 1};
-        score_table[{3, 0, 2, 0}] = {16, 1};
-
-        score_table[{3, 1, 0, 0}] = {8, 1};
-        score_table[{3, 1, 1, 0}] = {16, 1};
-        score_table[{3, 1, 2, 0}] = {16, 1};
-
-        score_table[{3, 2, 0, 0}] = {8, 1};
-        score_table[{3, 2, 1, 0}] = {16, 1};
-        score_table[{3, 2, 2, 0}] = {16, 1};
-
-        score_table[{3, 3, 0, 0}] = {16, 2};
-        score_table[{3, 3, 1, 0}] = {32, 2};
-        score_table[{3, 3, 2, 0}] = {32, 2};
-        score_table[{3, 3, 0, 1}] = {16, 3};
-        score_table[{3, 3, 1, 1}] = {32, 3};
-        score_table[{3, 3, 2, 1}] = {32, 3};
-        score_table[{3, 3, 0, 2}] = {16, 4};
-        score_table[{3, 3, 1, 2}] = {32, 4};
-        score_table[{3, 3, 2, 2}] = {32, 4};
-
-        score_table[{3, 4, 0, 0}] = {16, 2};
-        score_table[{3, 4, 1, 0}] = {32, 2};
-        score_table[{3, 4, 2, 0}] = {32, 2};
+        set_table_score(table, 3, 0, 0, 0, 8, 1);
+        set_table_score(table, 3, 0, 1, 0, 16, 1);
+        set_table_score(table, 3, 0, 2, 0, 16, 1);
+
+        set_table_score(table, 3, 1, 0, 0, 8, 1);
+        set_table_score(table, 3, 1, 1, 0, 16, 1);
+        set_table_score(table, 3, 1, 2, 0, 16, 1);
+
+        set_table_score(table, 3, 2, 0, 0, 8, 1);
+        set_table_score(table, 3, 2, 1, 0, 16, 1);
+        set_table_score(table, 3, 2, 2, 0, 16, 1);
+
+        set_table_score(table, 3, 3, 0, 0, 16, 2);
+        set_table_score(table, 3, 3, 1, 0, 32, 2);
+        set_table_score(table, 3, 3, 2, 0, 32, 2);
+        set_table_score(table, 3, 3, 0, 1, 16, 3);
+        set_table_score(table, 3, 3, 1, 1, 32, 3);
+        set_table_score(table, 3, 3, 2, 1, 32, 3);
+        set_table_score(table, 3, 3, 0, 2, 16, 4);
+        set_table_score(table, 3, 3, 1, 2, 32, 4);
+        set_table_score(table, 3, 3, 2, 2, 32, 4);
+
+        set_table_score(table, 3, 4, 0, 0, 16, 2);
+        set_table_score(table, 3, 4, 1, 0, 32, 2);
+        set_table_score(table, 3, 4, 2, 0, 32, 2);
+
+        return table;
     }
 
-} // namespace Mahjong
\ No newline at end of file
+    /** @brief The score table, computed at compile time. */
+    inline constexpr Score_table SCORE_TABLE = make_score_table();
+
+    /**
+     * @brief Looks up the score of a single combination.
+     *
+     * @param type The combination type (0 = pair, 1 = chow, 2 = pong, 3 = kong).
+     * @param suit The suit of the corresponding tiles (0 to 4).
+     * @param visibility Whether the tiles are hidden (1) or not (0), 2 for kongs that are partially open.
+     * @param wind The number of matches of a wind type combination with the seat and round winds.
+     * @return The score of the combination and its multiplier.
+     */
+    constexpr Combination_score lookup_combination_score(unsigned int type, unsigned int suit, unsigned int visibility, unsigned int wind)
+    {
+        return SCORE_TABLE[get_score_index(type, suit, visibility, wind)];
+    }
+
+    static_assert(lookup_combination_score(2, 3, 1, 2).score == 16 && lookup_combination_score(2, 3, 1, 2).multiplier == 3);
+    static_assert(lookup_combination_score(0, 0, 0, 0).score == 0);
+
+} // namespace Mahjong
@@ -2,9 +2,9 @@
 Mahjong in C++
 */
 
+#include <algorithm>
 #include <iostream>
 #include <ctime>
-#include <random>
 #include <thread>
 #include <vector>
 
@@ -15,11 +15,80 @@ Mahjong in C++
 
 using namespace std;
 
-int main()
+/**
+ * @brief Asks the human player for the tile to be discarded.
+ *
+ * @param game The game waiting for the discard.
+ * @param decision The pending discard decision.
+ * @return The index of the tile to be discarded.
+ */
+int read_discard(Mahjong::Game &game, const Mahjong::Decision &decision)
 {
-    srand(time(NULL));
+    if (game.get_pile_size() > 0)
+        game.display_discard_pile();
+    game.display_player_hand(decision.player_number);
+    game.display_player_score(decision.player_number, true, false);
 
-    Mahjong::Game game = Mahjong::Game(46);
+    while (true)
+    {
+        int to_discard;
+        cout << "Select which tile to discard:" << endl;
+        cin >> to_discard;
+        if (std::find(decision.available_actions.begin(), decision.available_actions.end(), to_discard) != decision.available_actions.end())
+            return to_discard;
+        cout << "Invalid number. Choice must be the index of a hidden tile." << endl;
+    }
+}
+
+/**
+ * @brief Asks the human player whether to claim the latest discard.
+ *
+ * @param decision The pending pickup decision.
+ * @return The chosen Pickup_action value.
+ */
+int read_pickup(const Mahjong::Decision &decision)
+{
+    // The last available action is always none, which is chosen with -1.
+    const size_t n_claims = decision.available_actions.size() - 1;
+    while (true)
+    {
+        cout << "Available actions:" << endl;
+        for (size_t i = 0; i < n_claims; i++)
+            cout << i << ": " << Mahjong::to_string(static_cast<Mahjong::Pickup_action>(decision.available_actions[i])) << endl;
+        int chosen_action;
+        cout << "Select action (-1 for none):" << endl;
+        cin >> chosen_action;
+        if (chosen_action == -1)
+            return static_cast<int>(Mahjong::Pickup_action::none);
+        if (0 <= chosen_action && chosen_action < static_cast<int>(n_claims))
+            return decision.available_actions[chosen_action];
+    }
+}
+
+/**
+ * @brief Displays the final scores of a finished game.
+ *
+ * @param game The finished game.
+ * @param add_scores Whether the scores are added to the players' cumulative scores.
+ */
+void display_final_scores(Mahjong::Game &game, bool add_scores)
+{
+    int winner = game.get_winner();
+    if (winner < 0)
+        cout << "Game finished due to running out of tiles." << endl;
+    for (int i = 0; i < N_PLAYERS; i++)
+    {
+        cout << "Player " << i << " - ";
+        game.display_player_score(i, true, i == winner);
+        if (add_scores)
+            game.add_final_score(i, i == winner);
+    }
+    cout << "\n";
+}
+
+int main()
+{
+    Mahjong::Game game = Mahjong::Game(46, time(NULL));
 
     while (true)
     {
@@ -35,11 +104,12 @@ int main()
         {
             int player_number = 0;
             game.set_human(player_number);
+            game.set_external_player(player_number, true);
             for (int i = 0; i < N_PLAYERS; i++)
             {
                 if (i == player_number)
                     continue;
-                game.set_player_policy(i, "tile_count");
+                game.set_player_policy(i, Mahjong::Policy_type::tile_count);
             }
 
             if (game.get_set_size() == 0)
@@ -48,100 +118,22 @@ int main()
                 game.set_human(player_number);
             }
 
-            unsigned int current_player;
-            bool broadcast;
-
             bool multiple_rounds = true;
             while (multiple_rounds)
             {
-
-                // First turn
-                current_player = game.get_current_player();
-                cout << "Player " << current_player << "'s turn (" << game.get_players()[current_player].get_seat_wind().get_wind_as_string() << "):" << endl;
-                broadcast = (current_player == player_number);
-                game.player_turn(current_player, broadcast);
-                std::cout << "" << std::endl;
-
-                while (game.is_running())
+                // The game suspends at every decision of the human player.
+                game.advance();
+                while (game.has_pending_decision())
                 {
-                    // Check if any pickup actions are performed.
-                    std::tuple<int, std::string> pickup_tuple = game.pickup_action(current_player);
-                    std::string action = get<1>(pickup_tuple);
-
-                    if (action != "none")
-                    {
-                        current_player = get<0>(pickup_tuple);
-                        broadcast = (current_player == player_number);
-                        std::cout << "Player " << current_player << " performs " << action << "." << std::endl;
-                        game.player_pick_from_discard(current_player, action);
-                        if (broadcast)
-                        {
-                            // std::cout << "Yes broadcast" << std::endl;
-                            game.sort_player_hand(current_player);
-                            game.display_player_hand(current_player);
-                            game.display_player_score(current_player, true, false);
-                        }
-                        else
-                        {
-                            // std::cout << "No broadcast" << std::endl;
-                            game.display_visible_player_hand(current_player);
-                            game.display_player_score(current_player, false, false);
-                        }
-                        game.player_has_winning_hand(current_player);
-                        if (game.is_running())
-                            game.player_discard(current_player);
-                        else
-                        {
-                            for (int i = 0; i < N_PLAYERS; i++)
-                            {
-                                cout << "Player " << i << " - ";
-                                if (i == current_player)
-                                {
-                                    game.display_player_score(i, true, true);
-                                    game.add_final_score(i, true);
-                                }
-                                else
-                                {
-                                    game.display_player_score(i, true, false);
-                                    game.add_final_score(i, false);
-                                }
-                            }
-                            cout << "\n";
-                        }
-                        game.set_current_player(get<0>(pickup_tuple));
-                    }
+                    Mahjong::Decision decision = game.pending_decision();
+                    if (decision.action_type == Mahjong::Action_type::discard)
+                        game.submit(read_discard(game, decision));
                     else
-                    {
-                        // std::cout << "No actions performed." << std::endl;
-                        current_player = (current_player + 1) % N_PLAYERS;
-                        game.set_current_player(current_player);
-                        broadcast = (current_player == player_number);
-
-                        if (current_player == player_number && game.get_pile_size() > 0)
-                        {
-                            game.display_discard_pile();
-                        }
-
-                        cout << "Player " << current_player << "'s turn (" << game.get_players()[current_player].get_seat_wind().get_wind_as_string() << "):" << endl;
-                        game.player_turn(current_player, broadcast);
-                    }
-
+                        game.submit(read_pickup(decision));
                     std::this_thread::sleep_for(300ms);
-                    std::cout << "\n";
-
-                    if (game.get_set_size() == 0)
-                    {
-                        std::cout << "Game finished due to running out of tiles." << std::endl;
-                        for (int i = 0; i < N_PLAYERS; i++)
-                        {
-                            cout << "Player " << i << " - ";
-                            game.display_player_score(i, true, false);
-                            game.add_final_score(i, false);
-                        }
-                        game.finish();
-                        cout << "\n";
-                    }
+                    game.advance();
                 }
+                display_final_scores(game, true);
 
                 cout << "Start next round (Y/n)?";
                 string reply = "";
@@ -151,14 +143,7 @@ int main()
                 {
                     game.display_cumulative_scores();
                     game.next_round();
-                    int player_number = 0;
                     game.set_human(player_number);
-                    for (int i = 0; i < N_PLAYERS; i++)
-                    {
-                        if (i == player_number)
-                            continue;
-                        game.set_player_policy(i, "tile_count");
-                    }
                 }
                 else
                 {
@@ -168,77 +153,22 @@ int main()
         }
         else if (input == "sim")
         {
-            int player_number = -1;
-
-            game.set_player_policy(0, "tile_count");
+            game.set_player_policy(0, Mahjong::Policy_type::tile_count);
 
             if (game.get_set_size() == 0)
             {
                 game.reset();
-                game.set_player_policy(0, "tile_count");
+                game.set_player_policy(0, Mahjong::Policy_type::tile_count);
             }
+            for (int i = 0; i < N_PLAYERS; i++)
+                game.set_external_player(i, false);
 
-            unsigned int current_player;
-            bool broadcast = false;
-
-            // First turn
-            current_player = game.get_current_player();
-            cout << "Player " << current_player << "'s turn:" << endl;
-            game.player_turn(current_player, broadcast);
-            std::cout << "\n";
-            cout << game.is_running() << "\n";
-
-            while (game.is_running())
-            {
-                // Check if any pickup actions are performed.
-                std::tuple<int, std::string> pickup_tuple = game.pickup_action(current_player);
-                std::string action = get<1>(pickup_tuple);
-
-                if (action != "none")
-                {
-                    current_player = get<0>(pickup_tuple);
-                    broadcast = (current_player == player_number);
-                    std::cout << "Player " << current_player << " performs " << action << "." << std::endl;
-                    game.player_pick_from_discard(current_player, action);
-
-                    // std::cout << "No broadcast" << std::endl;
-                    game.display_visible_player_hand(current_player);
-                    game.display_player_score(current_player, broadcast, false);
-
-                    game.player_has_winning_hand(current_player);
-                    if (game.is_running())
-                        game.player_discard(current_player);
-                    game.set_current_player(get<0>(pickup_tuple));
-                }
-                else
-                {
-                    // std::cout << "No actions performed." << std::endl;
-                    current_player = (current_player + 1) % N_PLAYERS;
-                    game.set_current_player(current_player);
-                    cout << "Player " << current_player << "'s turn:" << endl;
-                    game.player_turn(current_player, broadcast);
-                }
-
-                std::cout << "\n";
-
-                if (game.get_set_size() == 0)
-                {
-                    std::cout << "Game finished due to running out of tiles.\n";
-                    for (int i = 0; i < N_PLAYERS; i++)
-                    {
-                        cout << "Player " << i << " - ";
-                        game.display_player_score(i, true);
-                    }
-                    game.finish();
-                    cout << "\n";
-                }
-            }
+            game.advance();
+            display_final_scores(game, false);
         }
         else
         {
             cout << "Unknown input " << input << endl;
         }
-
-        // cout << input << endl;
     }
 };
@@ -0,0 +1,586 @@
+/*
+Mahjong server hosting many tables, each played by one human over a TCP connection against three AI opponents.
+All connections are served by a single thread through an epoll event loop. Every table is a step-driven Game,
+which is suspended while it waits for its human player (see Game::advance), so idle tables cost no thread.
+
+The protocol is line based, e.g. for netcat or telnet. At each decision the server sends the human's hand and a
+prompt, which is answered with a tile index resp. a pickup action:
+
+    hand 0:Circles 1|1:Characters 1|2:Characters 5 (Open)|...
+    last_discard Bamboos 4
+    tiles_left 57
+    pickup? pong none
+
+Finished games are reported as `end WINNER SCORE0 SCORE1 SCORE2 SCORE3` (WINNER is -1 if the set ran out),
+followed by the prompt `new? new quit`. `quit` closes the connection at any time.
+*/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/Action.hpp"
+#include "include/Game.hpp"
+#include "include/Logging.hpp"
+#include "include/Random.hpp"
+
+using namespace std;
+
+/** @brief Default number of tables, i.e. the maximal number of concurrent sessions. */
+unsigned int N_TABLES = 1024;
+
+/** @brief Default port of the server. */
+const unsigned int DEFAULT_PORT = 7777;
+
+/** @brief Maximal length of a received line, longer lines close the connection. */
+const size_t MAX_LINE_LENGTH = 256;
+
+/** @brief Maximal number of bytes waiting to be sent to a client, slower clients are disconnected. */
+const size_t MAX_OUTPUT_SIZE = 16384;
+
+/** @brief Maximal number of events handled per wait of the event loop. */
+const unsigned int MAX_EVENTS = 256;
+
+/** @brief Epoll token of the listening socket, the tokens of the connections being their table indices. */
+const std::uint32_t LISTEN_TOKEN = UINT32_MAX;
+
+/** @brief The seat of the human player at every table. */
+const unsigned int HUMAN_SEAT = 0;
+
+/**
+ * @brief A table of the server, allocated once and reused by consecutive sessions.
+ */
+struct Table
+{
+    Mahjong::Game game;                       ///< The game, the human's seat being external.
+    int fd = -1;                              ///< Socket of the connected player, -1 if the table is free.
+    array<char, MAX_LINE_LENGTH> input = {};  ///< Received bytes not forming a complete line yet.
+    size_t input_size = 0;                    ///< Number of bytes in input.
+    string output;                            ///< Bytes waiting to be sent, at most MAX_OUTPUT_SIZE.
+    bool watching_output = false;             ///< Whether the socket is watched for writability.
+    bool closing = false;                     ///< Whether the session is to be closed after the current event.
+
+    /**
+     * @brief Constructor for the Table struct.
+     *
+     * @param id The index of the table, used as id of its game.
+     */
+    explicit Table(unsigned int id) : game(id)
+    {
+        output.reserve(MAX_OUTPUT_SIZE);
+    }
+};
+
+/**
+ * @class Server
+ * @brief Serves a pool of tables to the connections of a listening socket through a single epoll event loop.
+ */
+class Server
+{
+private:
+    int epoll_fd = -1;                       ///< The epoll instance.
+    int listen_fd = -1;                      ///< The listening socket.
+    vector<Table> tables;                    ///< The preallocated tables.
+    vector<unsigned int> free_tables;        ///< Indices of the tables without a session.
+    std::uint64_t seed;                      ///< Base seed, the seed of each game is derived from it and a counter.
+    std::uint64_t n_games = 0;               ///< Number of games started so far.
+
+    /**
+     * @brief Queues text to be sent to the player of a table, closing sessions which don't read their output.
+     *
+     * @param table The table.
+     * @param text The text.
+     */
+    void send_text(Table &table, const string &text)
+    {
+        if (table.output.size() + text.size() > MAX_OUTPUT_SIZE)
+        {
+            table.closing = true;
+            return;
+        }
+        table.output += text;
+    }
+
+    /**
+     * @brief Sends the hand of the human player and the prompt of the pending decision, or the end of the game.
+     *
+     * @param table The table.
+     */
+    void send_state(Table &table)
+    {
+        Mahjong::Game &game = table.game;
+        if (!game.has_pending_decision())
+        {
+            string text = "end " + to_string(game.get_winner());
+            for (unsigned int player_number = 0; player_number < N_PLAYERS; player_number++)
+                text += " " + to_string(game.get_player_score(player_number, true, game.get_winner() == static_cast<int>(player_number)));
+            send_text(table, text + "\nnew? new quit\n");
+            return;
+        }
+
+        const Mahjong::Decision decision = game.pending_decision();
+        const Mahjong::Hand &hand = game.get_player_hand(HUMAN_SEAT);
+        string text = "hand ";
+        for (int index = 0; index < hand.get_hand_size(); index++)
+        {
+            Mahjong::Tile tile = hand.get_tile_by_index(index);
+            text += (index > 0 ? "|" : "") + to_string(index) + ":" + tile.get_tile_as_string() + (tile.is_hidden() ? "" : " (Open)");
+        }
+        text += "\n";
+
+        Mahjong::State_view state = game.get_game_state_for_player(HUMAN_SEAT);
+        if (state.get_discard_pile().get_size() > 0)
+            text += "last_discard " + state.get_discard_pile().back().get_tile_as_string() + "\n";
+        text += "tiles_left " + to_string(game.get_set_size()) + "\n";
+
+        if (decision.action_type == Mahjong::Action_type::discard)
+        {
+            text += "discard?";
+            for (int index : decision.available_actions)
+                text += " " + to_string(index);
+        }
+        else
+        {
+            text += "pickup?";
+            for (int action : decision.available_actions)
+                text += string(" ") + Mahjong::to_string(static_cast<Mahjong::Pickup_action>(action));
+        }
+        send_text(table, text + "\n");
+    }
+
+    /**
+     * @brief Plays a table on until its human player has to decide or the game is finished.
+     *
+     * @param table The table.
+     */
+    void advance_table(Table &table)
+    {
+        table.game.advance();
+        send_state(table);
+    }
+
+    /**
+     * @brief Starts a new game at a table.
+     *
+     * @param table The table.
+     */
+    void start_game(Table &table)
+    {
+        Mahjong::Game &game = table.game;
+        game.reset(Mahjong::derive_seed(seed, n_games++));
+        game.set_current_player(game.get_rng().bounded(N_PLAYERS));
+        advance_table(table);
+    }
+
+    /**
+     * @brief Handles a line received from the player of a table.
+     *
+     * @param table The table.
+     * @param line The line without its line break.
+     */
+    void handle_line(Table &table, const string &line)
+    {
+        Mahjong::Game &game = table.game;
+        if (line == "quit")
+        {
+            table.closing = true;
+            return;
+        }
+        if (!game.has_pending_decision())
+        {
+            if (line == "new")
+                start_game(table);
+            else
+                send_text(table, "error expected new or quit\n");
+            return;
+        }
+
+        int action = -1;
+        const Mahjong::Decision decision = game.pending_decision();
+        if (decision.action_type == Mahjong::Action_type::discard)
+        {
+            // The whole line is parsed, indices past the hand, including ones too large for strtoul, are rejected.
+            if (!line.empty() && all_of(line.begin(), line.end(), [](char c)
+                                        { return c >= '0' && c <= '9'; }))
+            {
+                unsigned long index = strtoul(line.c_str(), nullptr, 10);
+                if (index < static_cast<unsigned long>(game.get_player_hand(decision.player_number).get_hand_size()))
+                    action = static_cast<int>(index);
+            }
+        }
+        else
+        {
+            for (unsigned int value = 0; value < Mahjong::N_PICKUP_ACTIONS; value++)
+            {
+                if (line == Mahjong::PICKUP_ACTION_NAMES[value])
+                    action = value;
+            }
+        }
+
+        if (action < 0 || !game.submit(action))
+        {
+            send_text(table, "error invalid action " + line + "\n");
+            return;
+        }
+        advance_table(table);
+    }
+
+    /**
+     * @brief Watches the socket of a table for writability, or stops doing so.
+     *
+     * @param index The index of the table.
+     * @param watch Whether the socket is to be watched for writability.
+     */
+    void watch_output(unsigned int index, bool watch)
+    {
+        Table &table = tables[index];
+        if (table.watching_output == watch)
+            return;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        if (watch)
+            event.events |= EPOLLOUT;
+        event.data.u32 = index;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, table.fd, &event);
+        table.watching_output = watch;
+    }
+
+    /**
+     * @brief Sends as much of the queued output of a table as the socket accepts.
+     *
+     * @param index The index of the table.
+     */
+    void flush(unsigned int index)
+    {
+        Table &table = tables[index];
+        size_t n_sent = 0;
+        while (n_sent < table.output.size())
+        {
+            ssize_t n = send(table.fd, table.output.data() + n_sent, table.output.size() - n_sent, MSG_NOSIGNAL);
+            if (n > 0)
+                n_sent += n;
+            else if (n < 0 && errno == EINTR)
+                continue;
+            else
+            {
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                    table.closing = true;
+                break;
+            }
+        }
+        table.output.erase(0, n_sent);
+        watch_output(index, !table.output.empty());
+    }
+
+    /**
+     * @brief Ends the session of a table and returns the table to the pool.
+     *
+     * @param index The index of the table.
+     */
+    void close_table(unsigned int index)
+    {
+        Table &table = tables[index];
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, table.fd, nullptr);
+        close(table.fd);
+        table.fd = -1;
+        table.input_size = 0;
+        table.output.clear();
+        table.watching_output = false;
+        table.closing = false;
+        free_tables.push_back(index);
+    }
+
+    /**
+     * @brief Accepts all pending connections, assigning each to a free table.
+     */
+    void accept_connections()
+    {
+        while (true)
+        {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            if (free_tables.empty())
+            {
+                static const char full[] = "error server full\n";
+                send(fd, full, sizeof(full) - 1, MSG_NOSIGNAL);
+                close(fd);
+                continue;
+            }
+
+            unsigned int index = free_tables.back();
+            free_tables.pop_back();
+            Table &table = tables[index];
+            table.fd = fd;
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = index;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+            send_text(table, "welcome table " + to_string(index) + "\n");
+            start_game(table);
+            flush(index);
+            if (table.closing)
+                close_table(index);
+        }
+    }
+
+    /**
+     * @brief Reads the available input of a table and handles its complete lines.
+     *
+     * @param index The index of the table.
+     */
+    void read_input(unsigned int index)
+    {
+        Table &table = tables[index];
+        char buffer[4096];
+        while (!table.closing)
+        {
+            ssize_t n = recv(table.fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (n <= 0)
+            {
+                table.closing = true;
+                break;
+            }
+
+            for (ssize_t i = 0; i < n && !table.closing; i++)
+            {
+                char c = buffer[i];
+                if (c == '\n')
+                {
+                    size_t length = table.input_size;
+                    if (length > 0 && table.input[length - 1] == '\r')
+                        length--;
+                    table.input_size = 0;
+                    handle_line(table, string(table.input.data(), length));
+                }
+                else if (table.input_size < MAX_LINE_LENGTH)
+                    table.input[table.input_size++] = c;
+                else
+                    table.closing = true;
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Constructor allocating all tables up front.
+     *
+     * @param n_tables The number of tables.
+     * @param ai_policy The policy of the three AI seats of every table.
+     * @param ai_parameters The randomness and chow rate of the AI policy.
+     * @param seed_in Base seed of the games.
+     */
+    Server(unsigned int n_tables, Mahjong::Policy_type ai_policy, const Mahjong::Policy_parameters &ai_parameters, std::uint64_t seed_in) : seed(seed_in)
+    {
+        tables.reserve(n_tables);
+        free_tables.reserve(n_tables);
+        for (unsigned int index = 0; index < n_tables; index++)
+        {
+            tables.emplace_back(index);
+            for (unsigned int seat = 0; seat < N_PLAYERS; seat++)
+            {
+                if (seat != HUMAN_SEAT)
+                {
+                    tables.back().game.set_player_policy(seat, ai_policy);
+                    tables.back().game.set_player_policy_parameters(seat, ai_parameters);
+                }
+            }
+            tables.back().game.set_external_player(HUMAN_SEAT, true);
+            free_tables.push_back(n_tables - 1 - index);
+        }
+    }
+
+    ~Server()
+    {
+        for (Table &table : tables)
+        {
+            if (table.fd >= 0)
+                close(table.fd);
+        }
+        if (listen_fd >= 0)
+            close(listen_fd);
+        if (epoll_fd >= 0)
+            close(epoll_fd);
+    }
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief Creates the listening socket and the epoll instance.
+     *
+     * @param port The TCP port to listen on.
+     * @return True on success, false otherwise.
+     */
+    bool listen_on(unsigned int port)
+    {
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+            return false;
+        int enable = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listen_fd, SOMAXCONN) < 0)
+            return false;
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            return false;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = LISTEN_TOKEN;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == 0;
+    }
+
+    /**
+     * @brief Runs the event loop until an unrecoverable error occurs.
+     */
+    void run()
+    {
+        array<epoll_event, MAX_EVENTS> events;
+        while (true)
+        {
+            int n_events = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, -1);
+            if (n_events < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                cerr << "epoll_wait failed: " << strerror(errno) << "\n";
+                return;
+            }
+
+            for (int i = 0; i < n_events; i++)
+            {
+                std::uint32_t token = events[i].data.u32;
+                if (token == LISTEN_TOKEN)
+                {
+                    accept_connections();
+                    continue;
+                }
+
+                Table &table = tables[token];
+                if (table.fd < 0)
+                    continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    table.closing = true;
+                if (!table.closing && (events[i].events & EPOLLIN))
+                    read_input(token);
+                if (!table.output.empty())
+                    flush(token);
+                if (table.closing)
+                    close_table(token);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Prints the command line options of the server.
+ */
+void print_usage()
+{
+    cout << "Usage: server [--port N] [--tables N] [--policy NAME] [--randomness R] [--seed N]\n"
+         << "  --port N       TCP port to listen on (default " << DEFAULT_PORT << ").\n"
+         << "  --tables N     Number of tables, i.e. maximal number of concurrent players (default " << N_TABLES << ").\n"
+         << "  --policy NAME  Policy of the AI opponents (default tile_count).\n"
+         << "  --randomness R Randomness factor of the AI policy, applied inversely: the chance of deciding by the\n"
+         << "                 policy rather than at random (default " << Mahjong::Policy_parameters().randomness << ", 1 always uses the policy).\n"
+         << "  --seed N       Base seed of the games (default: current time).\n";
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int port = DEFAULT_PORT;
+    unsigned int n_tables = N_TABLES;
+    Mahjong::Policy_type ai_policy = Mahjong::Policy_type::tile_count;
+    Mahjong::Policy_parameters ai_parameters;
+    std::uint64_t seed = time(NULL);
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        if (argument == "--help" || argument == "-h")
+        {
+            print_usage();
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+        string value = argv[++i];
+
+        if (argument == "--port")
+            port = stoul(value);
+        else if (argument == "--tables")
+            n_tables = std::max(1ul, stoul(value));
+        else if (argument == "--seed")
+            seed = stoull(value);
+        else if (argument == "--policy")
+        {
+            if (!Mahjong::parse_policy_type(value, ai_policy) || ai_policy == Mahjong::Policy_type::human)
+            {
+                cerr << "Invalid policy " << value << "\n";
+                return 1;
+            }
+        }
+        else if (argument == "--randomness")
+        {
+            ai_parameters.randomness = stof(value);
+            if (!(ai_parameters.randomness >= 0 && ai_parameters.randomness <= 1))
+            {
+                cerr << "Invalid randomness " << value << "\n";
+                return 1;
+            }
+        }
+        else
+        {
+            cerr << "Unknown option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+
+    // The games' own text output is not part of the protocol.
+    Mahjong::Null_sink null_sink;
+    Mahjong::set_log_sink(null_sink);
+
+    Server server(n_tables, ai_policy, ai_parameters, seed);
+    if (!server.listen_on(port))
+    {
+        cerr << "Could not listen on port " << port << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    cerr << "Serving " << n_tables << " tables on port " << port << "\n";
+    server.run();
+    return 1;
+}
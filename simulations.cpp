@@ -1,95 +1,261 @@
+#include <algorithm>
 #include <iostream>
 #include <ctime>
-#include <random>
+#include <fstream>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "include/Tile.hpp"
 #include "include/Set.hpp"
 #include "include/Game.hpp"
+#include "include/Instrumentation.hpp"
+#include "include/Logging.hpp"
 #include "include/Player.hpp"
+#include "include/Simulation_runner.hpp"
+#include "include/Statistics.hpp"
 
 unsigned int N_GAMES = 5000;
 
 using namespace std;
 
-int main()
+/**
+ * @brief Prints the command line options of the simulation runner.
+ */
+void print_usage()
 {
+    cout << "Usage: simulations [--games N] [--threads N] [--policy SEAT=POLICY]... [--randomness SEAT=R]... [--seed N]\n"
+         << "                   [--record FILE] [--instrumentation FILE] [--confidence P] [--compare A,B] [--significance P]\n"
+         << "                   [--check-interval N] [--duplicate] [--discard-wins-only]\n"
+         << "  --games N            Number of games to simulate (default " << N_GAMES << ").\n"
+         << "  --threads N          Number of worker threads (default: number of hardware threads).\n"
+         << "  --policy SEAT=NAME   Policy of the player at SEAT (0 to 3), e.g. --policy 0=tile_count.\n"
+         << "                       Seat 0 defaults to tile_count, all other seats to random.\n"
+         << "  --randomness SEAT=R  Randomness factor of the policy at SEAT, applied inversely: the chance of deciding\n"
+         << "                       by the policy rather than at random (default " << Mahjong::Policy_parameters().randomness << ", 1 always uses the policy).\n"
+         << "  --seed N             Base seed of the simulation (default: current time).\n"
+         << "  --record FILE        Write the records of all games to FILE (see include/Game_record.hpp).\n"
+         << "  --instrumentation FILE\n"
+         << "                       Write the hot path counters as JSON to FILE (needs -DMAHJONG_INSTRUMENT).\n"
+         << "  --confidence P       Confidence level of the reported intervals (default 0.95).\n"
+         << "  --compare A,B        Stop as soon as the scores of policies A and B differ significantly,\n"
+         << "                       --games being the maximal number of games.\n"
+         << "  --significance P     Significance level of the comparison (default 0.05).\n"
+         << "  --check-interval N   Number of games between two tests of the comparison (default 1000).\n"
+         << "  --duplicate          Play every deal once per rotation of the policies over the seats,\n"
+         << "                       --games and --check-interval counting deals.\n"
+         << "  --discard-wins-only  Count only wins with a claimed discard, like the original simulation loop.\n";
+}
 
-    srand(time(NULL));
-
-    cout.setstate(ios_base::failbit);
-
-    Mahjong::Game game = Mahjong::Game(46);
+/**
+ * @brief Prints the number of wins and the average score of a group of seats with their confidence intervals.
+ *
+ * @param n_wins Number of wins of the seats.
+ * @param n_trials Number of games times the number of seats.
+ * @param score_stats Final score per game of the seats.
+ * @param confidence Confidence level of the intervals.
+ */
+void print_seat_statistics(unsigned int n_wins, unsigned long long n_trials, const Mahjong::Running_stats &score_stats, double confidence)
+{
+    Mahjong::Interval win_rate = Mahjong::get_wilson_interval(n_wins, n_trials, confidence);
+    Mahjong::Interval score = score_stats.get_confidence_interval(confidence);
+    cout << "Number of wins: " << n_wins << "\n"
+         << "Win rate: " << (n_trials > 0 ? static_cast<double>(n_wins) / n_trials : 0.0) << " (" << confidence * 100 << "% CI " << win_rate.lower << " to " << win_rate.upper << ")\n"
+         << "Average score: " << score_stats.get_mean() << " (" << confidence * 100 << "% CI " << score.lower << " to " << score.upper << ")" << endl;
+}
 
-    vector<int> player_wins = {0, 0, 0, 0};
-    vector<int> player_scores = {0, 0, 0, 0};
+int main(int argc, char *argv[])
+{
+    std::uint64_t seed = time(NULL);
+    unsigned int n_games = N_GAMES;
+    unsigned int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    string record_path;
+    string instrumentation_path;
+    double confidence = 0.95;
+    bool compare = false;
+    bool duplicate = false;
+    bool discard_wins_only = false;
+    Mahjong::Policy_comparison comparison;
+    array<Mahjong::Policy_type, 4> policies = {Mahjong::Policy_type::tile_count, Mahjong::Policy_type::random, Mahjong::Policy_type::random, Mahjong::Policy_type::random};
+    array<Mahjong::Policy_parameters, 4> parameters;
 
-    for (unsigned int n = 0; n < N_GAMES; n++)
+    for (int i = 1; i < argc; i++)
     {
-        if (n % 100 == 0)
+        string argument = argv[i];
+        if (argument == "--help" || argument == "-h")
         {
-            cout.clear();
-            cout << "Starting game number " << n << endl;
-            cout.setstate(ios_base::failbit);
+            print_usage();
+            return 0;
         }
-
-        game.reset();
-        game.set_player_policy(0, "tile_count");
-
-        unsigned int current_player = rand() % 4;
-        game.set_current_player(current_player);
-
-        game.player_turn(current_player, false);
-
-        while (game.is_running())
+        if (argument == "--duplicate")
+        {
+            duplicate = true;
+            continue;
+        }
+        if (argument == "--discard-wins-only")
         {
-            tuple<int, string> pickup_tuple = game.pickup_action(current_player);
-            string action = get<1>(pickup_tuple);
+            discard_wins_only = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+        string value = argv[++i];
 
-            if (action != "none")
+        if (argument == "--games")
+            n_games = stoul(value);
+        else if (argument == "--threads")
+            n_threads = stoul(value);
+        else if (argument == "--seed")
+            seed = stoull(value);
+        else if (argument == "--record")
+            record_path = value;
+        else if (argument == "--instrumentation")
+            instrumentation_path = value;
+        else if (argument == "--confidence")
+            confidence = stod(value);
+        else if (argument == "--significance")
+            comparison.significance = stod(value);
+        else if (argument == "--check-interval")
+            comparison.check_interval = stoul(value);
+        else if (argument == "--compare")
+        {
+            size_t separator = value.find(',');
+            if (separator == string::npos || !Mahjong::parse_policy_type(value.substr(0, separator), comparison.policy_a) ||
+                !Mahjong::parse_policy_type(value.substr(separator + 1), comparison.policy_b))
             {
-                current_player = get<0>(pickup_tuple);
-                game.player_pick_from_discard(current_player, action);
-
-                game.player_has_winning_hand(current_player);
-                if (game.is_running())
-                    game.player_discard(current_player);
-                else
-                {
-                    player_wins[current_player] += 1;
-                    for (int i = 0; i < N_PLAYERS; i++)
-                    {
-                        player_scores[i] += game.get_player_score(i, true, (i == current_player));
-                    }
-                }
-                game.set_current_player(get<0>(pickup_tuple));
+                cerr << "Invalid policy comparison " << value << "\n";
+                return 1;
             }
-            else
+            compare = true;
+        }
+        else if (argument == "--policy")
+        {
+            size_t separator = value.find('=');
+            unsigned int seat = (separator == string::npos) ? N_PLAYERS : stoul(value.substr(0, separator));
+            string policy_name = (separator == string::npos) ? "" : value.substr(separator + 1);
+            Mahjong::Policy_type policy;
+            if (seat >= N_PLAYERS || !Mahjong::parse_policy_type(policy_name, policy) || policy == Mahjong::Policy_type::human)
             {
-                current_player = (current_player + 1) % N_PLAYERS;
-                game.set_current_player(current_player);
-                game.player_turn(current_player, false);
+                cerr << "Invalid policy assignment " << value << "\n";
+                return 1;
             }
-
-            if (game.get_set_size() == 0)
+            policies[seat] = policy;
+        }
+        else if (argument == "--randomness")
+        {
+            size_t separator = value.find('=');
+            unsigned int seat = (separator == string::npos) ? N_PLAYERS : stoul(value.substr(0, separator));
+            float randomness = (separator == string::npos) ? -1 : stof(value.substr(separator + 1));
+            if (seat >= N_PLAYERS || !(randomness >= 0 && randomness <= 1))
             {
-                for (int i = 0; i < N_PLAYERS; i++)
-                {
-                    player_scores[i] += game.get_player_score(i, true, false);
-                }
-                game.finish();
-                cout << "\n";
+                cerr << "Invalid randomness assignment " << value << "\n";
+                return 1;
             }
+            parameters[seat].randomness = randomness;
+        }
+        else
+        {
+            cerr << "Unknown option " << argument << "\n";
+            print_usage();
+            return 1;
         }
     }
 
+    if (!(confidence > 0 && confidence < 1))
+    {
+        cerr << "Invalid confidence level " << confidence << "\n";
+        return 1;
+    }
+
+    Mahjong::Null_sink null_sink;
+    Mahjong::set_log_sink(null_sink);
+
+    Mahjong::Simulation_runner runner = Mahjong::Simulation_runner(n_games, n_threads, policies, seed);
+    runner.set_duplicate(duplicate);
+    runner.set_discard_wins_only(discard_wins_only);
+    for (unsigned int seat = 0; seat < N_PLAYERS; seat++)
+        runner.set_policy_parameters(seat, parameters[seat]);
+    if (compare && !runner.set_early_stopping(comparison))
+    {
+        cerr << "Invalid comparison: both policies must be played by a seat and the settings must be valid\n";
+        return 1;
+    }
+    Mahjong::Game_record_file record_file;
+    if (!record_path.empty())
+    {
+        if (!record_file.open(record_path))
+        {
+            cerr << "Could not create record file " << record_path << "\n";
+            return 1;
+        }
+        runner.set_record_file(&record_file);
+    }
+    Mahjong::Simulation_results results = runner.run(100);
+    if (!record_path.empty() && !record_file.close())
+    {
+        cerr << "Could not write record file " << record_path << "\n";
+        return 1;
+    }
+    if (!instrumentation_path.empty())
+    {
+        if (!Mahjong::INSTRUMENTATION_ENABLED)
+            cerr << "Instrumentation is not compiled in, define MAHJONG_INSTRUMENT to enable it\n";
+        ofstream instrumentation_file(instrumentation_path);
+        Mahjong::write_instrumentation_json(instrumentation_file, results.instrumentation);
+        if (!instrumentation_file)
+        {
+            cerr << "Could not write instrumentation file " << instrumentation_path << "\n";
+            return 1;
+        }
+    }
+
+    cout << "Seed: " << seed << "\nGames: " << results.n_games << "\n";
+    if (duplicate)
+        cout << "Deals: " << results.n_games / N_PLAYERS << "\n";
+    for (int i = 0; i < N_PLAYERS; i++)
+    {
+        cout << "Player " << i << " (" << Mahjong::to_string(policies[i]) << "):\n";
+        print_seat_statistics(results.player_wins[i], results.n_games, results.score_stats[i], confidence);
+        if (duplicate)
+        {
+            Mahjong::Interval difference = results.duplicate_differences[i].get_confidence_interval(confidence);
+            cout << "Paired difference to the average per deal: " << results.duplicate_differences[i].get_mean() << " (" << confidence * 100 << "% CI "
+                 << difference.lower << " to " << difference.upper << ")" << endl;
+        }
+    }
+
+    // Policies playing several seats are also reported over all of their seats.
     for (int i = 0; i < N_PLAYERS; i++)
     {
-        int n_wins = player_wins[i];
-        float average_score = player_scores[i] / N_GAMES;
+        if (std::find(policies.begin(), policies.begin() + i, policies[i]) != policies.begin() + i)
+            continue;
+        unsigned int n_seats = 0;
+        unsigned int n_wins = 0;
+        Mahjong::Running_stats score_stats;
+        for (int j = i; j < N_PLAYERS; j++)
+        {
+            if (policies[j] != policies[i])
+                continue;
+            n_seats += 1;
+            n_wins += results.player_wins[j];
+            score_stats.merge(results.score_stats[j]);
+        }
+        if (n_seats < 2)
+            continue;
+        cout << "Policy " << Mahjong::to_string(policies[i]) << " (" << n_seats << " seats):\n";
+        print_seat_statistics(n_wins, static_cast<unsigned long long>(results.n_games) * n_seats, score_stats, confidence);
+    }
 
-        cout.clear();
-        cout << "Player " << i << ":\nNumber of wins: " << n_wins << "\nAverage score: " << average_score << endl;
+    if (compare)
+    {
+        Mahjong::Interval difference = results.comparison.get_confidence_interval(confidence);
+        cout << "Score difference " << Mahjong::to_string(comparison.policy_a) << " - " << Mahjong::to_string(comparison.policy_b) << ": "
+             << results.comparison.get_mean() << " (" << confidence * 100 << "% CI " << difference.lower << " to " << difference.upper << ")\n"
+             << (results.significant_difference ? "Significant" : "Not significant") << " at level " << comparison.significance
+             << " after " << results.comparison.get_n() << (duplicate ? " deals" : " games") << endl;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,281 @@
+/*
+Round-robin tournaments between policy entries, sharded into work units (see include/Tournament.hpp).
+
+    tournament plan SPEC [--dir DIR]
+        Lists the work units, with their state if DIR holds shard files.
+    tournament run SPEC --dir DIR [--unit I]... [--worker K --workers N] [--threads N] [--record]
+        Plays the given units, every N-th unit starting at K, or all units, skipping units whose shard file
+        exists. Units are independent, so workers on different nodes can share DIR or copy their shards into
+        one directory later, and a lost worker is replaced by running its units again. The threads of a
+        worker play different units, each unit on one thread, so its shard file is identical on every run.
+    tournament merge SPEC --dir DIR [--confidence P] [--partial]
+        Combines the shard files into standings and the results of every matchup.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/Game_record.hpp"
+#include "include/Logging.hpp"
+#include "include/Statistics.hpp"
+#include "include/Tournament.hpp"
+
+using namespace std;
+
+/**
+ * @brief Prints the command line options of the tournament driver.
+ */
+void print_usage()
+{
+    cout << "Usage: tournament plan SPEC [--dir DIR]\n"
+         << "       tournament run SPEC --dir DIR [--unit I]... [--worker K --workers N] [--threads N] [--record]\n"
+         << "       tournament merge SPEC --dir DIR [--confidence P] [--partial]\n"
+         << "  --dir DIR            Directory of the shard files.\n"
+         << "  --unit I             Run unit I, may be repeated.\n"
+         << "  --worker K           Run the units K, K + N, K + 2N, ... of --workers N.\n"
+         << "  --threads N          Number of units played at once (default: number of hardware threads).\n"
+         << "  --record             Also write the records of the games of each unit (see include/Game_record.hpp).\n"
+         << "  --confidence P       Confidence level of the reported intervals (default 0.95).\n"
+         << "  --partial            Merge the available shards even if some are missing.\n";
+}
+
+/**
+ * @brief Plays a unit and writes its shard file and optionally its game records.
+ *
+ * @param spec The spec.
+ * @param unit The unit.
+ * @param directory The directory of the shard files.
+ * @param n_threads Number of threads.
+ * @param record Whether to record the games.
+ * @return True if the files were written, false otherwise.
+ */
+bool run_unit(const Mahjong::Tournament_spec &spec, const Mahjong::Tournament_unit &unit, const string &directory, unsigned int n_threads, bool record)
+{
+    Mahjong::Game_record_file record_file;
+    const string record_path = Mahjong::get_tournament_unit_path(spec, unit, directory, ".rec");
+    if (record && !record_file.open(record_path + ".tmp"))
+        return false;
+    Mahjong::Tournament_shard shard = Mahjong::play_tournament_unit(spec, unit, n_threads, record ? &record_file : nullptr);
+    // The records are complete before the shard file, whose existence marks the unit as done.
+    if (record && (!record_file.close() || std::rename((record_path + ".tmp").c_str(), record_path.c_str()) != 0))
+        return false;
+    return Mahjong::write_tournament_shard(Mahjong::get_tournament_unit_path(spec, unit, directory, ".shard"), Mahjong::get_tournament_unit_key(spec, unit), shard);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        print_usage();
+        return (argc == 2 && (string(argv[1]) == "--help" || string(argv[1]) == "-h")) ? 0 : 1;
+    }
+    const string command = argv[1];
+    const string spec_path = argv[2];
+    string directory;
+    vector<unsigned int> selected_units;
+    unsigned int worker = 0;
+    unsigned int n_workers = 1;
+    unsigned int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool record = false;
+    bool partial = false;
+    double confidence = 0.95;
+
+    for (int i = 3; i < argc; i++)
+    {
+        string argument = argv[i];
+        if (argument == "--record")
+        {
+            record = true;
+            continue;
+        }
+        if (argument == "--partial")
+        {
+            partial = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+        string value = argv[++i];
+
+        if (argument == "--dir")
+            directory = value;
+        else if (argument == "--unit")
+            selected_units.push_back(stoul(value));
+        else if (argument == "--worker")
+            worker = stoul(value);
+        else if (argument == "--workers")
+            n_workers = std::max(1ul, stoul(value));
+        else if (argument == "--threads")
+            n_threads = stoul(value);
+        else if (argument == "--confidence")
+            confidence = stod(value);
+        else
+        {
+            cerr << "Unknown option " << argument << "\n";
+            print_usage();
+            return 1;
+        }
+    }
+    if (!(confidence > 0 && confidence < 1))
+    {
+        cerr << "Invalid confidence level " << confidence << "\n";
+        return 1;
+    }
+
+    Mahjong::Tournament_spec spec;
+    string error;
+    if (!Mahjong::read_tournament_spec(spec_path, spec, error))
+    {
+        cerr << "Invalid tournament spec " << spec_path << ": " << error << "\n";
+        return 1;
+    }
+    const vector<Mahjong::Tournament_unit> units = Mahjong::get_tournament_units(spec);
+
+    Mahjong::Null_sink null_sink;
+    Mahjong::set_log_sink(null_sink);
+
+    if (command == "plan")
+    {
+        cout << spec.entries.size() << " entries, " << units.size() << " units\n";
+        for (size_t index = 0; index < units.size(); index++)
+        {
+            const Mahjong::Tournament_unit &unit = units[index];
+            cout << index << ": " << spec.entries[unit.entry_a].name << " vs " << spec.entries[unit.entry_b].name << ", shard " << unit.shard
+                 << ", " << (spec.duplicate ? "deals " : "games ") << unit.first_game << " to " << unit.first_game + unit.n_games - 1;
+            if (!directory.empty())
+            {
+                Mahjong::Tournament_shard shard;
+                bool done = Mahjong::read_tournament_shard(Mahjong::get_tournament_unit_path(spec, unit, directory, ".shard"), Mahjong::get_tournament_unit_key(spec, unit), shard);
+                cout << (done ? ", done" : ", pending");
+            }
+            cout << "\n";
+        }
+        return 0;
+    }
+
+    if (directory.empty())
+    {
+        cerr << "Missing --dir\n";
+        return 1;
+    }
+
+    if (command == "run")
+    {
+        if (selected_units.empty())
+        {
+            for (unsigned int index = worker; index < units.size(); index += n_workers)
+                selected_units.push_back(index);
+        }
+        for (unsigned int index : selected_units)
+        {
+            if (index >= units.size())
+            {
+                cerr << "Unknown unit " << index << ", the spec has " << units.size() << " units\n";
+                return 1;
+            }
+        }
+
+        std::atomic<size_t> next_unit(0);
+        std::atomic<bool> failed(false);
+        std::mutex output_mutex;
+        auto play_units = [&]()
+        {
+            for (size_t i = next_unit++; i < selected_units.size() && !failed; i = next_unit++)
+            {
+                const unsigned int index = selected_units[i];
+                const Mahjong::Tournament_unit &unit = units[index];
+                Mahjong::Tournament_shard shard;
+                if (Mahjong::read_tournament_shard(Mahjong::get_tournament_unit_path(spec, unit, directory, ".shard"), Mahjong::get_tournament_unit_key(spec, unit), shard))
+                {
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    cout << "Unit " << index << " already done" << endl;
+                    continue;
+                }
+                bool written = run_unit(spec, unit, directory, 1, record);
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if (!written)
+                {
+                    cerr << "Could not write the files of unit " << index << " to " << directory << "\n";
+                    failed = true;
+                }
+                else
+                    cout << "Unit " << index << " done" << endl;
+            }
+        };
+
+        vector<std::thread> threads;
+        for (unsigned int thread = 1; thread < std::min<size_t>(n_threads, selected_units.size()); thread++)
+            threads.emplace_back(play_units);
+        play_units();
+        for (std::thread &thread : threads)
+            thread.join();
+        return failed ? 1 : 0;
+    }
+
+    if (command == "merge")
+    {
+        vector<Mahjong::Tournament_shard> shards(units.size());
+        vector<bool> has_shard(units.size());
+        unsigned int n_missing = 0;
+        for (size_t index = 0; index < units.size(); index++)
+        {
+            has_shard[index] = Mahjong::read_tournament_shard(Mahjong::get_tournament_unit_path(spec, units[index], directory, ".shard"),
+                                                              Mahjong::get_tournament_unit_key(spec, units[index]), shards[index]);
+            if (!has_shard[index])
+            {
+                cerr << "Missing unit " << index << "\n";
+                n_missing += 1;
+            }
+        }
+        if (n_missing > 0 && !partial)
+        {
+            cerr << n_missing << " of " << units.size() << " units are missing, run them or merge with --partial\n";
+            return 1;
+        }
+
+        cout << "Standings (" << units.size() - n_missing << " of " << units.size() << " units):\n";
+        vector<Mahjong::Tournament_standing> standings = Mahjong::get_tournament_standings(spec, units, shards, has_shard);
+        for (size_t rank = 0; rank < standings.size(); rank++)
+        {
+            const Mahjong::Tournament_standing &standing = standings[rank];
+            Mahjong::Interval win_rate = Mahjong::get_wilson_interval(standing.n_wins, 2 * standing.n_games, confidence);
+            Mahjong::Interval score = standing.scores.get_confidence_interval(confidence);
+            cout << rank + 1 << ". " << spec.entries[standing.entry].name << ": average difference " << standing.average_difference
+                 << " over " << standing.n_matchups << " matchups, " << standing.n_games << " games\n"
+                 << "   Win rate: " << (standing.n_games > 0 ? standing.n_wins / (2.0 * standing.n_games) : 0.0) << " (" << confidence * 100
+                 << "% CI " << win_rate.lower << " to " << win_rate.upper << ")\n"
+                 << "   Average score: " << standing.scores.get_mean() << " (" << confidence * 100 << "% CI " << score.lower << " to " << score.upper << ")\n";
+        }
+
+        cout << "Matchups:\n";
+        for (size_t begin = 0; begin < units.size();)
+        {
+            size_t end = begin;
+            Mahjong::Tournament_shard matchup;
+            for (; end < units.size() && units[end].entry_a == units[begin].entry_a && units[end].entry_b == units[begin].entry_b; end++)
+            {
+                if (has_shard[end])
+                    matchup.merge(shards[end]);
+            }
+            Mahjong::Interval difference = matchup.difference.get_confidence_interval(confidence);
+            cout << spec.entries[units[begin].entry_a].name << " - " << spec.entries[units[begin].entry_b].name << ": " << matchup.difference.get_mean()
+                 << " (" << confidence * 100 << "% CI " << difference.lower << " to " << difference.upper << ") over " << matchup.difference.get_n()
+                 << (spec.duplicate ? " deals" : " games") << (matchup.difference.is_nonzero(1 - confidence) ? ", significant" : "") << "\n";
+            begin = end;
+        }
+        return 0;
+    }
+
+    cerr << "Unknown command " << command << "\n";
+    print_usage();
+    return 1;
+}